@@ -6,6 +6,7 @@
 #include <bench/bench.h>
 #include <crypto/muhash.h>
 #include <crypto/ripemd160.h>
+#include <crypto/scrypt.h>
 #include <crypto/sha1.h>
 #include <crypto/sha256.h>
 #include <crypto/sha3.h>
@@ -72,6 +73,26 @@ static void SHA256D64_1024(benchmark::Bench& bench)
     });
 }
 
+static void Scrypt(benchmark::Bench& bench)
+{
+    std::vector<char> in(80, 0);
+    std::vector<char> out(32);
+    bench.unit("hash").run([&] {
+        scrypt_1024_1_1_256(in.data(), out.data());
+        in[0]++;
+    });
+}
+
+static void ScryptBatch_64(benchmark::Bench& bench)
+{
+    std::vector<char> in(80 * 64, 0);
+    std::vector<char> out(32 * 64);
+    bench.batch(64).unit("hash").run([&] {
+        scrypt_1024_1_1_256_batch(in.data(), out.data(), 64);
+        in[0]++;
+    });
+}
+
 static void SHA512(benchmark::Bench& bench)
 {
     uint8_t hash[CSHA512::OUTPUT_SIZE];
@@ -159,6 +180,8 @@ BENCHMARK(SHA3_256_1M);
 BENCHMARK(SHA256_32b);
 BENCHMARK(SipHash_32b);
 BENCHMARK(SHA256D64_1024);
+BENCHMARK(Scrypt);
+BENCHMARK(ScryptBatch_64);
 BENCHMARK(FastRandom_32bit);
 BENCHMARK(FastRandom_1bit);
 
@@ -0,0 +1,76 @@
+// Copyright (c) 2022 The Myce Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <key.h>
+#include <masternode/masternode.h>
+#include <masternode/masternodesigner.h>
+#include <random.h>
+#include <test/util/setup_common.h>
+
+#include <string>
+#include <vector>
+
+static const int MASTERNODES = 5000;
+
+struct SignedPing {
+    CPubKey pubkey;
+    std::vector<unsigned char> vchSig;
+    std::string strMessage;
+};
+
+// One signed ping per masternode, as relayed again on every ping interval.
+static std::vector<SignedPing> CreatePings()
+{
+    FastRandomContext insecure_rand(true);
+    std::vector<SignedPing> vPings(MASTERNODES);
+    for (SignedPing& ping : vPings) {
+        CKey key;
+        key.MakeNewKey(true);
+        ping.pubkey = key.GetPubKey();
+
+        CMasternodePing mnp;
+        mnp.vin = CTxIn(COutPoint(insecure_rand.rand256(), 0));
+        mnp.blockHash = insecure_rand.rand256();
+        mnp.sigTime = 1600000000;
+        ping.strMessage = mnp.GetStrMessage();
+        legacySigner.SignMessage(ping.strMessage, ping.vchSig, key);
+    }
+    return vPings;
+}
+
+// What verifying every re-gossiped ping cost before the signature cache.
+static void LegacySignatureRegossipRecover(benchmark::Bench& bench)
+{
+    const auto testing_setup = MakeNoLogFileContext<const BasicTestingSetup>();
+    const std::vector<SignedPing> vPings = CreatePings();
+
+    bench.batch(vPings.size()).unit("signature").run([&] {
+        for (const SignedPing& ping : vPings) {
+            CPubKey pubkey;
+            bool fValid = pubkey.RecoverCompact(CLegacySigner::GetMessageHash(ping.strMessage), ping.vchSig) && pubkey.GetID() == ping.pubkey.GetID();
+            assert(fValid);
+        }
+    });
+}
+
+// The same pings verified again once the first receipt put them in the cache.
+static void LegacySignatureRegossipCached(benchmark::Bench& bench)
+{
+    const auto testing_setup = MakeNoLogFileContext<const BasicTestingSetup>();
+    std::vector<SignedPing> vPings = CreatePings();
+    for (SignedPing& ping : vPings) {
+        assert(legacySigner.VerifyMessage(ping.pubkey, ping.vchSig, ping.strMessage));
+    }
+
+    bench.batch(vPings.size()).unit("signature").run([&] {
+        for (SignedPing& ping : vPings) {
+            bool fValid = legacySigner.VerifyMessage(ping.pubkey, ping.vchSig, ping.strMessage);
+            assert(fValid);
+        }
+    });
+}
+
+BENCHMARK(LegacySignatureRegossipRecover);
+BENCHMARK(LegacySignatureRegossipCached);
@@ -0,0 +1,47 @@
+// Copyright (c) 2022 The Myce Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <pow.h>
+#include <random.h>
+#include <test/util/setup_common.h>
+
+#include <vector>
+
+static const size_t POW_BLOCKS = 1000;
+static const size_t CHAIN_LENGTH = 1000000;
+
+// A chain that switched to proof-of-stake after its first blocks, so the last
+// proof-of-work block is far behind the tip.
+static void GetNextWorkRequiredPoSChain(benchmark::Bench& bench)
+{
+    const auto testing_setup = MakeNoLogFileContext<const BasicTestingSetup>(CBaseChainParams::MAIN);
+    const Consensus::Params& params = Params().GetConsensus();
+
+    FastRandomContext insecure_rand(true);
+    std::vector<CBlockIndex> vIndex(CHAIN_LENGTH);
+    std::vector<uint256> vHash(CHAIN_LENGTH);
+    for (size_t i = 0; i < CHAIN_LENGTH; i++) {
+        CBlockIndex& index = vIndex[i];
+        index.pprev = i ? &vIndex[i - 1] : nullptr;
+        index.nHeight = i;
+        vHash[i] = insecure_rand.rand256();
+        index.phashBlock = &vHash[i];
+        index.nTime = 1600000000 + i * 60 + insecure_rand.randrange(30);
+        index.nBits = i < POW_BLOCKS ? 0x1e0fffff : 0x1e00ffff;
+        index.nNonce = i < POW_BLOCKS ? 1 : 0;
+        index.BuildSkip();
+    }
+
+    const CBlockIndex* pindexTip = &vIndex.back();
+    bench.run([&] {
+        unsigned int nBitsPoS = GetNextWorkRequired(pindexTip, params, true);
+        unsigned int nBitsPoW = GetNextWorkRequired(pindexTip, params, false);
+        ankerl::nanobench::doNotOptimizeAway(nBitsPoS + nBitsPoW);
+    });
+}
+
+BENCHMARK(GetNextWorkRequiredPoSChain);
@@ -0,0 +1,77 @@
+// Copyright (c) 2022 The Myce Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <pos/pos.h>
+#include <pos/stakesearch.h>
+#include <random.h>
+#include <streams.h>
+#include <util/system.h>
+
+#include <vector>
+
+static const size_t KERNELS = 100000;
+// smallest possible target, so that every round tries all kernels
+static const unsigned int MISS_BITS = 0x01010000;
+
+struct StakeSearchInput {
+    COutPoint prevout;
+    uint256 hashBlockFrom;
+    CStakeKernel kernel;
+};
+
+static std::vector<StakeSearchInput> MakeInputs()
+{
+    FastRandomContext insecure_rand(true);
+    std::vector<StakeSearchInput> vInputs;
+    vInputs.reserve(KERNELS);
+    for (size_t i = 0; i < KERNELS; ++i) {
+        const COutPoint prevout(insecure_rand.rand256(), i % 4);
+        CDataStream ss(SER_NETWORK, 0);
+        ss << prevout.n << prevout.hash;
+        vInputs.push_back({prevout, insecure_rand.rand256(), CStakeKernel(insecure_rand.rand64(), 1600000000, ss, 100 * COIN)});
+    }
+    return vInputs;
+}
+
+static void StakeSearch(benchmark::Bench& bench, int nThreads)
+{
+    const std::vector<StakeSearchInput> vInputs = MakeInputs();
+    std::vector<const CStakeKernel*> vKernels;
+    vKernels.reserve(KERNELS);
+
+    // a staking round: collect the kernels through the cache, then search them
+    CStakeSearcher searcher(nThreads);
+    bench.batch(KERNELS * STAKE_HASH_DRIFT).unit("hash").run([&] {
+        vKernels.clear();
+        for (const StakeSearchInput& input : vInputs) {
+            const CStakeKernel* kernel = searcher.GetCachedKernel(input.prevout, input.hashBlockFrom, input.kernel.GetStakeModifier());
+            if (!kernel) {
+                kernel = searcher.AddCachedKernel(input.prevout, input.hashBlockFrom, input.kernel);
+            }
+            vKernels.push_back(kernel);
+        }
+        searcher.NewCacheRound();
+
+        size_t nKernel;
+        unsigned int nTimeTx;
+        uint256 hashProofOfStake;
+        bool fFound = searcher.Search(vKernels, MISS_BITS, 1700000000, STAKE_HASH_DRIFT, nKernel, nTimeTx, hashProofOfStake);
+        assert(!fFound);
+    });
+}
+
+static void StakeSearchSingleThread(benchmark::Bench& bench)
+{
+    StakeSearch(bench, 0);
+}
+
+static void StakeSearchAllCores(benchmark::Bench& bench)
+{
+    // The calling thread joins the workers, so don't oversubscribe
+    StakeSearch(bench, GetNumCores() - 1);
+}
+
+BENCHMARK(StakeSearchSingleThread);
+BENCHMARK(StakeSearchAllCores);
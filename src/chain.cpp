@@ -118,8 +118,10 @@ CBlockIndex* CBlockIndex::GetAncestor(int height)
 
 void CBlockIndex::BuildSkip()
 {
-    if (pprev)
+    if (pprev) {
         pskip = pprev->GetAncestor(GetSkipHeight(nHeight));
+        pprevOtherType = pprev->IsProofOfStake() != IsProofOfStake() ? pprev : pprev->pprevOtherType;
+    }
 }
 
 
@@ -162,6 +162,9 @@ public:
     //! pointer to the index of some further predecessor of this block
     CBlockIndex* pskip{nullptr};
 
+    //! pointer to the closest predecessor of the other block type (proof-of-stake vs proof-of-work), if any
+    CBlockIndex* pprevOtherType{nullptr};
+
     //! height of the entry in the chain. The genesis block has height 0
     int nHeight{0};
 
@@ -424,7 +427,7 @@ public:
         return false;
     }
 
-    //! Build the skiplist pointer for this entry.
+    //! Build the skiplist and block type pointers for this entry.
     void BuildSkip();
 
     //! Efficiently find an ancestor of this block.
@@ -11,6 +11,7 @@
 #include <util/threadnames.h>
 
 #include <algorithm>
+#include <string>
 #include <vector>
 
 template <typename T>
@@ -65,6 +66,9 @@ private:
     std::vector<std::thread> m_worker_threads;
     bool m_request_stop GUARDED_BY(m_mutex){false};
 
+    //! Name prefix of the worker threads
+    const std::string m_thread_name;
+
     /** Internal function that does bulk of the verification work. */
     bool Loop(bool fMaster) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
     {
@@ -134,8 +138,8 @@ public:
     Mutex m_control_mutex;
 
     //! Create a new check queue
-    explicit CCheckQueue(unsigned int nBatchSizeIn)
-        : nBatchSize(nBatchSizeIn)
+    explicit CCheckQueue(unsigned int nBatchSizeIn, std::string thread_name = "scriptch")
+        : nBatchSize(nBatchSizeIn), m_thread_name(std::move(thread_name))
     {
     }
 
@@ -151,7 +155,7 @@ public:
         assert(m_worker_threads.empty());
         for (int n = 0; n < threads_num; ++n) {
             m_worker_threads.emplace_back([this, n]() {
-                util::ThreadRename(strprintf("scriptch.%i", n));
+                util::ThreadRename(strprintf("%s.%i", m_thread_name, n));
                 SetSyscallSandboxPolicy(SyscallSandboxPolicy::VALIDATION_SCRIPT_CHECK);
                 Loop(false /* worker thread */);
             });
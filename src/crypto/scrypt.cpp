@@ -28,7 +28,12 @@
  */
 
 #include <crypto/scrypt.h>
+#include <crypto/common.h>
 
+#include <compat/cpuid.h>
+
+#include <assert.h>
+#include <memory>
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
@@ -573,3 +578,102 @@ void scrypt_1024_1_1_256(const CBlockHeader& input, char *output)
     memcpy(blockheader, &input, 80);
     scrypt_1024_1_1_256(blockheader, output);
 }
+
+#if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL)
+namespace scrypt_avx2
+{
+void scrypt_1024_1_1_256_sp_8way(const char *input, char *output, char *scratchpad);
+}
+#endif
+
+namespace {
+
+typedef void (*scrypt_nway_fn)(const char *input, char *output, char *scratchpad);
+
+//! Multi-lane implementation and its number of lanes, if any
+scrypt_nway_fn scrypt_1024_1_1_256_sp_nway = nullptr;
+size_t scrypt_lanes = 0;
+
+void scrypt_1024_1_1_256_batch_nway(const char *input, char *output, size_t n)
+{
+    std::unique_ptr<char[]> scratchpad(new char[(SCRYPT_SCRATCHPAD_SIZE - 63) * scrypt_lanes + 63]);
+    for (size_t i = 0; i < n; i += scrypt_lanes) {
+        scrypt_1024_1_1_256_sp_nway(input + 80 * i, output + 32 * i, scratchpad.get());
+    }
+}
+
+#if defined(USE_ASM) && defined(HAVE_GETCPUID)
+bool AVXEnabled()
+{
+    uint32_t a, d;
+    __asm__("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+    return (a & 6) == 6;
+}
+#endif
+
+bool SelfTest()
+{
+    if (!scrypt_1024_1_1_256_sp_nway) {
+        return true;
+    }
+
+    char input[80 * 8];
+    for (size_t i = 0; i < sizeof(input); i++) {
+        input[i] = (char)(i * 7 + 3);
+    }
+    char expected[32 * 8], output[32 * 8];
+    for (size_t i = 0; i < 8; i++) {
+        scrypt_1024_1_1_256(input + 80 * i, expected + 32 * i);
+    }
+    scrypt_1024_1_1_256_batch_nway(input, output, scrypt_lanes);
+    return memcmp(expected, output, 32 * scrypt_lanes) == 0;
+}
+
+} // namespace
+
+void scrypt_1024_1_1_256_batch(const char *input, char *output, size_t n)
+{
+    const size_t nWide = scrypt_1024_1_1_256_sp_nway ? n - n % scrypt_lanes : 0;
+    if (nWide > 0) {
+        scrypt_1024_1_1_256_batch_nway(input, output, nWide);
+    }
+    for (size_t i = nWide; i < n; i++) {
+        scrypt_1024_1_1_256(input + 80 * i, output + 32 * i);
+    }
+}
+
+std::string ScryptAutoDetect()
+{
+    std::string ret = "standard";
+#if defined(USE_ASM) && defined(HAVE_GETCPUID)
+    bool have_xsave = false;
+    bool have_avx = false;
+    [[maybe_unused]] bool have_avx2 = false;
+    [[maybe_unused]] bool enabled_avx = false;
+
+    uint32_t eax, ebx, ecx, edx;
+    GetCPUID(0, 0, eax, ebx, ecx, edx);
+    const uint32_t max_leaf = eax;
+    GetCPUID(1, 0, eax, ebx, ecx, edx);
+    have_xsave = (ecx >> 27) & 1;
+    have_avx = (ecx >> 28) & 1;
+    if (have_xsave && have_avx) {
+        enabled_avx = AVXEnabled();
+    }
+    if (max_leaf >= 7) {
+        GetCPUID(7, 0, eax, ebx, ecx, edx);
+        have_avx2 = (ebx >> 5) & 1;
+    }
+
+#if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL)
+    if (have_avx2 && have_avx && enabled_avx) {
+        scrypt_1024_1_1_256_sp_nway = scrypt_avx2::scrypt_1024_1_1_256_sp_8way;
+        scrypt_lanes = 8;
+        ret = "avx2(8way)";
+    }
+#endif
+#endif // defined(USE_ASM) && defined(HAVE_GETCPUID)
+
+    assert(SelfTest());
+    return ret;
+}
@@ -6,14 +6,25 @@
 
 class CBlockHeader;
 
+#include <string>
+
 static const int SCRYPT_SCRATCHPAD_SIZE = 131072 + 63;
 
 void scrypt_1024_1_1_256(const char *input, char *output);
 void scrypt_1024_1_1_256(const CBlockHeader& input, char *output);
 void scrypt_1024_1_1_256_sp_generic(const char *input, char *output, char *scratchpad);
 
+/**
+ * Hash n consecutive 80 byte inputs into n consecutive 32 byte outputs. Uses
+ * the multi-lane implementation picked by ScryptAutoDetect for whole groups
+ * of inputs and the single-lane one for the rest.
+ */
+void scrypt_1024_1_1_256_batch(const char *input, char *output, size_t n);
+
+/** Autodetect the best available multi-lane scrypt implementation. Returns the name of it. */
+std::string ScryptAutoDetect();
+
 #if defined(USE_SSE2)
-#include <string>
 #if defined(_M_X64) || defined(__x86_64__) || defined(_M_AMD64) || (defined(MAC_OSX) && defined(__i386__))
 #define USE_SSE2_ALWAYS 1
 #define scrypt_1024_1_1_256_sp(input, output, scratchpad) scrypt_1024_1_1_256_sp_sse2((input), (output), (scratchpad))
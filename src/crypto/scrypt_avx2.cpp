@@ -0,0 +1,111 @@
+// Copyright (c) 2022 The Myce Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifdef ENABLE_AVX2
+
+#include <crypto/scrypt.h>
+
+#include <stdint.h>
+#include <string.h>
+#include <immintrin.h>
+
+namespace scrypt_avx2 {
+namespace {
+
+// Eight independent scrypt evaluations, interleaved: word k of lane l lives in
+// element l of vector k.
+
+__m256i inline Add(__m256i x, __m256i y) { return _mm256_add_epi32(x, y); }
+__m256i inline Xor(__m256i x, __m256i y) { return _mm256_xor_si256(x, y); }
+__m256i inline Rotl(__m256i x, int n) { return _mm256_or_si256(_mm256_slli_epi32(x, n), _mm256_srli_epi32(x, 32 - n)); }
+
+void inline xor_salsa8(__m256i B[16], const __m256i Bx[16])
+{
+    __m256i x[16];
+    for (int i = 0; i < 16; i++) {
+        x[i] = B[i] = Xor(B[i], Bx[i]);
+    }
+    for (int i = 0; i < 8; i += 2) {
+        /* Operate on columns. */
+        x[ 4] = Xor(x[ 4], Rotl(Add(x[ 0], x[12]),  7));  x[ 9] = Xor(x[ 9], Rotl(Add(x[ 5], x[ 1]),  7));
+        x[14] = Xor(x[14], Rotl(Add(x[10], x[ 6]),  7));  x[ 3] = Xor(x[ 3], Rotl(Add(x[15], x[11]),  7));
+
+        x[ 8] = Xor(x[ 8], Rotl(Add(x[ 4], x[ 0]),  9));  x[13] = Xor(x[13], Rotl(Add(x[ 9], x[ 5]),  9));
+        x[ 2] = Xor(x[ 2], Rotl(Add(x[14], x[10]),  9));  x[ 7] = Xor(x[ 7], Rotl(Add(x[ 3], x[15]),  9));
+
+        x[12] = Xor(x[12], Rotl(Add(x[ 8], x[ 4]), 13));  x[ 1] = Xor(x[ 1], Rotl(Add(x[13], x[ 9]), 13));
+        x[ 6] = Xor(x[ 6], Rotl(Add(x[ 2], x[14]), 13));  x[11] = Xor(x[11], Rotl(Add(x[ 7], x[ 3]), 13));
+
+        x[ 0] = Xor(x[ 0], Rotl(Add(x[12], x[ 8]), 18));  x[ 5] = Xor(x[ 5], Rotl(Add(x[ 1], x[13]), 18));
+        x[10] = Xor(x[10], Rotl(Add(x[ 6], x[ 2]), 18));  x[15] = Xor(x[15], Rotl(Add(x[11], x[ 7]), 18));
+
+        /* Operate on rows. */
+        x[ 1] = Xor(x[ 1], Rotl(Add(x[ 0], x[ 3]),  7));  x[ 6] = Xor(x[ 6], Rotl(Add(x[ 5], x[ 4]),  7));
+        x[11] = Xor(x[11], Rotl(Add(x[10], x[ 9]),  7));  x[12] = Xor(x[12], Rotl(Add(x[15], x[14]),  7));
+
+        x[ 2] = Xor(x[ 2], Rotl(Add(x[ 1], x[ 0]),  9));  x[ 7] = Xor(x[ 7], Rotl(Add(x[ 6], x[ 5]),  9));
+        x[ 8] = Xor(x[ 8], Rotl(Add(x[11], x[10]),  9));  x[13] = Xor(x[13], Rotl(Add(x[12], x[15]),  9));
+
+        x[ 3] = Xor(x[ 3], Rotl(Add(x[ 2], x[ 1]), 13));  x[ 4] = Xor(x[ 4], Rotl(Add(x[ 7], x[ 6]), 13));
+        x[ 9] = Xor(x[ 9], Rotl(Add(x[ 8], x[11]), 13));  x[14] = Xor(x[14], Rotl(Add(x[13], x[12]), 13));
+
+        x[ 0] = Xor(x[ 0], Rotl(Add(x[ 3], x[ 2]), 18));  x[ 5] = Xor(x[ 5], Rotl(Add(x[ 4], x[ 7]), 18));
+        x[10] = Xor(x[10], Rotl(Add(x[ 9], x[ 8]), 18));  x[15] = Xor(x[15], Rotl(Add(x[14], x[13]), 18));
+    }
+    for (int i = 0; i < 16; i++) {
+        B[i] = Add(B[i], x[i]);
+    }
+}
+
+} // namespace
+
+void scrypt_1024_1_1_256_sp_8way(const char *input, char *output, char *scratchpad)
+{
+    alignas(32) uint32_t W[32][8];
+    uint8_t B[8][128];
+    __m256i X[32];
+    __m256i *V;
+
+    V = (__m256i *)(((uintptr_t)(scratchpad) + 63) & ~ (uintptr_t)(63));
+
+    for (int l = 0; l < 8; l++) {
+        PBKDF2_SHA256((const uint8_t *)input + 80 * l, 80, (const uint8_t *)input + 80 * l, 80, 1, B[l], 128);
+        for (int k = 0; k < 32; k++)
+            W[k][l] = le32dec(&B[l][4 * k]);
+    }
+    for (int k = 0; k < 32; k++)
+        X[k] = _mm256_load_si256((const __m256i *)W[k]);
+
+    for (int i = 0; i < 1024; i++) {
+        for (int k = 0; k < 32; k++)
+            _mm256_store_si256(&V[i * 32 + k], X[k]);
+        xor_salsa8(&X[0], &X[16]);
+        xor_salsa8(&X[16], &X[0]);
+    }
+
+    // every lane reads its own scratchpad row, so the rows are gathered
+    const __m256i lanes = _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+    const __m256i mask = _mm256_set1_epi32(1023);
+    for (int i = 0; i < 1024; i++) {
+        __m256i idx = Add(_mm256_slli_epi32(_mm256_and_si256(X[16], mask), 8), lanes);
+        for (int k = 0; k < 32; k++) {
+            X[k] = Xor(X[k], _mm256_i32gather_epi32((const int *)V, idx, 4));
+            idx = Add(idx, _mm256_set1_epi32(8));
+        }
+        xor_salsa8(&X[0], &X[16]);
+        xor_salsa8(&X[16], &X[0]);
+    }
+
+    for (int k = 0; k < 32; k++)
+        _mm256_store_si256((__m256i *)W[k], X[k]);
+    for (int l = 0; l < 8; l++) {
+        for (int k = 0; k < 32; k++)
+            le32enc(&B[l][4 * k], W[k][l]);
+        PBKDF2_SHA256((const uint8_t *)input + 80 * l, 80, B[l], 128, 1, (uint8_t *)output + 32 * l, 32);
+    }
+}
+
+} // namespace scrypt_avx2
+
+#endif // ENABLE_AVX2
@@ -33,6 +33,7 @@
 #include <interfaces/node.h>
 #include <mapport.h>
 #include <masternode/activemasternode.h>
+#include <masternode/budgetcollateralindex.h>
 #include <masternode/budgetdb.h>
 #include <masternode/init.h>
 #include <masternode/masternode-budget.h>
@@ -40,6 +41,8 @@
 #include <masternode/masternodeconfig.h>
 #include <masternode/masternodeman.h>
 #include <masternode/masternodesigner.h>
+#include <masternode/messagequeue.h>
+#include <masternode/mncachedb.h>
 #include <masternode/spork.h>
 #include <masternode/sporkdb.h>
 #include <net.h>
@@ -61,6 +64,8 @@
 #include <policy/fees_args.h>
 #include <policy/policy.h>
 #include <policy/settings.h>
+#include <pos/modifierindex.h>
+#include <pos/pos.h>
 #include <protocol.h>
 #include <rpc/blockchain.h>
 #include <rpc/register.h>
@@ -248,6 +253,16 @@ void Shutdown(NodeContext& node)
     // Kill the masternode thread here as it relies on connman which is about
     // to be destroyed directly below
     if (masternodeThread.joinable()) masternodeThread.join();
+    // Stop handling messages before the masternode caches are flushed, so that
+    // no handler changes the managers afterwards: the message handler first,
+    // as it handles masternode messages itself once the workers are gone. The
+    // peers the workers still hold are deleted with connman below.
+    if (node.connman) node.connman->StopThreads();
+    masternodeMessageQueue.StopWorkerThreads();
+    StopLegacySigCheckWorkerThreads();
+    FlushMasternodeCaches();
+    delete pMasternodeCacheDB;
+    pMasternodeCacheDB = nullptr;
 
     // Because these depend on each-other, we make sure that neither can be
     // using the other before destroying them.
@@ -261,6 +276,7 @@ void Shutdown(NodeContext& node)
     if (node.scheduler) node.scheduler->stop();
     if (node.chainman && node.chainman->m_load_block.joinable()) node.chainman->m_load_block.join();
     StopScriptCheckWorkerThreads();
+    StopHeaderCheckWorkerThreads();
 
     // After the threads that potentially access these pointers have been stopped,
     // destruct and reset all to nullptr.
@@ -300,6 +316,8 @@ void Shutdown(NodeContext& node)
         g_coin_stats_index->Stop();
         g_coin_stats_index.reset();
     }
+    g_stake_modifier_index.reset();
+    g_budget_collateral_index.reset();
     ForEachBlockFilterIndex([](BlockFilterIndex& index) { index.Stop(); });
     DestroyAllBlockFilterIndexes();
 
@@ -553,6 +571,7 @@ void SetupServerArgs(ArgsManager& argsman)
 #endif
 
     argsman.AddArg("-checkblocks=<n>", strprintf("How many blocks to check at startup (default: %u, 0 = all)", DEFAULT_CHECKBLOCKS), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
+    argsman.AddArg("-checkblockindexhashes", strprintf("Recompute the hash of every block index entry at startup instead of trusting the database key (default: %u)", DEFAULT_CHECK_BLOCK_INDEX_HASHES), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
     argsman.AddArg("-checklevel=<n>", strprintf("How thorough the block verification of -checkblocks is: %s (0-4, default: %u)", Join(CHECKLEVEL_DOC, ", "), DEFAULT_CHECKLEVEL), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
     argsman.AddArg("-checkblockindex", strprintf("Do a consistency check for the block tree, chainstate, and other validation data structures occasionally. (default: %u, regtest: %u)", defaultChainParams->DefaultConsistencyChecks(), regtestChainParams->DefaultConsistencyChecks()), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
     argsman.AddArg("-checkaddrman=<n>", strprintf("Run addrman consistency checks every <n> operations. Use 0 to disable. (default: %u)", DEFAULT_ADDRMAN_CONSISTENCY_CHECKS), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
@@ -1163,6 +1182,10 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
     if (script_threads >= 1) {
         g_parallel_script_checks = true;
         StartScriptCheckWorkerThreads(script_threads);
+        // headers messages are proof-of-work checked by a pool of the same size
+        StartHeaderCheckWorkerThreads(script_threads);
+        // and so are batches of masternode, payment and budget signatures
+        StartLegacySigCheckWorkerThreads(script_threads);
     }
 
     assert(!node.scheduler);
@@ -1528,6 +1551,20 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
 
     ChainstateManager& chainman = *Assert(node.chainman);
 
+    // Load the kernel stake modifier index and catch it up to the loaded tip
+    uiInterface.InitMessage(_("Loading stake modifier index…").translated);
+    g_stake_modifier_index = std::make_unique<CStakeModifierIndex>(0, false, fReindex);
+    if (!WITH_LOCK(cs_main, return g_stake_modifier_index->Init(chainman.ActiveChain()))) {
+        return InitError(_("Error loading stake modifier index"));
+    }
+
+    // Load the budget collateral index and catch it up to the loaded tip
+    uiInterface.InitMessage(_("Loading budget collateral index…").translated);
+    g_budget_collateral_index = std::make_unique<CBudgetCollateralIndex>(0, false, fReindex);
+    if (!g_budget_collateral_index->Init(chainman.ActiveChainstate())) {
+        return InitError(_("Error loading budget collateral index"));
+    }
+
     // Pass chainmanager pointer to our masternode objects
     InitObjects(&chainman);
 
@@ -1649,55 +1686,73 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
     uiInterface.InitMessage(_("Loading spork cache…").translated);
 
     pSporkDB = new CSporkDB(0, false, false);
+    pMasternodeCacheDB = new CMasternodeCacheDB(0, false, false);
 
-    uiInterface.InitMessage(_("Loading masternode cache…").translated);
+    if (pMasternodeCacheDB->IsInitialized()) {
+        uiInterface.InitMessage(_("Loading masternode cache…").translated);
+        if (!mnodeman.LoadCache(*pMasternodeCacheDB))
+            LogPrintf("Error reading the masternode cache, will try to recreate\n");
 
-    CMasternodeDB mndb;
-    CMasternodeDB::ReadResult readResult = mndb.Read(mnodeman);
-    if (readResult == CMasternodeDB::FileError)
-        LogPrintf("Missing masternode cache file - mncache.dat, will try to recreate\n");
-    else if (readResult != CMasternodeDB::Ok) {
-        LogPrintf("Error reading mncache.dat: ");
-        if (readResult == CMasternodeDB::IncorrectFormat)
-            LogPrintf("magic is ok but data has invalid format, will try to recreate\n");
-        else
-            LogPrintf("file format is unknown or invalid, please fix it manually\n");
-    }
+        uiInterface.InitMessage(_("Loading budget cache…").translated);
+        if (!budget.LoadCache(*pMasternodeCacheDB))
+            LogPrintf("Error reading the budget cache, will try to recreate\n");
 
-    uiInterface.InitMessage(_("Loading budget cache…").translated);
+        uiInterface.InitMessage(_("Loading masternode payment cache…").translated);
+        if (!masternodePayments.LoadCache(*pMasternodeCacheDB))
+            LogPrintf("Error reading the masternode payment cache, will try to recreate\n");
+    } else {
+        // first start with the cache database, move over what the .dat files have
+        uiInterface.InitMessage(_("Loading masternode cache…").translated);
+
+        CMasternodeDB mndb;
+        CMasternodeDB::ReadResult readResult = mndb.Read(mnodeman);
+        if (readResult == CMasternodeDB::FileError)
+            LogPrintf("Missing masternode cache file - mncache.dat, will try to recreate\n");
+        else if (readResult != CMasternodeDB::Ok) {
+            LogPrintf("Error reading mncache.dat: ");
+            if (readResult == CMasternodeDB::IncorrectFormat)
+                LogPrintf("magic is ok but data has invalid format, will try to recreate\n");
+            else
+                LogPrintf("file format is unknown or invalid, please fix it manually\n");
+        }
 
-    CBudgetDB budgetdb;
-    CBudgetDB::ReadResult readResult2 = budgetdb.Read(budget);
+        uiInterface.InitMessage(_("Loading budget cache…").translated);
 
-    if (readResult2 == CBudgetDB::FileError)
-        LogPrintf("Missing budget cache - budget.dat, will try to recreate\n");
-    else if (readResult2 != CBudgetDB::Ok) {
-        LogPrintf("Error reading budget.dat: ");
-        if (readResult2 == CBudgetDB::IncorrectFormat)
-            LogPrintf("magic is ok but data has invalid format, will try to recreate\n");
-        else
-            LogPrintf("file format is unknown or invalid, please fix it manually\n");
-    }
+        CBudgetDB budgetdb;
+        CBudgetDB::ReadResult readResult2 = budgetdb.Read(budget);
 
-    //flag our cached items so we send them to our peers
-    budget.ResetSync();
-    budget.ClearSeen();
+        if (readResult2 == CBudgetDB::FileError)
+            LogPrintf("Missing budget cache - budget.dat, will try to recreate\n");
+        else if (readResult2 != CBudgetDB::Ok) {
+            LogPrintf("Error reading budget.dat: ");
+            if (readResult2 == CBudgetDB::IncorrectFormat)
+                LogPrintf("magic is ok but data has invalid format, will try to recreate\n");
+            else
+                LogPrintf("file format is unknown or invalid, please fix it manually\n");
+        }
 
-    uiInterface.InitMessage(_("Loading masternode payment cache…").translated);
+        uiInterface.InitMessage(_("Loading masternode payment cache…").translated);
 
-    CMasternodePaymentDB mnpayments;
-    CMasternodePaymentDB::ReadResult readResult3 = mnpayments.Read(masternodePayments);
+        CMasternodePaymentDB mnpayments;
+        CMasternodePaymentDB::ReadResult readResult3 = mnpayments.Read(masternodePayments);
 
-    if (readResult3 == CMasternodePaymentDB::FileError)
-        LogPrintf("Missing masternode payment cache - mnpayments.dat, will try to recreate\n");
-    else if (readResult3 != CMasternodePaymentDB::Ok) {
-        LogPrintf("Error reading mnpayments.dat: ");
-        if (readResult3 == CMasternodePaymentDB::IncorrectFormat)
-            LogPrintf("magic is ok but data has invalid format, will try to recreate\n");
-        else
-            LogPrintf("file format is unknown or invalid, please fix it manually\n");
+        if (readResult3 == CMasternodePaymentDB::FileError)
+            LogPrintf("Missing masternode payment cache - mnpayments.dat, will try to recreate\n");
+        else if (readResult3 != CMasternodePaymentDB::Ok) {
+            LogPrintf("Error reading mnpayments.dat: ");
+            if (readResult3 == CMasternodePaymentDB::IncorrectFormat)
+                LogPrintf("magic is ok but data has invalid format, will try to recreate\n");
+            else
+                LogPrintf("file format is unknown or invalid, please fix it manually\n");
+        }
+
+        FlushMasternodeCaches();
     }
 
+    //flag our cached items so we send them to our peers
+    budget.ResetSync();
+    budget.ClearSeen();
+
     fMasterNode = gArgs.GetBoolArg("-masternode", false);
 
     if (fMasterNode)
@@ -1935,6 +1990,7 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
     if (node.peerman) node.peerman->StartScheduledTasks(*node.scheduler);
 
     masternodeThread = std::thread(MasternodeThread, node.connman.get());
+    masternodeMessageQueue.StartWorkerThreads(DEFAULT_MASTERNODE_MESSAGE_THREADS);
 
 #if HAVE_SYSTEM
     StartupNotify(args);
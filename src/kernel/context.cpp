@@ -4,6 +4,7 @@
 
 #include <kernel/context.h>
 
+#include <crypto/scrypt.h>
 #include <crypto/sha256.h>
 #include <key.h>
 #include <logging.h>
@@ -19,6 +20,8 @@ Context::Context()
 {
     std::string sha256_algo = SHA256AutoDetect();
     LogPrintf("Using the '%s' SHA256 implementation\n", sha256_algo);
+    std::string scrypt_algo = ScryptAutoDetect();
+    LogPrintf("Using the '%s' scrypt batch implementation\n", scrypt_algo);
     RandomInit();
     ECC_Start();
     ecc_verify_handle.reset(new ECCVerifyHandle());
@@ -195,13 +195,12 @@ bool CActiveMasternode::SendMasternodePing(std::string& errorMessage, CConnman*
         }
 
         pmn->lastPing = mnp;
-        mnodeman.mapSeenMasternodePing.insert(std::make_pair(mnp.GetHash(), mnp));
+        pmn->fCacheChanged = true;
+        mnodeman.AddSeenPing(mnp);
 
         // mnodeman.mapSeenMasternodeBroadcast.lastPing is probably outdated, so we'll update it
         CMasternodeBroadcast mnb(*pmn);
-        uint256 hash = mnb.GetHash();
-        if (mnodeman.mapSeenMasternodeBroadcast.count(hash))
-            mnodeman.mapSeenMasternodeBroadcast[hash].lastPing = mnp;
+        mnodeman.UpdateSeenBroadcastPing(mnb.GetHash(), mnp);
 
         mnp.Relay(connman);
 
@@ -0,0 +1,243 @@
+// Copyright (c) 2022 The Myce Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <masternode/budgetcollateralindex.h>
+
+#include <chain.h>
+#include <chainparams.h>
+#include <logging.h>
+#include <masternode/masternode-budget.h>
+#include <node/blockstorage.h>
+#include <primitives/block.h>
+#include <script/script.h>
+#include <util/system.h>
+#include <validation.h>
+
+#include <algorithm>
+
+static constexpr uint8_t DB_COLLATERAL_TX{'t'};
+static constexpr uint8_t DB_BEST_BLOCK{'B'};
+
+//! flush the catch-up batch once it grows beyond this size
+static constexpr size_t MAX_CATCHUP_BATCH_SIZE{16 << 20};
+
+std::unique_ptr<CBudgetCollateralIndex> g_budget_collateral_index;
+
+CBudgetCollateralDB::CBudgetCollateralDB(size_t nCacheSize, bool fMemory, bool fWipe)
+    : CDBWrapper(gArgs.GetDataDirNet() / "budgetcollateral", nCacheSize, fMemory, fWipe)
+{
+}
+
+bool CBudgetCollateralDB::ReadEntries(std::vector<std::pair<uint256, CBudgetCollateralEntry>>& vEntries)
+{
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    pcursor->Seek(std::make_pair(DB_COLLATERAL_TX, uint256()));
+
+    while (pcursor->Valid()) {
+        std::pair<uint8_t, uint256> key;
+        if (!pcursor->GetKey(key) || key.first != DB_COLLATERAL_TX) {
+            break;
+        }
+        CBudgetCollateralEntry entry;
+        if (!pcursor->GetValue(entry)) {
+            return error("%s: failed to read value", __func__);
+        }
+        vEntries.emplace_back(key.second, entry);
+        pcursor->Next();
+    }
+    return true;
+}
+
+CBudgetCollateralIndex::CBudgetCollateralIndex(size_t nCacheSize, bool fMemory, bool fWipe)
+    : db(std::make_unique<CBudgetCollateralDB>(nCacheSize, fMemory, fWipe))
+{
+}
+
+bool CBudgetCollateralIndex::GetEntry(const CTransaction& tx, CBudgetCollateralEntry& entry)
+{
+    if (tx.vout.empty() || tx.nLockTime != 0) {
+        return false;
+    }
+
+    entry.vCommitments.clear();
+    for (const CTxOut& out : tx.vout) {
+        const CScript& script = out.scriptPubKey;
+        if (!script.IsNormalPaymentScript() && !script.IsUnspendable()) {
+            return false;
+        }
+        // OP_RETURN <32 byte hash>
+        if (script.size() == 34 && script[0] == OP_RETURN && script[1] == 0x20) {
+            entry.vCommitments.emplace_back(uint256(std::vector<unsigned char>(script.begin() + 2, script.end())), out.nValue);
+        }
+    }
+    return !entry.vCommitments.empty();
+}
+
+void CBudgetCollateralIndex::ConnectLocked(const CBlock& block, const CBlockIndex* pindex, CDBBatch& batch)
+{
+    for (const CTransactionRef& tx : block.vtx) {
+        if (tx->IsCoinBase() || tx->IsCoinStake()) {
+            continue;
+        }
+        CBudgetCollateralEntry entry;
+        if (!GetEntry(*tx, entry)) {
+            continue;
+        }
+        entry.hashBlock = pindex->GetBlockHash();
+        entry.nHeight = pindex->nHeight;
+        entry.nBlockTime = pindex->GetBlockTime();
+        batch.Write(std::make_pair(DB_COLLATERAL_TX, tx->GetHash()), entry);
+        mapEntries[tx->GetHash()] = std::move(entry);
+    }
+
+    hashBestBlock = pindex->GetBlockHash();
+    batch.Write(DB_BEST_BLOCK, hashBestBlock);
+}
+
+void CBudgetCollateralIndex::DisconnectLocked(const CBlock& block, const CBlockIndex* pindex, CDBBatch& batch)
+{
+    for (const CTransactionRef& tx : block.vtx) {
+        auto it = mapEntries.find(tx->GetHash());
+        if (it == mapEntries.end() || it->second.hashBlock != pindex->GetBlockHash()) {
+            continue;
+        }
+        mapEntries.erase(it);
+        batch.Erase(std::make_pair(DB_COLLATERAL_TX, tx->GetHash()));
+    }
+
+    hashBestBlock = pindex->pprev ? pindex->pprev->GetBlockHash() : uint256();
+    batch.Write(DB_BEST_BLOCK, hashBestBlock);
+}
+
+bool CBudgetCollateralIndex::Init(Chainstate& chainstate)
+{
+    AssertLockNotHeld(::cs_main);
+
+    std::vector<std::pair<uint256, CBudgetCollateralEntry>> vStored;
+    if (!db->ReadEntries(vStored)) {
+        return error("%s: failed to read budget collateral index", __func__);
+    }
+    uint256 hashStored;
+    const bool fStored = db->Read(DB_BEST_BLOCK, hashStored);
+
+    // only the active chain is looked at under cs_main, the blocks are read without it
+    CDBBatch batch(*db);
+    std::vector<const CBlockIndex*> vConnect;
+    uint256 hashTip;
+    int nStart;
+    {
+        LOCK(::cs_main);
+        const CChain& chain = chainstate.m_chain;
+
+        // keep only entries that still describe the active chain
+        for (auto it = vStored.begin(); it != vStored.end();) {
+            const CBudgetCollateralEntry& entry = it->second;
+            const bool fValid = entry.nHeight >= 0 && entry.nHeight <= chain.Height() &&
+                                chain[entry.nHeight]->GetBlockHash() == entry.hashBlock;
+            if (!fValid) {
+                batch.Erase(std::make_pair(DB_COLLATERAL_TX, it->first));
+                it = vStored.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        // a new index reads the last few payment cycles, which hold the collateral of
+        // the proposals and budgets that can still be voted on. A stored index resumes
+        // after the last block both it and the active chain have, but reads no further
+        // back than a new one, as it may lag far behind a pruned chain.
+        nStart = std::max(0, chain.Height() - BUDGET_COLLATERAL_INDEX_CYCLES * GetBudgetPaymentCycleBlocks());
+        if (fStored) {
+            const CBlockIndex* pindexStored = chainstate.m_blockman.LookupBlockIndex(hashStored);
+            const CBlockIndex* pindexFork = pindexStored ? chain.FindFork(pindexStored) : nullptr;
+            if (pindexFork) {
+                nStart = std::max(nStart, pindexFork->nHeight + 1);
+            }
+        }
+
+        for (int nHeight = nStart; nHeight <= chain.Height(); ++nHeight) {
+            // pruned blocks are skipped, their collateral is only found through -txindex
+            if (chain[nHeight]->nStatus & BLOCK_HAVE_DATA) {
+                vConnect.push_back(chain[nHeight]);
+            }
+        }
+        if (chain.Tip()) {
+            hashTip = chain.Tip()->GetBlockHash();
+        }
+    }
+
+    LOCK(cs);
+    mapEntries.clear();
+    hashBestBlock.SetNull();
+    for (auto& [txid, entry] : vStored) {
+        mapEntries.emplace(txid, std::move(entry));
+    }
+
+    const Consensus::Params& params = Params().GetConsensus();
+    for (const CBlockIndex* pindex : vConnect) {
+        CBlock block;
+        if (!node::ReadBlockFromDisk(block, pindex, params)) {
+            return error("%s: failed to read block %s", __func__, pindex->GetBlockHash().ToString());
+        }
+        ConnectLocked(block, pindex, batch);
+        if (batch.SizeEstimate() > MAX_CATCHUP_BATCH_SIZE) {
+            if (!db->WriteBatch(batch)) {
+                return error("%s: failed to write budget collateral index", __func__);
+            }
+            batch.Clear();
+        }
+    }
+    if (!hashTip.IsNull()) {
+        hashBestBlock = hashTip;
+        batch.Write(DB_BEST_BLOCK, hashBestBlock);
+    }
+    if (!db->WriteBatch(batch, true)) {
+        return error("%s: failed to write budget collateral index", __func__);
+    }
+
+    LogPrint(BCLog::MNBUDGET, "%s: loaded %u budget collateral entries, replayed from height %d\n", __func__, mapEntries.size(), nStart);
+    return true;
+}
+
+void CBudgetCollateralIndex::BlockConnected(const CBlock& block, const CBlockIndex* pindex)
+{
+    LOCK(cs);
+    if (!pindex->pprev || pindex->pprev->GetBlockHash() != hashBestBlock) {
+        LogPrint(BCLog::MNBUDGET, "%s: block %s at height %d does not extend the index\n", __func__, pindex->GetBlockHash().ToString(), pindex->nHeight);
+    }
+
+    CDBBatch batch(*db);
+    ConnectLocked(block, pindex, batch);
+    db->WriteBatch(batch);
+}
+
+void CBudgetCollateralIndex::BlockDisconnected(const CBlock& block, const CBlockIndex* pindex)
+{
+    LOCK(cs);
+    CDBBatch batch(*db);
+    DisconnectLocked(block, pindex, batch);
+    db->WriteBatch(batch);
+}
+
+bool CBudgetCollateralIndex::Lookup(const uint256& txid, CBudgetCollateralEntry& entry) const
+{
+    LOCK(cs);
+    auto it = mapEntries.find(txid);
+    if (it == mapEntries.end()) {
+        return false;
+    }
+    entry = it->second;
+    return true;
+}
+
+void CBudgetCollateralIndex::Add(const uint256& txid, const CBudgetCollateralEntry& entry)
+{
+    LOCK(cs);
+    if (!mapEntries.emplace(txid, entry).second) {
+        return;
+    }
+    CDBBatch batch(*db);
+    batch.Write(std::make_pair(DB_COLLATERAL_TX, txid), entry);
+    db->WriteBatch(batch);
+}
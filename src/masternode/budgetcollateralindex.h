@@ -0,0 +1,104 @@
+// Copyright (c) 2022 The Myce Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef MASTERNODE_BUDGETCOLLATERALINDEX_H
+#define MASTERNODE_BUDGETCOLLATERALINDEX_H
+
+#include <consensus/amount.h>
+#include <dbwrapper.h>
+#include <primitives/transaction.h>
+#include <serialize.h>
+#include <sync.h>
+#include <uint256.h>
+#include <util/hasher.h>
+
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+//! budget payment cycles below the tip that a new index reads
+static const int BUDGET_COLLATERAL_INDEX_CYCLES = 4;
+
+class CBlock;
+class CBlockIndex;
+class Chainstate;
+
+extern RecursiveMutex cs_main;
+
+/**
+ * A transaction of the active chain that can pay a budget proposal or
+ * finalization fee: it has no lock time, only standard and unspendable
+ * outputs, and at least one output committing to a hash with OP_RETURN.
+ */
+struct CBudgetCollateralEntry
+{
+    //! committed hash and amount of each OP_RETURN <hash> output
+    std::vector<std::pair<uint256, CAmount>> vCommitments;
+    uint256 hashBlock;
+    int nHeight{0};
+    int64_t nBlockTime{0};
+
+    SERIALIZE_METHODS(CBudgetCollateralEntry, obj)
+    {
+        READWRITE(obj.vCommitments, obj.hashBlock, obj.nHeight, obj.nBlockTime);
+    }
+};
+
+class CBudgetCollateralDB : public CDBWrapper
+{
+public:
+    CBudgetCollateralDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+
+private:
+    CBudgetCollateralDB(const CBudgetCollateralDB&);
+    void operator=(const CBudgetCollateralDB&);
+
+public:
+    bool ReadEntries(std::vector<std::pair<uint256, CBudgetCollateralEntry>>& vEntries);
+};
+
+/**
+ * Budget fee transactions of the active chain by txid, filled as blocks are
+ * connected and emptied as they are disconnected, so that collateral checks
+ * don't read the transaction from disk and don't need -txindex.
+ *
+ * A new index reads the blocks of the last BUDGET_COLLATERAL_INDEX_CYCLES
+ * budget payment cycles, and so does one that lags further behind; pruned
+ * blocks are skipped. Collateral confirmed in the blocks not read is only
+ * found through -txindex, and remembered once it is.
+ */
+class CBudgetCollateralIndex
+{
+private:
+    mutable Mutex cs;
+    std::unique_ptr<CBudgetCollateralDB> db;
+    std::unordered_map<uint256, CBudgetCollateralEntry, SaltedTxidHasher> mapEntries GUARDED_BY(cs);
+    //! last block the index was updated for
+    uint256 hashBestBlock GUARDED_BY(cs);
+
+    void ConnectLocked(const CBlock& block, const CBlockIndex* pindex, CDBBatch& batch) EXCLUSIVE_LOCKS_REQUIRED(cs);
+    void DisconnectLocked(const CBlock& block, const CBlockIndex* pindex, CDBBatch& batch) EXCLUSIVE_LOCKS_REQUIRED(cs);
+
+public:
+    CBudgetCollateralIndex(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+
+    /** Get the fee outputs of tx, returns false if it can't pay a budget fee */
+    static bool GetEntry(const CTransaction& tx, CBudgetCollateralEntry& entry);
+
+    /** Load the entries, drop the ones no longer on the active chain and catch up to the tip. Reads the blocks without cs_main. */
+    bool Init(Chainstate& chainstate) EXCLUSIVE_LOCKS_REQUIRED(!::cs_main);
+
+    void BlockConnected(const CBlock& block, const CBlockIndex* pindex);
+    void BlockDisconnected(const CBlock& block, const CBlockIndex* pindex);
+
+    bool Lookup(const uint256& txid, CBudgetCollateralEntry& entry) const;
+
+    /** Remember a transaction of the active chain that was found some other way */
+    void Add(const uint256& txid, const CBudgetCollateralEntry& entry);
+};
+
+extern std::unique_ptr<CBudgetCollateralIndex> g_budget_collateral_index;
+
+#endif // MASTERNODE_BUDGETCOLLATERALINDEX_H
@@ -8,9 +8,7 @@
 #include <masternode/masternode-budget.h>
 #include <fs.h>
 
-void DumpBudgets(CBudgetManager& budgetman);
-
-/** Save Budget Manager (budget.dat)
+/** Reader of the old Budget Manager data (budget.dat), moved to CMasternodeCacheDB on first start
  */
 class CBudgetDB
 {
@@ -30,7 +28,6 @@ public:
     };
 
     CBudgetDB();
-    bool Write(const CBudgetManager& objToSave);
     ReadResult Read(CBudgetManager& objToLoad, bool fDryRun = false);
 };
 
@@ -9,6 +9,8 @@
 #include <masternode/masternode-budget.h>
 #include <masternode/masternode-payments.h>
 #include <masternode/masternode-sync.h>
+#include <masternode/messagequeue.h>
+#include <masternode/mncachedb.h>
 #include <masternode/spork.h>
 #include <shutdown.h>
 #include <util/system.h>
@@ -19,6 +21,7 @@ CMasternodeMan mnodeman;
 CMasternodePayments masternodePayments;
 CMasternodeSync masternodeSync;
 CSporkManager sporkManager;
+CMasternodeMessageQueue masternodeMessageQueue;
 
 std::thread masternodeThread;
 
@@ -54,6 +57,9 @@ void MasternodeThread(CConnman* connman)
                 mnodeman.ProcessMasternodeConnections(*connman);
                 masternodePayments.CleanPaymentList();
             }
+            if (c % MASTERNODE_CACHE_FLUSH_SECONDS == 0) {
+                FlushMasternodeCaches();
+            }
         }
     }
 }
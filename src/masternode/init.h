@@ -14,6 +14,7 @@ class CBudgetManager;
 class CMasternodeMan;
 class CMasternodePayments;
 class CMasternodeSync;
+class CMasternodeMessageQueue;
 class CSporkManager;
 
 extern CActiveMasternode activeMasternode;
@@ -22,6 +23,7 @@ extern CMasternodeMan mnodeman;
 extern CMasternodePayments masternodePayments;
 extern CMasternodeSync masternodeSync;
 extern CSporkManager sporkManager;
+extern CMasternodeMessageQueue masternodeMessageQueue;
 
 extern std::thread masternodeThread;
 
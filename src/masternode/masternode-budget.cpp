@@ -11,11 +11,13 @@
 #include <key_io.h>
 #include <masternode/init.h>
 #include <masternode/activemasternode.h>
+#include <masternode/budgetcollateralindex.h>
 #include <masternode/budgetdb.h>
 #include <masternode/masternode-sync.h>
 #include <masternode/masternode.h>
 #include <masternode/masternodeman.h>
 #include <masternode/masternodesigner.h>
+#include <masternode/mncachedb.h>
 #include <pos/wallet.h>
 #include <util/system.h>
 #include <validation.h>
@@ -43,53 +45,51 @@ bool IsBudgetCollateralValid(uint256 nTxCollateralHash, uint256 nExpectedHash, s
 {
     const Consensus::Params& params = Params().GetConsensus();
 
-    uint256 nBlockHash;
-    CTransactionRef txCollateral = node::GetTransaction(nullptr, nullptr, nTxCollateralHash, params, nBlockHash);
-    if (!txCollateral) {
-        strError = strprintf("Can't find collateral tx %s", txCollateral->ToString());
-        LogPrint(BCLog::MNBUDGET, "CBudgetProposalBroadcast::IsBudgetCollateralValid - %s\n", strError);
-        return false;
-    }
-
-    if (txCollateral->vout.size() < 1)
-        return false;
-    if (txCollateral->nLockTime != 0)
-        return false;
-
-    CScript findScript;
-    findScript << OP_RETURN << ToByteVector(nExpectedHash);
+    CBudgetCollateralEntry entry;
+    if (!g_budget_collateral_index || !g_budget_collateral_index->Lookup(nTxCollateralHash, entry)) {
+        // not indexed, it may have confirmed before the index was created
+        uint256 nBlockHash;
+        CTransactionRef txCollateral = node::GetTransaction(nullptr, nullptr, nTxCollateralHash, params, nBlockHash);
+        if (!txCollateral) {
+            strError = strprintf("Can't find collateral tx %s", nTxCollateralHash.ToString());
+            LogPrint(BCLog::MNBUDGET, "CBudgetProposalBroadcast::IsBudgetCollateralValid - %s\n", strError);
+            return false;
+        }
 
-    bool foundOpReturn = false;
-    for (const CTxOut& o : txCollateral->vout) {
-        if (!o.scriptPubKey.IsNormalPaymentScript() && !o.scriptPubKey.IsUnspendable()) {
-            strError = strprintf("Invalid Script %s", txCollateral->ToString());
+        if (!CBudgetCollateralIndex::GetEntry(*txCollateral, entry)) {
+            strError = strprintf("Invalid collateral tx %s", txCollateral->ToString());
             LogPrint(BCLog::MNBUDGET, "CBudgetProposalBroadcast::IsBudgetCollateralValid - %s\n", strError);
             return false;
         }
-        if (fBudgetFinalization) {
-            // Collateral for budget finalization
-            // Note: there are still old valid budgets out there, but the check for the new 5 YCE finalization collateral
-            //       will also cover the old 50 YCE finalization collateral.
-            LogPrint(BCLog::MNBUDGET, "Final Budget: o.scriptPubKey(%s) == findScript(%s) ?\n", o.scriptPubKey.ToString(), findScript.ToString());
-            if (o.scriptPubKey == findScript) {
-                LogPrint(BCLog::MNBUDGET, "Final Budget: o.nValue(%ld) >= BUDGET_FEE_TX(%ld) ?\n", o.nValue, BUDGET_FEE_TX);
-                if (o.nValue >= BUDGET_FEE_TX) {
-                    foundOpReturn = true;
-                }
-            }
-        } else {
-            // Collateral for normal budget proposal
-            LogPrint(BCLog::MNBUDGET, "Normal Budget: o.scriptPubKey(%s) == findScript(%s) ?\n", o.scriptPubKey.ToString(), findScript.ToString());
-            if (o.scriptPubKey == findScript) {
-                LogPrint(BCLog::MNBUDGET, "Normal Budget: o.nValue(%ld) >= PROPOSAL_FEE_TX(%ld) ?\n", o.nValue, PROPOSAL_FEE_TX);
-                if (o.nValue >= PROPOSAL_FEE_TX) {
-                    foundOpReturn = true;
+
+        if (nBlockHash != uint256()) {
+            node::BlockMap::iterator mi = chainstate.m_chainman.m_blockman.m_block_index.find(nBlockHash);
+            if (mi != chainstate.m_chainman.m_blockman.m_block_index.end()) {
+                CBlockIndex* pindex = &(*mi).second;
+                if (chainstate.m_chainman.ActiveChain().Contains(pindex)) {
+                    entry.hashBlock = pindex->GetBlockHash();
+                    entry.nHeight = pindex->nHeight;
+                    entry.nBlockTime = pindex->GetBlockTime();
+                    if (g_budget_collateral_index)
+                        g_budget_collateral_index->Add(nTxCollateralHash, entry);
                 }
             }
         }
     }
+
+    // Note: there are still old valid budgets out there, but the check for the new 5 YCE finalization collateral
+    //       will also cover the old 50 YCE finalization collateral.
+    const CAmount nFee = fBudgetFinalization ? BUDGET_FEE_TX : PROPOSAL_FEE_TX;
+
+    bool foundOpReturn = false;
+    for (const auto& [hash, nValue] : entry.vCommitments) {
+        LogPrint(BCLog::MNBUDGET, "%s: commitment %s == %s, value %ld >= %ld ?\n", fBudgetFinalization ? "Final Budget" : "Normal Budget", hash.ToString(), nExpectedHash.ToString(), nValue, nFee);
+        if (hash == nExpectedHash && nValue >= nFee) {
+            foundOpReturn = true;
+        }
+    }
     if (!foundOpReturn) {
-        strError = strprintf("Couldn't find opReturn %s in %s", nExpectedHash.ToString(), txCollateral->ToString());
+        strError = strprintf("Couldn't find opReturn %s in %s", nExpectedHash.ToString(), nTxCollateralHash.ToString());
         LogPrint(BCLog::MNBUDGET, "CBudgetProposalBroadcast::IsBudgetCollateralValid - %s\n", strError);
         return false;
     }
@@ -101,15 +101,9 @@ bool IsBudgetCollateralValid(uint256 nTxCollateralHash, uint256 nExpectedHash, s
     */
 
     int conf = GetIXConfirmations(nTxCollateralHash);
-    if (nBlockHash != uint256()) {
-        node::BlockMap::iterator mi = chainstate.m_chainman.m_blockman.m_block_index.find(nBlockHash);
-        if (mi != chainstate.m_chainman.m_blockman.m_block_index.end() && &(*mi).second) {
-            CBlockIndex* pindex = &(*mi).second;
-            if (chainstate.m_chainman.ActiveChain().Contains(pindex)) {
-                conf += chainstate.m_chainman.ActiveChain().Height() - pindex->nHeight + 1;
-                nTime = pindex->nTime;
-            }
-        }
+    if (!entry.hashBlock.IsNull()) {
+        conf += chainstate.m_chainman.ActiveChain().Height() - entry.nHeight + 1;
+        nTime = entry.nBlockTime;
     }
 
     nConf = conf;
@@ -133,6 +127,7 @@ void CBudgetManager::CheckOrphanVotes(CConnman& connman)
     while (it1 != mapOrphanMasternodeBudgetVotes.end()) {
         if (budget.UpdateProposal(((*it1).second), NULL, connman, strError)) {
             LogPrint(BCLog::MNBUDGET, "CBudgetManager::CheckOrphanVotes - Proposal/Budget is known, activating and removing orphan vote\n");
+            changedOrphanProposalVotes.Set((*it1).first);
             mapOrphanMasternodeBudgetVotes.erase(it1++);
         } else {
             ++it1;
@@ -142,6 +137,7 @@ void CBudgetManager::CheckOrphanVotes(CConnman& connman)
     while (it2 != mapOrphanFinalizedBudgetVotes.end()) {
         if (budget.UpdateFinalizedBudget(((*it2).second), NULL, connman, strError)) {
             LogPrint(BCLog::MNBUDGET, "CBudgetManager::CheckOrphanVotes - Proposal/Budget is known, activating and removing orphan vote\n");
+            changedOrphanFinalizedBudgetVotes.Set((*it2).first);
             mapOrphanFinalizedBudgetVotes.erase(it2++);
         } else {
             ++it2;
@@ -277,6 +273,7 @@ void CBudgetManager::SubmitFinalBudget(CBlockIndex* pindex, CConnman& connman, C
 
     LOCK(cs);
     mapSeenFinalizedBudgets.insert(std::make_pair(finalizedBudgetBroadcast.GetHash(), finalizedBudgetBroadcast));
+    changedSeenFinalizedBudgets.Set(finalizedBudgetBroadcast.GetHash());
     finalizedBudgetBroadcast.Relay(&connman);
     budget.AddFinalizedBudget(finalizedBudgetBroadcast, pindex);
     nSubmittedHeight = nCurrentHeight;
@@ -294,6 +291,7 @@ bool CBudgetManager::AddFinalizedBudget(CFinalizedBudget& finalizedBudget, CBloc
     }
 
     mapFinalizedBudgets.insert(std::make_pair(finalizedBudget.GetHash(), finalizedBudget));
+    changedFinalizedBudgets.Set(finalizedBudget.GetHash());
     return true;
 }
 
@@ -310,11 +308,102 @@ bool CBudgetManager::AddProposal(CBudgetProposal& budgetProposal, CBlockIndex* p
         return false;
     }
 
-    mapProposals.insert(std::make_pair(budgetProposal.GetHash(), budgetProposal));
+    const uint256 nHash = budgetProposal.GetHash();
+    mapProposals.insert(std::make_pair(nHash, budgetProposal));
+    changedProposals.Set(nHash);
+    setProposalsByVotes.insert({budgetProposal.GetNetVotes(), budgetProposal.nFeeTXHash, nHash});
     LogPrint(BCLog::MNBUDGET, "CBudgetManager::AddProposal - proposal %s added\n", budgetProposal.GetName().c_str());
     return true;
 }
 
+void CBudgetManager::UpdateProposalRank(const uint256& nHash, const CBudgetProposal& proposal, int nNetVotesOld)
+{
+    AssertLockHeld(cs);
+
+    if (proposal.GetNetVotes() == nNetVotesOld)
+        return;
+    setProposalsByVotes.erase({nNetVotesOld, proposal.nFeeTXHash, nHash});
+    setProposalsByVotes.insert({proposal.GetNetVotes(), proposal.nFeeTXHash, nHash});
+}
+
+void CBudgetManager::RebuildProposalRanks()
+{
+    AssertLockHeld(cs);
+
+    setProposalsByVotes.clear();
+    for (const auto& item : mapProposals) {
+        setProposalsByVotes.insert({item.second.GetNetVotes(), item.second.nFeeTXHash, item.first});
+    }
+}
+
+void CBudgetManager::RebuildVoteLocations()
+{
+    AssertLockHeld(cs);
+
+    mapProposalVoteLocations.clear();
+    for (auto& item : mapProposals) {
+        for (auto& vote : item.second.mapVotes) {
+            mapProposalVoteLocations[vote.second.GetHash()] = std::make_pair(item.first, vote.first);
+        }
+    }
+
+    mapFinalizedBudgetVoteLocations.clear();
+    for (auto& item : mapFinalizedBudgets) {
+        for (auto& vote : item.second.mapVotes) {
+            mapFinalizedBudgetVoteLocations[vote.second.GetHash()] = std::make_pair(item.first, vote.first);
+        }
+    }
+}
+
+bool CBudgetManager::GetProposalVote(const uint256& nHash, CBudgetVote& vote)
+{
+    LOCK(cs);
+
+    auto itSeen = mapSeenMasternodeBudgetVotes.find(nHash);
+    if (itSeen != mapSeenMasternodeBudgetVotes.end()) {
+        vote = itSeen->second;
+        return true;
+    }
+
+    // Sync announces every vote of a proposal, also ones the seen cache no longer holds
+    auto itLocation = mapProposalVoteLocations.find(nHash);
+    if (itLocation == mapProposalVoteLocations.end())
+        return false;
+    auto itProposal = mapProposals.find(itLocation->second.first);
+    if (itProposal == mapProposals.end())
+        return false;
+    auto itVote = itProposal->second.mapVotes.find(itLocation->second.second);
+    if (itVote == itProposal->second.mapVotes.end() || itVote->second.GetHash() != nHash)
+        return false;
+
+    vote = itVote->second;
+    return true;
+}
+
+bool CBudgetManager::GetFinalizedBudgetVote(const uint256& nHash, CFinalizedBudgetVote& vote)
+{
+    LOCK(cs);
+
+    auto itSeen = mapSeenFinalizedBudgetVotes.find(nHash);
+    if (itSeen != mapSeenFinalizedBudgetVotes.end()) {
+        vote = itSeen->second;
+        return true;
+    }
+
+    auto itLocation = mapFinalizedBudgetVoteLocations.find(nHash);
+    if (itLocation == mapFinalizedBudgetVoteLocations.end())
+        return false;
+    auto itBudget = mapFinalizedBudgets.find(itLocation->second.first);
+    if (itBudget == mapFinalizedBudgets.end())
+        return false;
+    auto itVote = itBudget->second.mapVotes.find(itLocation->second.second);
+    if (itVote == itBudget->second.mapVotes.end() || itVote->second.GetHash() != nHash)
+        return false;
+
+    vote = itVote->second;
+    return true;
+}
+
 void CBudgetManager::CheckAndRemove(CBlockIndex* pindex, CConnman* connman)
 {
     int nHeight = 0;
@@ -346,8 +435,13 @@ void CBudgetManager::CheckAndRemove(CBlockIndex* pindex, CConnman* connman)
         }
 
         if (pfinalizedBudget->fValid) {
+            const bool fAutoCheckedOld = pfinalizedBudget->IsAutoChecked();
             pfinalizedBudget->CheckAndVote(pindex, connman);
+            if (pfinalizedBudget->IsAutoChecked() != fAutoCheckedOld)
+                changedFinalizedBudgets.Set((*it).first);
             tmpMapFinalizedBudgets.insert(std::make_pair(pfinalizedBudget->GetHash(), *pfinalizedBudget));
+        } else {
+            changedFinalizedBudgets.Set((*it).first);
         }
 
         ++it;
@@ -367,6 +461,9 @@ void CBudgetManager::CheckAndRemove(CBlockIndex* pindex, CConnman* connman)
         }
         if (pbudgetProposal->fValid) {
             tmpMapProposals.insert(std::make_pair(pbudgetProposal->GetHash(), *pbudgetProposal));
+        } else {
+            setProposalsByVotes.erase({pbudgetProposal->GetNetVotes(), pbudgetProposal->nFeeTXHash, (*it2).first});
+            changedProposals.Set((*it2).first);
         }
 
         ++it2;
@@ -374,6 +471,10 @@ void CBudgetManager::CheckAndRemove(CBlockIndex* pindex, CConnman* connman)
     // Remove invalid entries by overwriting complete map
     mapFinalizedBudgets.swap(tmpMapFinalizedBudgets);
     mapProposals.swap(tmpMapProposals);
+    {
+        LOCK(cs);
+        RebuildVoteLocations();
+    }
 
     // clang doesn't accept copy assignemnts :-/
     // mapFinalizedBudgets = tmpMapFinalizedBudgets;
@@ -589,7 +690,9 @@ std::vector<CBudgetProposal*> CBudgetManager::GetAllProposals()
 
     std::map<uint256, CBudgetProposal>::iterator it = mapProposals.begin();
     while (it != mapProposals.end()) {
+        int nNetVotesOld = (*it).second.GetNetVotes();
         (*it).second.CleanAndRemove(false);
+        UpdateProposalRank((*it).first, (*it).second, nNetVotesOld);
 
         CBudgetProposal* pbudgetProposal = &((*it).second);
         vBudgetProposalRet.push_back(pbudgetProposal);
@@ -600,39 +703,10 @@ std::vector<CBudgetProposal*> CBudgetManager::GetAllProposals()
     return vBudgetProposalRet;
 }
 
-//
-// Sort by votes, if there's a tie sort by their feeHash TX
-//
-struct sortProposalsByVotes {
-    bool operator()(const std::pair<CBudgetProposal*, int>& left, const std::pair<CBudgetProposal*, int>& right)
-    {
-        if (left.second != right.second) {
-            return (left.second > right.second);
-        }
-        return (UintToArith256(left.first->nFeeTXHash) > UintToArith256(right.first->nFeeTXHash));
-    }
-};
-
-// Need to review this function
 std::vector<CBudgetProposal*> CBudgetManager::GetBudget(CBlockIndex* pindex)
 {
     LOCK(cs);
 
-    // ------- Sort budgets by Yes Count
-
-    std::vector<std::pair<CBudgetProposal*, int>> vBudgetPorposalsSort;
-
-    std::map<uint256, CBudgetProposal>::iterator it = mapProposals.begin();
-    while (it != mapProposals.end()) {
-        (*it).second.CleanAndRemove(false);
-        vBudgetPorposalsSort.push_back(std::make_pair(&((*it).second), (*it).second.GetYeas() - (*it).second.GetNays()));
-        ++it;
-    }
-
-    std::sort(vBudgetPorposalsSort.begin(), vBudgetPorposalsSort.end(), sortProposalsByVotes());
-
-    // ------- Grab The Budgets In Order
-
     std::vector<CBudgetProposal*> vBudgetProposalsRet;
 
     CAmount nBudgetAllocated = 0;
@@ -646,9 +720,17 @@ std::vector<CBudgetProposal*> CBudgetManager::GetBudget(CBlockIndex* pindex)
     int mnCount = mnodeman.CountEnabled(PROTOCOL_VERSION - 1);
     CAmount nTotalBudget = GetTotalBudget(nBlockStart);
 
-    std::vector<std::pair<CBudgetProposal*, int>>::iterator it2 = vBudgetPorposalsSort.begin();
-    while (it2 != vBudgetPorposalsSort.end()) {
-        CBudgetProposal* pbudgetProposal = (*it2).first;
+    // ------- Grab The Budgets In Order, sorted by net yes votes; their votes are cleaned on every new block
+
+    for (const CProposalRank& rank : setProposalsByVotes) {
+        // the rest have too few votes to pass
+        if (rank.nNetVotes <= mnCount / 10)
+            break;
+
+        auto it = mapProposals.find(rank.nHash);
+        if (it == mapProposals.end())
+            continue;
+        CBudgetProposal* pbudgetProposal = &((*it).second);
 
         LogPrint(BCLog::MNBUDGET, "CBudgetManager::GetBudget() - Processing Budget %s\n", pbudgetProposal->strProposalName);
         // prop start/end should be inside this period
@@ -670,11 +752,9 @@ std::vector<CBudgetProposal*> CBudgetManager::GetBudget(CBlockIndex* pindex)
         } else {
             LogPrint(BCLog::MNBUDGET, "CBudgetManager::GetBudget() -   Check 1 failed: valid=%d | %ld <= %ld | %ld >= %ld | Yeas=%d Nays=%d Count=%d | established=%d\n",
                 pbudgetProposal->fValid, pbudgetProposal->nBlockStart, nBlockStart, pbudgetProposal->nBlockEnd,
-                nBlockEnd, pbudgetProposal->GetYeas(), pbudgetProposal->GetNays(), mnodeman.CountEnabled(PROTOCOL_VERSION - 1) / 10,
+                nBlockEnd, pbudgetProposal->GetYeas(), pbudgetProposal->GetNays(), mnCount / 10,
                 pbudgetProposal->IsEstablished());
         }
-
-        ++it2;
     }
 
     return vBudgetProposalsRet;
@@ -811,7 +891,9 @@ void CBudgetManager::NewBlock(CBlockIndex* pindex, CConnman* connman, Chainstate
     LogPrint(BCLog::MNBUDGET, "CBudgetManager::NewBlock - mapProposals cleanup - size: %d\n", mapProposals.size());
     std::map<uint256, CBudgetProposal>::iterator it2 = mapProposals.begin();
     while (it2 != mapProposals.end()) {
+        int nNetVotesOld = (*it2).second.GetNetVotes();
         (*it2).second.CleanAndRemove(false);
+        UpdateProposalRank((*it2).first, (*it2).second, nNetVotesOld);
         ++it2;
     }
 
@@ -908,7 +990,7 @@ void CBudgetManager::ProcessMessage(CNode* pfrom, const std::string& strCommand,
         CBudgetProposalBroadcast budgetProposalBroadcast;
         vRecv >> budgetProposalBroadcast;
 
-        if (mapSeenMasternodeBudgetProposals.count(budgetProposalBroadcast.GetHash())) {
+        if (WITH_LOCK(cs, return mapSeenMasternodeBudgetProposals.count(budgetProposalBroadcast.GetHash()))) {
             masternodeSync.AddedBudgetItem(budgetProposalBroadcast.GetHash());
             return;
         }
@@ -922,7 +1004,11 @@ void CBudgetManager::ProcessMessage(CNode* pfrom, const std::string& strCommand,
             return;
         }
 
-        mapSeenMasternodeBudgetProposals.insert(std::make_pair(budgetProposalBroadcast.GetHash(), budgetProposalBroadcast));
+        {
+            LOCK(cs);
+            mapSeenMasternodeBudgetProposals.insert(std::make_pair(budgetProposalBroadcast.GetHash(), budgetProposalBroadcast));
+            changedSeenProposals.Set(budgetProposalBroadcast.GetHash());
+        }
 
         if (!budgetProposalBroadcast.IsValid(pindex, strError)) {
             LogPrint(BCLog::MNBUDGET, "mprop - invalid budget proposal - %s\n", strError);
@@ -952,8 +1038,7 @@ void CBudgetManager::ProcessMessage(CNode* pfrom, const std::string& strCommand,
             return;
         }
 
-        CMasternode* pmn = mnodeman.Find(vote.vin);
-        if (!pmn) {
+        if (!mnodeman.Find(vote.vin)) {
             LogPrint(BCLog::MNBUDGET, "mvote - unknown masternode - vin: %s\n", vote.vin.prevout.hash.ToString());
             mnodeman.AskForMN(pfrom, vote.vin, connman);
             return;
@@ -984,7 +1069,7 @@ void CBudgetManager::ProcessMessage(CNode* pfrom, const std::string& strCommand,
         CFinalizedBudgetBroadcast finalizedBudgetBroadcast;
         vRecv >> finalizedBudgetBroadcast;
 
-        if (mapSeenFinalizedBudgets.count(finalizedBudgetBroadcast.GetHash())) {
+        if (WITH_LOCK(cs, return mapSeenFinalizedBudgets.count(finalizedBudgetBroadcast.GetHash()))) {
             masternodeSync.AddedBudgetItem(finalizedBudgetBroadcast.GetHash());
             return;
         }
@@ -999,7 +1084,11 @@ void CBudgetManager::ProcessMessage(CNode* pfrom, const std::string& strCommand,
             return;
         }
 
-        mapSeenFinalizedBudgets.insert(std::make_pair(finalizedBudgetBroadcast.GetHash(), finalizedBudgetBroadcast));
+        {
+            LOCK(cs);
+            mapSeenFinalizedBudgets.insert(std::make_pair(finalizedBudgetBroadcast.GetHash(), finalizedBudgetBroadcast));
+            changedSeenFinalizedBudgets.Set(finalizedBudgetBroadcast.GetHash());
+        }
 
         if (!finalizedBudgetBroadcast.IsValid(pindex, strError)) {
             LogPrint(BCLog::MNBUDGET, "fbs - invalid finalized budget - %s\n", strError);
@@ -1029,8 +1118,8 @@ void CBudgetManager::ProcessMessage(CNode* pfrom, const std::string& strCommand,
             return;
         }
 
-        CMasternode* pmn = mnodeman.Find(vote.vin);
-        if (!pmn) {
+        CPubKey pubKeyMasternode;
+        if (!mnodeman.GetMasternodePubKey(vote.vin, pubKeyMasternode)) {
             LogPrint(BCLog::MNBUDGET, "fbvote - unknown masternode - vin: %s\n", vote.vin.prevout.hash.ToString());
             mnodeman.AskForMN(pfrom, vote.vin, connman);
             return;
@@ -1039,7 +1128,7 @@ void CBudgetManager::ProcessMessage(CNode* pfrom, const std::string& strCommand,
         mapSeenFinalizedBudgetVotes.insert(std::make_pair(vote.GetHash(), vote));
         if (!vote.SignatureValid(true)) {
             if (masternodeSync.IsSynced()) {
-                LogPrintf("CBudgetManager::ProcessMessage() : fbvote - signature from masternode %s invalid\n", HexStr(pmn->pubKeyMasternode));
+                LogPrintf("CBudgetManager::ProcessMessage() : fbvote - signature from masternode %s invalid\n", HexStr(pubKeyMasternode));
                 //Misbehaving(pfrom->GetId(), 20);
             }
             // it could just be a non-synced masternode
@@ -1052,9 +1141,9 @@ void CBudgetManager::ProcessMessage(CNode* pfrom, const std::string& strCommand,
             vote.Relay(connman);
             masternodeSync.AddedBudgetItem(vote.GetHash());
 
-            LogPrint(BCLog::MNBUDGET, "fbvote - new finalized budget vote - %s from masternode %s\n", vote.GetHash().ToString(), HexStr(pmn->pubKeyMasternode));
+            LogPrint(BCLog::MNBUDGET, "fbvote - new finalized budget vote - %s from masternode %s\n", vote.GetHash().ToString(), HexStr(pubKeyMasternode));
         } else {
-            LogPrint(BCLog::MNBUDGET, "fbvote - rejected finalized budget vote - %s from masternode %s - %s\n", vote.GetHash().ToString(), HexStr(pmn->pubKeyMasternode), strError);
+            LogPrint(BCLog::MNBUDGET, "fbvote - rejected finalized budget vote - %s from masternode %s - %s\n", vote.GetHash().ToString(), HexStr(pubKeyMasternode), strError);
         }
     }
 }
@@ -1221,6 +1310,7 @@ bool CBudgetManager::UpdateProposal(CBudgetVote& vote, CNode* pfrom, CConnman& c
 
             LogPrint(BCLog::MNBUDGET, "CBudgetManager::UpdateProposal - Unknown proposal %d, asking for source proposal\n", vote.nProposalHash.ToString());
             mapOrphanMasternodeBudgetVotes[vote.nProposalHash] = vote;
+            changedOrphanProposalVotes.Set(vote.nProposalHash);
 
             if (!askedForSourceProposalOrBudget.count(vote.nProposalHash)) {
                 const CNetMsgMaker msgMaker(PROTOCOL_VERSION);
@@ -1233,7 +1323,14 @@ bool CBudgetManager::UpdateProposal(CBudgetVote& vote, CNode* pfrom, CConnman& c
         return false;
     }
 
-    return mapProposals[vote.nProposalHash].AddOrUpdateVote(vote, strError);
+    CBudgetProposal& proposal = mapProposals[vote.nProposalHash];
+    int nNetVotesOld = proposal.GetNetVotes();
+    if (!proposal.AddOrUpdateVote(vote, strError))
+        return false;
+    UpdateProposalRank(vote.nProposalHash, proposal, nNetVotesOld);
+    mapProposalVoteLocations[vote.GetHash()] = std::make_pair(vote.nProposalHash, vote.vin.prevout.hash);
+    changedProposals.Set(vote.nProposalHash);
+    return true;
 }
 
 bool CBudgetManager::UpdateFinalizedBudget(CFinalizedBudgetVote& vote, CNode* pfrom, CConnman& connman, std::string& strError)
@@ -1249,6 +1346,7 @@ bool CBudgetManager::UpdateFinalizedBudget(CFinalizedBudgetVote& vote, CNode* pf
 
             LogPrint(BCLog::MNBUDGET, "CBudgetManager::UpdateFinalizedBudget - Unknown Finalized Proposal %s, asking for source budget\n", vote.nBudgetHash.ToString());
             mapOrphanFinalizedBudgetVotes[vote.nBudgetHash] = vote;
+            changedOrphanFinalizedBudgetVotes.Set(vote.nBudgetHash);
 
             if (!askedForSourceProposalOrBudget.count(vote.nBudgetHash)) {
                 const CNetMsgMaker msgMaker(PROTOCOL_VERSION);
@@ -1261,7 +1359,11 @@ bool CBudgetManager::UpdateFinalizedBudget(CFinalizedBudgetVote& vote, CNode* pf
         return false;
     }
     LogPrint(BCLog::MNBUDGET, "CBudgetManager::UpdateFinalizedBudget - Finalized Proposal %s added\n", vote.nBudgetHash.ToString());
-    return mapFinalizedBudgets[vote.nBudgetHash].AddOrUpdateVote(vote, strError);
+    if (!mapFinalizedBudgets[vote.nBudgetHash].AddOrUpdateVote(vote, strError))
+        return false;
+    mapFinalizedBudgetVoteLocations[vote.GetHash()] = std::make_pair(vote.nBudgetHash, vote.vin.prevout.hash);
+    changedFinalizedBudgets.Set(vote.nBudgetHash);
+    return true;
 }
 
 CBudgetProposal::CBudgetProposal()
@@ -1271,6 +1373,9 @@ CBudgetProposal::CBudgetProposal()
     nBlockEnd = 0;
     nAmount = 0;
     nTime = 0;
+    nYeas = 0;
+    nNays = 0;
+    nAbstains = 0;
     fValid = true;
 }
 
@@ -1283,6 +1388,9 @@ CBudgetProposal::CBudgetProposal(std::string strProposalNameIn, std::string strU
     address = addressIn;
     nAmount = nAmountIn;
     nFeeTXHash = nFeeTXHashIn;
+    nYeas = 0;
+    nNays = 0;
+    nAbstains = 0;
     fValid = true;
 }
 
@@ -1297,6 +1405,9 @@ CBudgetProposal::CBudgetProposal(const CBudgetProposal& other)
     nTime = other.nTime;
     nFeeTXHash = other.nFeeTXHash;
     mapVotes = other.mapVotes;
+    nYeas = other.nYeas;
+    nNays = other.nNays;
+    nAbstains = other.nAbstains;
     fValid = true;
 }
 
@@ -1427,7 +1538,14 @@ bool CBudgetProposal::AddOrUpdateVote(CBudgetVote& vote, std::string& strError)
         return false;
     }
 
-    mapVotes[hash] = vote;
+    auto itVote = mapVotes.find(hash);
+    if (itVote != mapVotes.end()) {
+        CountVote(itVote->second, -1);
+        itVote->second = vote;
+    } else {
+        itVote = mapVotes.emplace(hash, vote).first;
+    }
+    CountVote(itVote->second, 1);
     LogPrint(BCLog::MNBUDGET, "CBudgetProposal::AddOrUpdateVote - %s %s\n", strAction, vote.GetHash().ToString());
 
     return true;
@@ -1439,11 +1557,39 @@ void CBudgetProposal::CleanAndRemove(bool fSignatureCheck)
     std::map<uint256, CBudgetVote>::iterator it = mapVotes.begin();
 
     while (it != mapVotes.end()) {
-        (*it).second.fValid = (*it).second.SignatureValid(fSignatureCheck);
+        bool fVoteValid = (*it).second.SignatureValid(fSignatureCheck);
+        if (fVoteValid != (*it).second.fValid) {
+            CountVote((*it).second, -1);
+            (*it).second.fValid = fVoteValid;
+            CountVote((*it).second, 1);
+        }
         ++it;
     }
 }
 
+void CBudgetProposal::CountVote(const CBudgetVote& vote, int nChange)
+{
+    if (!vote.fValid)
+        return;
+
+    if (vote.nVote == VOTE_YES)
+        nYeas += nChange;
+    else if (vote.nVote == VOTE_NO)
+        nNays += nChange;
+    else if (vote.nVote == VOTE_ABSTAIN)
+        nAbstains += nChange;
+}
+
+void CBudgetProposal::RecountVotes()
+{
+    nYeas = 0;
+    nNays = 0;
+    nAbstains = 0;
+    for (const auto& item : mapVotes) {
+        CountVote(item.second, 1);
+    }
+}
+
 double CBudgetProposal::GetRatio()
 {
     int yeas = 0;
@@ -1465,48 +1611,6 @@ double CBudgetProposal::GetRatio()
     return ((double)(yeas) / (double)(yeas + nays));
 }
 
-int CBudgetProposal::GetYeas() const
-{
-    int ret = 0;
-
-    std::map<uint256, CBudgetVote>::const_iterator it = mapVotes.begin();
-    while (it != mapVotes.end()) {
-        if ((*it).second.nVote == VOTE_YES && (*it).second.fValid)
-            ret++;
-        ++it;
-    }
-
-    return ret;
-}
-
-int CBudgetProposal::GetNays() const
-{
-    int ret = 0;
-
-    std::map<uint256, CBudgetVote>::const_iterator it = mapVotes.begin();
-    while (it != mapVotes.end()) {
-        if ((*it).second.nVote == VOTE_NO && (*it).second.fValid)
-            ret++;
-        ++it;
-    }
-
-    return ret;
-}
-
-int CBudgetProposal::GetAbstains() const
-{
-    int ret = 0;
-
-    std::map<uint256, CBudgetVote>::const_iterator it = mapVotes.begin();
-    while (it != mapVotes.end()) {
-        if ((*it).second.nVote == VOTE_ABSTAIN && (*it).second.fValid)
-            ret++;
-        ++it;
-    }
-
-    return ret;
-}
-
 int CBudgetProposal::GetBlockStartCycle()
 {
     // end block is half way through the next cycle (so the proposal will be removed much after the payment is sent)
@@ -1611,7 +1715,7 @@ bool CBudgetVote::Sign(CKey& keyMasternode, CPubKey& pubKeyMasternode)
     CKey keyCollateralAddress;
 
     std::string errorMessage;
-    std::string strMessage = vin.prevout.ToStringShort() + nProposalHash.ToString() + std::to_string(nVote) + std::to_string(nTime);
+    std::string strMessage = GetStrMessage();
 
     if (!legacySigner.SignMessage(strMessage, vchSig, keyMasternode)) {
         LogPrint(BCLog::MNBUDGET, "CBudgetVote::Sign - Error upon calling SignMessage");
@@ -1629,11 +1733,11 @@ bool CBudgetVote::Sign(CKey& keyMasternode, CPubKey& pubKeyMasternode)
 bool CBudgetVote::SignatureValid(bool fSignatureCheck)
 {
     std::string errorMessage;
-    std::string strMessage = vin.prevout.ToStringShort() + nProposalHash.ToString() + std::to_string(nVote) + std::to_string(nTime);
+    std::string strMessage = GetStrMessage();
 
-    CMasternode* pmn = mnodeman.Find(vin);
+    CPubKey pubKeyMasternode;
 
-    if (!pmn) {
+    if (!mnodeman.GetMasternodePubKey(vin, pubKeyMasternode)) {
         LogPrint(BCLog::MNBUDGET, "CBudgetVote::SignatureValid() - Unknown Masternode - %s\n", vin.prevout.hash.ToString());
         return false;
     }
@@ -1641,7 +1745,7 @@ bool CBudgetVote::SignatureValid(bool fSignatureCheck)
     if (!fSignatureCheck)
         return true;
 
-    if (!legacySigner.VerifyMessage(pmn->pubKeyMasternode, vchSig, strMessage, errorMessage)) {
+    if (!legacySigner.VerifyMessage(pubKeyMasternode, vchSig, strMessage, errorMessage)) {
         LogPrint(BCLog::MNBUDGET, "CBudgetVote::SignatureValid() - Verify message failed\n");
         return false;
     }
@@ -1649,6 +1753,11 @@ bool CBudgetVote::SignatureValid(bool fSignatureCheck)
     return true;
 }
 
+std::string CBudgetVote::GetStrMessage() const
+{
+    return vin.prevout.ToStringShort() + nProposalHash.ToString() + std::to_string(nVote) + std::to_string(nTime);
+}
+
 CFinalizedBudget::CFinalizedBudget()
 {
     strBudgetName = "";
@@ -2140,7 +2249,7 @@ bool CFinalizedBudgetVote::Sign(CKey& keyMasternode, CPubKey& pubKeyMasternode)
     CKey keyCollateralAddress;
 
     std::string errorMessage;
-    std::string strMessage = vin.prevout.ToStringShort() + nBudgetHash.ToString() + std::to_string(nTime);
+    std::string strMessage = GetStrMessage();
 
     if (!legacySigner.SignMessage(strMessage, vchSig, keyMasternode)) {
         LogPrint(BCLog::MNBUDGET, "CFinalizedBudgetVote::Sign - Error upon calling SignMessage");
@@ -2159,11 +2268,11 @@ bool CFinalizedBudgetVote::SignatureValid(bool fSignatureCheck)
 {
     std::string errorMessage;
 
-    std::string strMessage = vin.prevout.ToStringShort() + nBudgetHash.ToString() + std::to_string(nTime);
+    std::string strMessage = GetStrMessage();
 
-    CMasternode* pmn = mnodeman.Find(vin);
+    CPubKey pubKeyMasternode;
 
-    if (!pmn) {
+    if (!mnodeman.GetMasternodePubKey(vin, pubKeyMasternode)) {
         LogPrint(BCLog::MNBUDGET, "CFinalizedBudgetVote::SignatureValid() - Unknown Masternode %s\n", strMessage);
         return false;
     }
@@ -2171,7 +2280,7 @@ bool CFinalizedBudgetVote::SignatureValid(bool fSignatureCheck)
     if (!fSignatureCheck)
         return true;
 
-    if (!legacySigner.VerifyMessage(pmn->pubKeyMasternode, vchSig, strMessage, errorMessage)) {
+    if (!legacySigner.VerifyMessage(pubKeyMasternode, vchSig, strMessage, errorMessage)) {
         LogPrint(BCLog::MNBUDGET, "CFinalizedBudgetVote::SignatureValid() - Verify message failed %s %s\n", strMessage, errorMessage);
         return false;
     }
@@ -2179,6 +2288,96 @@ bool CFinalizedBudgetVote::SignatureValid(bool fSignatureCheck)
     return true;
 }
 
+std::string CFinalizedBudgetVote::GetStrMessage() const
+{
+    return vin.prevout.ToStringShort() + nBudgetHash.ToString() + std::to_string(nTime);
+}
+
+void CBudgetManager::GetSeenCacheStats(std::map<std::string, CSeenCacheStats>& mapStats)
+{
+    LOCK(cs);
+    mapStats["seen_budget_votes"] = mapSeenMasternodeBudgetVotes.GetStats();
+    mapStats["seen_finalized_budget_votes"] = mapSeenFinalizedBudgetVotes.GetStats();
+}
+
+void CBudgetManager::SetCacheChanged()
+{
+    LOCK(cs);
+    changedProposals.SetAll();
+    changedFinalizedBudgets.SetAll();
+    changedSeenProposals.SetAll();
+    changedSeenProposalVotes.SetAll();
+    changedOrphanProposalVotes.SetAll();
+    changedSeenFinalizedBudgets.SetAll();
+    changedSeenFinalizedBudgetVotes.SetAll();
+    changedOrphanFinalizedBudgetVotes.SetAll();
+}
+
+bool CBudgetManager::FlushCache(CMasternodeCacheDB& db)
+{
+    CDBBatch batch(db);
+    {
+        LOCK(cs);
+
+        mapSeenMasternodeBudgetVotes.TakeChanges([&](const uint256& hash) { changedSeenProposalVotes.Set(hash); });
+        mapSeenFinalizedBudgetVotes.TakeChanges([&](const uint256& hash) { changedSeenFinalizedBudgetVotes.Set(hash); });
+
+        db.proposals.Write(batch, mapProposals, changedProposals);
+        db.finalizedBudgets.Write(batch, mapFinalizedBudgets, changedFinalizedBudgets);
+        db.seenProposals.Write(batch, mapSeenMasternodeBudgetProposals, changedSeenProposals);
+        db.seenProposalVotes.Write(batch, mapSeenMasternodeBudgetVotes, changedSeenProposalVotes);
+        db.orphanProposalVotes.Write(batch, mapOrphanMasternodeBudgetVotes, changedOrphanProposalVotes);
+        db.seenFinalizedBudgets.Write(batch, mapSeenFinalizedBudgets, changedSeenFinalizedBudgets);
+        db.seenFinalizedBudgetVotes.Write(batch, mapSeenFinalizedBudgetVotes, changedSeenFinalizedBudgetVotes);
+        db.orphanFinalizedBudgetVotes.Write(batch, mapOrphanFinalizedBudgetVotes, changedOrphanFinalizedBudgetVotes);
+    }
+
+    return db.WriteCacheBatch(batch);
+}
+
+bool CBudgetManager::LoadCache(CMasternodeCacheDB& db)
+{
+    int64_t nStart = GetTimeMillis();
+
+    {
+        LOCK(cs);
+        Clear();
+
+        bool fOk = db.proposals.Read<CBudgetProposal>([&](const uint256& hash, const CBudgetProposal& proposal) { mapProposals.emplace(hash, proposal); });
+        fOk &= db.finalizedBudgets.Read<CFinalizedBudget>([&](const uint256& hash, const CFinalizedBudget& finalizedBudget) { mapFinalizedBudgets.emplace(hash, finalizedBudget); });
+        fOk &= db.seenProposals.Read<CBudgetProposalBroadcast>([&](const uint256& hash, const CBudgetProposalBroadcast& proposal) { mapSeenMasternodeBudgetProposals.emplace(hash, proposal); });
+        fOk &= db.seenProposalVotes.Read<CBudgetVote>([&](const uint256& hash, const CBudgetVote& vote) { mapSeenMasternodeBudgetVotes.emplace(hash, vote); });
+        fOk &= db.orphanProposalVotes.Read<CBudgetVote>([&](const uint256& hash, const CBudgetVote& vote) { mapOrphanMasternodeBudgetVotes.emplace(hash, vote); });
+        fOk &= db.seenFinalizedBudgets.Read<CFinalizedBudgetBroadcast>([&](const uint256& hash, const CFinalizedBudgetBroadcast& finalizedBudget) { mapSeenFinalizedBudgets.emplace(hash, finalizedBudget); });
+        fOk &= db.seenFinalizedBudgetVotes.Read<CFinalizedBudgetVote>([&](const uint256& hash, const CFinalizedBudgetVote& vote) { mapSeenFinalizedBudgetVotes.emplace(hash, vote); });
+        fOk &= db.orphanFinalizedBudgetVotes.Read<CFinalizedBudgetVote>([&](const uint256& hash, const CFinalizedBudgetVote& vote) { mapOrphanFinalizedBudgetVotes.emplace(hash, vote); });
+        if (!fOk) {
+            Clear();
+            return error("%s : Deserialize error", __func__);
+        }
+        RebuildProposalRanks();
+        RebuildVoteLocations();
+
+        // what was read is what the database has
+        mapSeenMasternodeBudgetVotes.TakeChanges([](const uint256&) {});
+        mapSeenFinalizedBudgetVotes.TakeChanges([](const uint256&) {});
+        changedProposals.Clear();
+        changedFinalizedBudgets.Clear();
+        changedSeenProposals.Clear();
+        changedSeenProposalVotes.Clear();
+        changedOrphanProposalVotes.Clear();
+        changedSeenFinalizedBudgets.Clear();
+        changedSeenFinalizedBudgetVotes.Clear();
+        changedOrphanFinalizedBudgetVotes.Clear();
+    }
+
+    LogPrint(BCLog::MNBUDGET, "Loaded budget cache  %dms\n", GetTimeMillis() - nStart);
+    LogPrint(BCLog::MNBUDGET, "Budget manager - cleaning....\n");
+    CheckAndRemove(nullptr, nullptr);
+    LogPrint(BCLog::MNBUDGET, "Budget manager - result: %s\n", ToString());
+    return true;
+}
+
 std::string CBudgetManager::ToString() const
 {
     std::ostringstream info;
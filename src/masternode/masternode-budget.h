@@ -5,11 +5,14 @@
 #ifndef MASTERNODE_BUDGET_H
 #define MASTERNODE_BUDGET_H
 
+#include <arith_uint256.h>
 #include <base58.h>
 #include <init.h>
 #include <key.h>
 #include <masternode/masternode.h>
+#include <masternode/mncachedb.h>
 #include <masternode/netfulfilledman.h>
+#include <masternode/seencache.h>
 #include <net.h>
 #include <netmessagemaker.h>
 #include <sync.h>
@@ -39,13 +42,14 @@ static const CAmount PROPOSAL_FEE_TX = (20 * COIN);
 static const CAmount BUDGET_FEE_TX_OLD = (5 * COIN);
 static const CAmount BUDGET_FEE_TX = (5 * COIN);
 static const int64_t BUDGET_VOTE_UPDATE_MIN = 60 * 60;
+//! seen proposal and finalized budget votes kept for relay and deduplication
+static const size_t BUDGET_SEEN_VOTES_MAX = 200000;
+static const int64_t BUDGET_SEEN_VOTES_SECONDS = 24 * 60 * 60;
 static std::map<uint256, int> mapPayment_History;
 
 extern std::vector<CBudgetProposalBroadcast> vecImmatureBudgetProposals;
 extern std::vector<CFinalizedBudgetBroadcast> vecImmatureFinalizedBudgets;
 
-void DumpBudgets();
-
 // Define amount of blocks in budget payment cycle
 int GetBudgetPaymentCycleBlocks();
 
@@ -72,6 +76,7 @@ public:
     bool Sign(CKey& keyMasternode, CPubKey& pubKeyMasternode);
     bool SignatureValid(bool fSignatureCheck);
     void Relay(CConnman* connman);
+    std::string GetStrMessage() const;
 
     std::string GetVoteString()
     {
@@ -122,6 +127,7 @@ public:
     bool Sign(CKey& keyMasternode, CPubKey& pubKeyMasternode);
     bool SignatureValid(bool fSignatureCheck);
     void Relay(CConnman* connman);
+    std::string GetStrMessage() const;
 
     uint256 GetHash()
     {
@@ -151,6 +157,44 @@ private:
 
     ChainstateManager* chainman{nullptr};
 
+    // position of a proposal in the budget, by net yes votes and then collateral hash, high to low
+    struct CProposalRank {
+        int nNetVotes;
+        uint256 nFeeTXHash;
+        uint256 nHash;
+
+        bool operator<(const CProposalRank& other) const
+        {
+            if (nNetVotes != other.nNetVotes)
+                return nNetVotes > other.nNetVotes;
+            if (nFeeTXHash != other.nFeeTXHash)
+                return UintToArith256(nFeeTXHash) > UintToArith256(other.nFeeTXHash);
+            return nHash < other.nHash;
+        }
+    };
+    // mapProposals in the order GetBudget takes them
+    std::set<CProposalRank> setProposalsByVotes;
+
+    /// Move a proposal to its place in setProposalsByVotes after its votes changed from nNetVotesOld
+    void UpdateProposalRank(const uint256& nHash, const CBudgetProposal& proposal, int nNetVotesOld);
+    void RebuildProposalRanks();
+
+    // where each proposal and finalized budget vote is kept, as (proposal or budget hash, voter), by vote hash.
+    // Entries of replaced votes stay until the next rebuild, lookups check the hash of the vote they find.
+    std::unordered_map<uint256, std::pair<uint256, uint256>, SaltedTxidHasher> mapProposalVoteLocations;
+    std::unordered_map<uint256, std::pair<uint256, uint256>, SaltedTxidHasher> mapFinalizedBudgetVoteLocations;
+    void RebuildVoteLocations();
+
+    // entries changed since the last cache flush
+    CMasternodeCacheChanges<uint256> changedProposals;
+    CMasternodeCacheChanges<uint256> changedFinalizedBudgets;
+    CMasternodeCacheChanges<uint256> changedSeenProposals;
+    CMasternodeCacheChanges<uint256> changedSeenProposalVotes;
+    CMasternodeCacheChanges<uint256> changedOrphanProposalVotes;
+    CMasternodeCacheChanges<uint256> changedSeenFinalizedBudgets;
+    CMasternodeCacheChanges<uint256> changedSeenFinalizedBudgetVotes;
+    CMasternodeCacheChanges<uint256> changedOrphanFinalizedBudgetVotes;
+
 public:
     // critical section to protect the inner data structures
     mutable RecursiveMutex cs;
@@ -160,16 +204,18 @@ public:
     std::map<uint256, CFinalizedBudget> mapFinalizedBudgets;
 
     std::map<uint256, CBudgetProposalBroadcast> mapSeenMasternodeBudgetProposals;
-    std::map<uint256, CBudgetVote> mapSeenMasternodeBudgetVotes;
+    CSeenCache<uint256, CBudgetVote> mapSeenMasternodeBudgetVotes{BUDGET_SEEN_VOTES_MAX, BUDGET_SEEN_VOTES_SECONDS};
     std::map<uint256, CBudgetVote> mapOrphanMasternodeBudgetVotes;
     std::map<uint256, CFinalizedBudgetBroadcast> mapSeenFinalizedBudgets;
-    std::map<uint256, CFinalizedBudgetVote> mapSeenFinalizedBudgetVotes;
+    CSeenCache<uint256, CFinalizedBudgetVote> mapSeenFinalizedBudgetVotes{BUDGET_SEEN_VOTES_MAX, BUDGET_SEEN_VOTES_SECONDS};
     std::map<uint256, CFinalizedBudgetVote> mapOrphanFinalizedBudgetVotes;
 
     CBudgetManager()
     {
         mapProposals.clear();
         mapFinalizedBudgets.clear();
+        mapSeenMasternodeBudgetVotes.TrackChanges();
+        mapSeenFinalizedBudgetVotes.TrackChanges();
     }
 
     /// Attach chainman pointer to class
@@ -183,6 +229,8 @@ public:
         mapSeenMasternodeBudgetVotes.clear();
         mapSeenFinalizedBudgets.clear();
         mapSeenFinalizedBudgetVotes.clear();
+        changedSeenProposals.SetAll();
+        changedSeenFinalizedBudgets.SetAll();
     }
 
     int sizeFinalized() { return (int)mapFinalizedBudgets.size(); }
@@ -212,6 +260,9 @@ public:
 
     bool UpdateProposal(CBudgetVote& vote, CNode* pfrom, CConnman& connman, std::string& strError);
     bool UpdateFinalizedBudget(CFinalizedBudgetVote& vote, CNode* pfrom, CConnman& connman, std::string& strError);
+    /// Find a vote to relay, also after it dropped out of the seen cache
+    bool GetProposalVote(const uint256& nHash, CBudgetVote& vote);
+    bool GetFinalizedBudgetVote(const uint256& nHash, CFinalizedBudgetVote& vote);
     bool PropExists(uint256 nHash);
     TrxValidationStatus IsTransactionValid(const CTransactionRef& txNew, int nBlockHeight);
     std::string GetRequiredPaymentsString(int nBlockHeight);
@@ -224,17 +275,31 @@ public:
 
         LogPrintf("Budget object cleared\n");
         mapProposals.clear();
+        setProposalsByVotes.clear();
         mapFinalizedBudgets.clear();
+        mapProposalVoteLocations.clear();
+        mapFinalizedBudgetVoteLocations.clear();
         mapSeenMasternodeBudgetProposals.clear();
         mapSeenMasternodeBudgetVotes.clear();
         mapSeenFinalizedBudgets.clear();
         mapSeenFinalizedBudgetVotes.clear();
         mapOrphanMasternodeBudgetVotes.clear();
         mapOrphanFinalizedBudgetVotes.clear();
+        SetCacheChanged();
     }
     void CheckAndRemove(CBlockIndex* pindex, CConnman* connman);
     std::string ToString() const;
 
+    /// Get the sizes of the seen-message caches
+    void GetSeenCacheStats(std::map<std::string, CSeenCacheStats>& mapStats);
+
+    /// Mark every entry as changed, so that the next flush writes them all
+    void SetCacheChanged();
+    /// Write the proposals, budgets and votes that changed since the last flush
+    bool FlushCache(CMasternodeCacheDB& db);
+    /// Replace the proposals, budgets and votes with the ones in the database
+    bool LoadCache(CMasternodeCacheDB& db);
+
     SERIALIZE_METHODS(CBudgetManager, obj)
     {
         READWRITE(obj.mapSeenMasternodeBudgetProposals);
@@ -245,6 +310,9 @@ public:
         READWRITE(obj.mapOrphanFinalizedBudgetVotes);
         READWRITE(obj.mapProposals);
         READWRITE(obj.mapFinalizedBudgets);
+        SER_READ(obj, obj.RebuildProposalRanks());
+        SER_READ(obj, obj.RebuildVoteLocations());
+        SER_READ(obj, obj.SetCacheChanged());
     }
 };
 
@@ -299,6 +367,7 @@ public:
     bool IsValid(CBlockIndex* pindex, std::string& strError, bool fCheckCollateral = true);
 
     std::string GetName() { return strBudgetName; }
+    bool IsAutoChecked() const { return fAutoChecked; }
     std::string GetProposals();
     int GetBlockStart() { return nBlockStart; }
     int GetBlockEnd() { return nBlockStart + (int)(vecBudgetPayments.size() - 1); }
@@ -416,6 +485,14 @@ private:
     mutable RecursiveMutex cs;
     CAmount nAlloted;
 
+    // valid votes in mapVotes by outcome
+    int nYeas;
+    int nNays;
+    int nAbstains;
+
+    /// Add (nChange 1) or take out (nChange -1) a vote from the tallies
+    void CountVote(const CBudgetVote& vote, int nChange);
+
 public:
     bool fValid;
     std::string strProposalName;
@@ -468,9 +545,12 @@ public:
     int GetBlockCurrentCycle(CBlockIndex* pindex);
     int GetBlockEndCycle();
     double GetRatio();
-    int GetYeas() const;
-    int GetNays() const;
-    int GetAbstains() const;
+    int GetYeas() const { return nYeas; }
+    int GetNays() const { return nNays; }
+    int GetAbstains() const { return nAbstains; }
+    int GetNetVotes() const { return nYeas - nNays; }
+    /// Tally mapVotes again after it was replaced
+    void RecountVotes();
     CAmount GetAmount() { return nAmount; }
     void SetAllotted(CAmount nAllotedIn) { nAlloted = nAllotedIn; }
     CAmount GetAllotted() { return nAlloted; }
@@ -503,6 +583,7 @@ public:
         READWRITE(obj.nTime);
         READWRITE(obj.nFeeTXHash);
         READWRITE(obj.mapVotes);
+        SER_READ(obj, obj.RecountVotes());
     }
 };
 
@@ -539,6 +620,8 @@ public:
         swap(first.nTime, second.nTime);
         swap(first.nFeeTXHash, second.nFeeTXHash);
         first.mapVotes.swap(second.mapVotes);
+        first.RecountVotes();
+        second.RecountVotes();
     }
 
     CBudgetProposalBroadcast& operator=(CBudgetProposalBroadcast from)
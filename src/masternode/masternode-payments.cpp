@@ -12,6 +12,7 @@
 #include <masternode/masternode-sync.h>
 #include <masternode/masternodeman.h>
 #include <masternode/masternodesigner.h>
+#include <masternode/mncachedb.h>
 #include <masternode/spork.h>
 #include <sync.h>
 #include <util/moneystr.h>
@@ -33,37 +34,6 @@ CMasternodePaymentDB::CMasternodePaymentDB()
     strMagicMessage = "MasternodePayments";
 }
 
-bool CMasternodePaymentDB::Write(const CMasternodePayments& objToSave)
-{
-    int64_t nStart = GetTimeMillis();
-
-    // serialize, checksum data up to that point, then append checksum
-    CDataStream ssObj(SER_DISK, CLIENT_VERSION);
-    ssObj << strMagicMessage; // masternode cache file specific magic message
-    ssObj << Params().MessageStart(); // network specific magic number
-    ssObj << objToSave;
-    uint256 hash = Hash(ssObj);
-    ssObj << hash;
-
-    // open output file, and associate with CAutoFile
-    FILE* file = fopen(pathDB.string().c_str(), "wb");
-    CAutoFile fileout(file, SER_DISK, CLIENT_VERSION);
-    if (fileout.IsNull())
-        return error("%s : Failed to open file %s", __func__, pathDB.string());
-
-    // Write and commit header, data
-    try {
-        fileout << ssObj;
-    } catch (std::exception& e) {
-        return error("%s : Serialize or I/O error - %s", __func__, e.what());
-    }
-    fileout.fclose();
-
-    LogPrint(BCLog::MASTERNODE, "Written info to mnpayments.dat  %dms\n", GetTimeMillis() - nStart);
-
-    return true;
-}
-
 CMasternodePaymentDB::ReadResult CMasternodePaymentDB::Read(CMasternodePayments& objToLoad, bool fDryRun)
 {
     int64_t nStart = GetTimeMillis();
@@ -145,33 +115,6 @@ CMasternodePaymentDB::ReadResult CMasternodePaymentDB::Read(CMasternodePayments&
     return Ok;
 }
 
-void DumpMasternodePayments()
-{
-    int64_t nStart = GetTimeMillis();
-
-    CMasternodePaymentDB paymentdb;
-    CMasternodePayments tempPayments;
-
-    LogPrint(BCLog::MASTERNODE, "Verifying mnpayments.dat format...\n");
-    CMasternodePaymentDB::ReadResult readResult = paymentdb.Read(tempPayments, true);
-    // there was an error and it was not an error on file opening => do not proceed
-    if (readResult == CMasternodePaymentDB::FileError)
-        LogPrint(BCLog::MASTERNODE, "Missing budgets file - mnpayments.dat, will try to recreate\n");
-    else if (readResult != CMasternodePaymentDB::Ok) {
-        LogPrint(BCLog::MASTERNODE, "Error reading mnpayments.dat: ");
-        if (readResult == CMasternodePaymentDB::IncorrectFormat)
-            LogPrint(BCLog::MASTERNODE, "magic is ok but data has invalid format, will try to recreate\n");
-        else {
-            LogPrint(BCLog::MASTERNODE, "file format is unknown or invalid, please fix it manually\n");
-            return;
-        }
-    }
-    LogPrint(BCLog::MASTERNODE, "Writting info to mnpayments.dat...\n");
-    paymentdb.Write(masternodePayments);
-
-    LogPrint(BCLog::MASTERNODE, "Budget dump finished  %dms\n", GetTimeMillis() - nStart);
-}
-
 bool IsBlockValueValid(const CBlock& block, CAmount nExpectedValue, CAmount nMinted, int nHeight)
 {
     if (!masternodeSync.IsSynced()) { // there is no budget data to use to check anything
@@ -419,7 +362,7 @@ bool CMasternodePaymentWinner::Sign(CKey& keyMasternode, CPubKey& pubKeyMasterno
     std::string errorMessage;
     std::string strMasterNodeSignMessage;
 
-    std::string strMessage = vinMasternode.prevout.ToStringShort() + std::to_string(nBlockHeight) + payee.ToString();
+    std::string strMessage = GetStrMessage();
 
     if (!legacySigner.SignMessage(strMessage, vchSig, keyMasternode)) {
         LogPrint(BCLog::MASTERNODE, "CMasternodePing::Sign() - Error: %s\n", errorMessage);
@@ -491,18 +434,109 @@ bool CMasternodePayments::AddWinningMasternode(CMasternodePaymentWinner& winnerI
         }
 
         mapMasternodePayeeVotes[winnerIn.GetHash()] = winnerIn;
+        mapVotesByHeight[winnerIn.nBlockHeight].push_back(winnerIn.GetHash());
+        changedVotes.Set(winnerIn.GetHash());
+        changedBlocks.Set(winnerIn.nBlockHeight);
 
         if (!mapMasternodeBlocks.count(winnerIn.nBlockHeight)) {
             CMasternodeBlockPayees blockPayees(winnerIn.nBlockHeight);
             mapMasternodeBlocks[winnerIn.nBlockHeight] = blockPayees;
         }
+
+        CMasternodeBlockPayees& blockPayees = mapMasternodeBlocks[winnerIn.nBlockHeight];
+        blockPayees.AddPayee(winnerIn.payee, 1);
+        if (blockPayees.HasPayeeWithVotes(winnerIn.payee, MNPAYMENTS_PAID_VOTES))
+            mapPayeePaidHeights[winnerIn.payee].insert(winnerIn.nBlockHeight);
     }
 
-    mapMasternodeBlocks[winnerIn.nBlockHeight].AddPayee(winnerIn.payee, 1);
+    return true;
+}
+
+void CMasternodePayments::GetSeenCacheStats(std::map<std::string, CSeenCacheStats>& mapStats)
+{
+    LOCK(cs_mapMasternodePayeeVotes);
+    mapStats["last_payment_votes"] = mapMasternodesLastVote.GetStats();
+}
 
+bool CMasternodePayments::FlushCache(CMasternodeCacheDB& db)
+{
+    CDBBatch batch(db);
+    {
+        LOCK2(cs_mapMasternodeBlocks, cs_mapMasternodePayeeVotes);
+
+        db.paymentVotes.Write(batch, mapMasternodePayeeVotes, changedVotes);
+        db.paymentBlocks.Write(batch, mapMasternodeBlocks, changedBlocks);
+    }
+
+    return db.WriteCacheBatch(batch);
+}
+
+bool CMasternodePayments::LoadCache(CMasternodeCacheDB& db)
+{
+    int64_t nStart = GetTimeMillis();
+
+    {
+        LOCK2(cs_mapMasternodeBlocks, cs_mapMasternodePayeeVotes);
+        Clear();
+
+        bool fOk = db.paymentVotes.Read<CMasternodePaymentWinner>([&](const uint256& hash, const CMasternodePaymentWinner& winner) { mapMasternodePayeeVotes.emplace(hash, winner); });
+        fOk &= db.paymentBlocks.Read<CMasternodeBlockPayees>([&](int nHeight, const CMasternodeBlockPayees& payees) { mapMasternodeBlocks.emplace(nHeight, payees); });
+        if (!fOk) {
+            Clear();
+            return error("%s : Deserialize error", __func__);
+        }
+        RebuildPaidHeights();
+        RebuildVotesByHeight();
+        changedVotes.Clear();
+        changedBlocks.Clear();
+    }
+
+    LogPrint(BCLog::MASTERNODE, "Loaded masternode payment cache  %dms\n", GetTimeMillis() - nStart);
+    LogPrint(BCLog::MASTERNODE, "Masternode payments manager - cleaning....\n");
+    CleanPaymentList();
+    LogPrint(BCLog::MASTERNODE, "  %s\n", ToString());
     return true;
 }
 
+void CMasternodePayments::RebuildPaidHeights()
+{
+    LOCK2(cs_mapMasternodeBlocks, cs_vecPayments);
+
+    mapPayeePaidHeights.clear();
+    for (const auto& item : mapMasternodeBlocks) {
+        for (const CMasternodePayee& payee : item.second.vecPayments) {
+            if (payee.nVotes >= MNPAYMENTS_PAID_VOTES)
+                mapPayeePaidHeights[payee.scriptPubKey].insert(item.first);
+        }
+    }
+}
+
+void CMasternodePayments::RebuildVotesByHeight()
+{
+    LOCK(cs_mapMasternodePayeeVotes);
+
+    mapVotesByHeight.clear();
+    for (const auto& item : mapMasternodePayeeVotes) {
+        mapVotesByHeight[item.second.nBlockHeight].push_back(item.first);
+    }
+}
+
+int CMasternodePayments::GetLastPaidHeight(const CScript& payee, int nMinHeight, int nMaxHeight)
+{
+    LOCK(cs_mapMasternodeBlocks);
+
+    auto it = mapPayeePaidHeights.find(payee);
+    if (it == mapPayeePaidHeights.end())
+        return 0;
+
+    // first height above nMaxHeight, the one before it is the candidate
+    auto itHeight = it->second.upper_bound(nMaxHeight);
+    if (itHeight == it->second.begin())
+        return 0;
+    --itHeight;
+    return *itHeight >= nMinHeight ? *itHeight : 0;
+}
+
 bool CMasternodeBlockPayees::IsTransactionValid(const CTransactionRef& txNew)
 {
     LOCK(cs_vecPayments);
@@ -610,34 +644,49 @@ void CMasternodePayments::CleanPaymentList()
     // keep up to five cycles for historical sake
     int nLimit = std::max(int(mnodeman.size() * 1.25), 1000);
 
-    std::map<uint256, CMasternodePaymentWinner>::iterator it = mapMasternodePayeeVotes.begin();
-    while (it != mapMasternodePayeeVotes.end()) {
-        CMasternodePaymentWinner winner = (*it).second;
+    // drop every height more than nLimit blocks below the tip at once
+    const auto itVotesEnd = mapVotesByHeight.lower_bound(nHeight - nLimit);
+    for (auto itVotes = mapVotesByHeight.begin(); itVotes != itVotesEnd; ++itVotes) {
+        LogPrint(BCLog::MNPAYMENTS, "CMasternodePayments::CleanPaymentList - Removing old Masternode payments - block %d\n", itVotes->first);
+        for (const uint256& hash : itVotes->second) {
+            WITH_LOCK(masternodeSync.cs, masternodeSync.mapSeenSyncMNW.erase(hash));
+            mapMasternodePayeeVotes.erase(hash);
+            changedVotes.Set(hash);
+        }
+    }
+    mapVotesByHeight.erase(mapVotesByHeight.begin(), itVotesEnd);
 
-        if (nHeight - winner.nBlockHeight > nLimit) {
-            LogPrint(BCLog::MNPAYMENTS, "CMasternodePayments::CleanPaymentList - Removing old Masternode payment - block %d\n", winner.nBlockHeight);
-            masternodeSync.mapSeenSyncMNW.erase((*it).first);
-            mapMasternodePayeeVotes.erase(it++);
-            mapMasternodeBlocks.erase(winner.nBlockHeight);
-        } else {
-            ++it;
+    const auto itBlocksEnd = mapMasternodeBlocks.lower_bound(nHeight - nLimit);
+    {
+        LOCK(cs_vecPayments);
+        for (auto itBlock = mapMasternodeBlocks.begin(); itBlock != itBlocksEnd; ++itBlock) {
+            changedBlocks.Set(itBlock->first);
+            for (const CMasternodePayee& payee : itBlock->second.vecPayments) {
+                auto itPaid = mapPayeePaidHeights.find(payee.scriptPubKey);
+                if (itPaid == mapPayeePaidHeights.end())
+                    continue;
+                itPaid->second.erase(itBlock->first);
+                if (itPaid->second.empty())
+                    mapPayeePaidHeights.erase(itPaid);
+            }
         }
     }
+    mapMasternodeBlocks.erase(mapMasternodeBlocks.begin(), itBlocksEnd);
 }
 
 bool CMasternodePaymentWinner::IsValid(CBlockIndex* pindex, CNode* pnode, std::string& strError, CConnman* connman)
 {
-    CMasternode* pmn = mnodeman.Find(vinMasternode);
-
-    if (!pmn) {
+    // copied out, the entry can move once mnodeman.cs is released
+    int protocolVersion;
+    if (!mnodeman.GetMasternodeProtocolVersion(vinMasternode, protocolVersion)) {
         strError = strprintf("Unknown Masternode %s", vinMasternode.prevout.hash.ToString());
         LogPrint(BCLog::MASTERNODE, "CMasternodePaymentWinner::IsValid - %s\n", strError);
         mnodeman.AskForMN(pnode, vinMasternode, connman);
         return false;
     }
 
-    if (pmn->protocolVersion < PROTOCOL_VERSION - 1) {
-        strError = strprintf("Masternode protocol too old %d - req %d", pmn->protocolVersion, PROTOCOL_VERSION - 1);
+    if (protocolVersion < PROTOCOL_VERSION - 1) {
+        strError = strprintf("Masternode protocol too old %d - req %d", protocolVersion, PROTOCOL_VERSION - 1);
         LogPrint(BCLog::MASTERNODE, "CMasternodePaymentWinner::IsValid - %s\n", strError);
         return false;
     }
@@ -736,13 +785,13 @@ void CMasternodePaymentWinner::Relay(CConnman* connman)
 
 bool CMasternodePaymentWinner::SignatureValid()
 {
-    CMasternode* pmn = mnodeman.Find(vinMasternode);
+    CPubKey pubKeyMasternode;
 
-    if (pmn) {
-        std::string strMessage = vinMasternode.prevout.ToStringShort() + std::to_string(nBlockHeight) + payee.ToString();
+    if (mnodeman.GetMasternodePubKey(vinMasternode, pubKeyMasternode)) {
+        std::string strMessage = GetStrMessage();
 
         std::string errorMessage = "";
-        if (!legacySigner.VerifyMessage(pmn->pubKeyMasternode, vchSig, strMessage, errorMessage)) {
+        if (!legacySigner.VerifyMessage(pubKeyMasternode, vchSig, strMessage, errorMessage)) {
             return error("CMasternodePaymentWinner::SignatureValid() - Got bad Masternode address signature %s\n", vinMasternode.prevout.hash.ToString());
         }
 
@@ -752,6 +801,11 @@ bool CMasternodePaymentWinner::SignatureValid()
     return false;
 }
 
+std::string CMasternodePaymentWinner::GetStrMessage() const
+{
+    return vinMasternode.prevout.ToStringShort() + std::to_string(nBlockHeight) + payee.ToString();
+}
+
 void CMasternodePayments::Sync(CNode* node, int nCountNeeded, CConnman* connman)
 {
     LOCK(cs_mapMasternodePayeeVotes);
@@ -772,14 +826,11 @@ void CMasternodePayments::Sync(CNode* node, int nCountNeeded, CConnman* connman)
 
     int nInvCount = 0;
     const CNetMsgMaker msgMaker(PROTOCOL_VERSION);
-    std::map<uint256, CMasternodePaymentWinner>::iterator it = mapMasternodePayeeVotes.begin();
-    while (it != mapMasternodePayeeVotes.end()) {
-        CMasternodePaymentWinner winner = (*it).second;
-        if (winner.nBlockHeight >= nHeight - nCountNeeded && winner.nBlockHeight <= nHeight + 20) {
-            connman->PushMessage(node, msgMaker.Make(NetMsgType::INV, CInv(MSG_MASTERNODE_WINNER, winner.GetHash())));
+    for (auto it = mapVotesByHeight.lower_bound(nHeight - nCountNeeded); it != mapVotesByHeight.end() && it->first <= nHeight + 20; ++it) {
+        for (const uint256& hash : it->second) {
+            connman->PushMessage(node, msgMaker.Make(NetMsgType::INV, CInv(MSG_MASTERNODE_WINNER, hash)));
             nInvCount++;
         }
-        ++it;
     }
     connman->PushMessage(node, msgMaker.Make(NetMsgType::SYNCSTATUSCOUNT, MASTERNODE_SYNC_MNW, nInvCount));
 }
@@ -797,32 +848,18 @@ int CMasternodePayments::GetOldestBlock()
 {
     LOCK(cs_mapMasternodeBlocks);
 
-    int nOldestBlock = std::numeric_limits<int>::max();
+    if (mapMasternodeBlocks.empty())
+        return std::numeric_limits<int>::max();
 
-    std::map<int, CMasternodeBlockPayees>::iterator it = mapMasternodeBlocks.begin();
-    while (it != mapMasternodeBlocks.end()) {
-        if ((*it).first < nOldestBlock) {
-            nOldestBlock = (*it).first;
-        }
-        it++;
-    }
-
-    return nOldestBlock;
+    return mapMasternodeBlocks.begin()->first;
 }
 
 int CMasternodePayments::GetNewestBlock()
 {
     LOCK(cs_mapMasternodeBlocks);
 
-    int nNewestBlock = 0;
-
-    std::map<int, CMasternodeBlockPayees>::iterator it = mapMasternodeBlocks.begin();
-    while (it != mapMasternodeBlocks.end()) {
-        if ((*it).first > nNewestBlock) {
-            nNewestBlock = (*it).first;
-        }
-        it++;
-    }
+    if (mapMasternodeBlocks.empty())
+        return 0;
 
-    return nNewestBlock;
+    return std::max(mapMasternodeBlocks.rbegin()->first, 0);
 }
@@ -7,8 +7,12 @@
 
 #include <key.h>
 #include <masternode/masternode.h>
+#include <masternode/mncachedb.h>
+#include <masternode/seencache.h>
 #include <validation.h>
 
+#include <set>
+
 extern RecursiveMutex cs_vecPayments;
 extern RecursiveMutex cs_mapMasternodeBlocks;
 extern RecursiveMutex cs_mapMasternodePayeeVotes;
@@ -19,6 +23,11 @@ class CMasternodeBlockPayees;
 
 #define MNPAYMENTS_SIGNATURES_REQUIRED 6
 #define MNPAYMENTS_SIGNATURES_TOTAL 10
+// votes a payee needs at a height to count as paid there
+#define MNPAYMENTS_PAID_VOTES 2
+// masternodes whose last payment vote height is remembered, and for how long
+#define MNPAYMENTS_LAST_VOTES_MAX 20000
+#define MNPAYMENTS_LAST_VOTES_SECONDS (60 * 60)
 
 void ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman* connman);
 bool IsBlockPayeeValid(const CBlock& block, int nBlockHeight);
@@ -26,9 +35,8 @@ std::string GetRequiredPaymentsString(int nBlockHeight);
 bool IsBlockValueValid(const CBlock& block, CAmount nExpectedValue, CAmount nMinted, int nHeight);
 void FillBlockPayee(int nBlockHeight, CMutableTransaction& txNew, CAmount nFees, bool fProofOfStake, bool fZYCEStake);
 
-void DumpMasternodePayments();
 
-/** Save Masternode Payment Data (mnpayments.dat)
+/** Reader of the old Masternode Payment Data (mnpayments.dat), moved to CMasternodeCacheDB on first start
  */
 class CMasternodePaymentDB {
 private:
@@ -47,7 +55,6 @@ public:
     };
 
     CMasternodePaymentDB();
-    bool Write(const CMasternodePayments& objToSave);
     ReadResult Read(CMasternodePayments& objToLoad, bool fDryRun = false);
 };
 
@@ -181,6 +188,7 @@ public:
     bool IsValid(CBlockIndex* pindex, CNode* pnode, std::string& strError, CConnman* connman);
     bool SignatureValid();
     void Relay(CConnman* connman);
+    std::string GetStrMessage() const;
 
     void AddPayee(CScript payeeIn)
     {
@@ -218,10 +226,25 @@ private:
 
     ChainstateManager* chainman{nullptr};
 
+    // heights of mapMasternodeBlocks where a payee has at least MNPAYMENTS_PAID_VOTES votes
+    std::map<CScript, std::set<int>> mapPayeePaidHeights;
+
+    // hashes of mapMasternodePayeeVotes by block height, so that pruning and syncing only visit the heights they need
+    std::map<int, std::vector<uint256>> mapVotesByHeight;
+
+    /// Rebuild mapPayeePaidHeights from mapMasternodeBlocks
+    void RebuildPaidHeights();
+    /// Rebuild mapVotesByHeight from mapMasternodePayeeVotes
+    void RebuildVotesByHeight();
+
+    // votes and block payees changed since the last cache flush
+    CMasternodeCacheChanges<uint256> changedVotes;
+    CMasternodeCacheChanges<int> changedBlocks;
+
 public:
     std::map<uint256, CMasternodePaymentWinner> mapMasternodePayeeVotes;
     std::map<int, CMasternodeBlockPayees> mapMasternodeBlocks;
-    std::map<uint256, int> mapMasternodesLastVote; // prevout.hash + prevout.n, nBlockHeight
+    CSeenCache<uint256, int> mapMasternodesLastVote{MNPAYMENTS_LAST_VOTES_MAX, MNPAYMENTS_LAST_VOTES_SECONDS}; // prevout.hash + prevout.n, nBlockHeight
 
     CMasternodePayments()
     {
@@ -234,6 +257,10 @@ public:
         LOCK2(cs_mapMasternodeBlocks, cs_mapMasternodePayeeVotes);
         mapMasternodeBlocks.clear();
         mapMasternodePayeeVotes.clear();
+        mapPayeePaidHeights.clear();
+        mapVotesByHeight.clear();
+        changedVotes.SetAll();
+        changedBlocks.SetAll();
     }
 
     /// Attach chainman pointer to class
@@ -241,12 +268,22 @@ public:
         chainman = other;
     }
 
+    /// Get the sizes of the seen-message caches
+    void GetSeenCacheStats(std::map<std::string, CSeenCacheStats>& mapStats);
+
+    /// Write the votes and block payees that changed since the last flush
+    bool FlushCache(CMasternodeCacheDB& db);
+    /// Replace the votes and block payees with the ones in the database
+    bool LoadCache(CMasternodeCacheDB& db);
+
     bool AddWinningMasternode(CMasternodePaymentWinner& winner);
     bool ProcessBlock(CBlockIndex* pindex, int nBlockHeight, CConnman* connman);
 
     void Sync(CNode* node, int nCountNeeded, CConnman* connman);
     void CleanPaymentList();
     int LastPayment(CMasternode& mn);
+    /// Get the highest height in [nMinHeight, nMaxHeight] where payee was paid, or 0
+    int GetLastPaidHeight(const CScript& payee, int nMinHeight, int nMaxHeight);
 
     bool GetBlockPayee(int nBlockHeight, CScript& payee);
     bool IsTransactionValid(const CTransactionRef& txNew, int nBlockHeight);
@@ -264,7 +301,7 @@ public:
         }
 
         // record this masternode voted
-        mapMasternodesLastVote[ArithToUint256(voteHash)] = nBlockHeight;
+        mapMasternodesLastVote.insert_or_assign(ArithToUint256(voteHash), nBlockHeight);
         return true;
     }
 
@@ -280,6 +317,10 @@ public:
     {
         READWRITE(obj.mapMasternodePayeeVotes);
         READWRITE(obj.mapMasternodeBlocks);
+        SER_READ(obj, obj.RebuildPaidHeights());
+        SER_READ(obj, obj.RebuildVotesByHeight());
+        SER_READ(obj, obj.changedVotes.SetAll());
+        SER_READ(obj, obj.changedBlocks.SetAll());
     }
 };
 
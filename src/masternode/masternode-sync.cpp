@@ -20,6 +20,14 @@ CMasternodeSync::CMasternodeSync()
     Reset();
 }
 
+void CMasternodeSync::GetSeenCacheStats(std::map<std::string, CSeenCacheStats>& mapStats)
+{
+    LOCK(cs);
+    mapStats["sync_broadcasts"] = mapSeenSyncMNB.GetStats();
+    mapStats["sync_payment_votes"] = mapSeenSyncMNW.GetStats();
+    mapStats["sync_budget_items"] = mapSeenSyncBudget.GetStats();
+}
+
 bool CMasternodeSync::IsSynced()
 {
     return RequestedMasternodeAssets == MASTERNODE_SYNC_FINISHED;
@@ -27,18 +35,18 @@ bool CMasternodeSync::IsSynced()
 
 bool CMasternodeSync::IsBlockchainSynced()
 {
-    static bool fBlockchainSynced = false;
-    static int64_t lastProcess = GetTime();
+    {
+        LOCK(cs);
+        // if the last call to this function was more than 60 minutes ago (client was in sleep mode) reset the sync process
+        if (nLastBlockchainSyncCheck > 0 && GetTime() - nLastBlockchainSyncCheck > 60 * 60) {
+            Reset();
+            fBlockchainSynced = false;
+        }
+        nLastBlockchainSyncCheck = GetTime();
 
-    // if the last call to this function was more than 60 minutes ago (client was in sleep mode) reset the sync process
-    if (GetTime() - lastProcess > 60 * 60) {
-        Reset();
-        fBlockchainSynced = false;
+        if (fBlockchainSynced)
+            return true;
     }
-    lastProcess = GetTime();
-
-    if (fBlockchainSynced)
-        return true;
 
     if (node::fImporting || node::fReindex)
         return false;
@@ -55,13 +63,14 @@ bool CMasternodeSync::IsBlockchainSynced()
     if (pindex->nTime + 60 * 60 < GetTime())
         return false;
 
-    fBlockchainSynced = true;
+    WITH_LOCK(cs, fBlockchainSynced = true);
 
     return true;
 }
 
 void CMasternodeSync::Reset()
 {
+    LOCK(cs);
     lastMasternodeList = 0;
     lastMasternodeWinner = 0;
     lastBudgetItem = 0;
@@ -78,6 +87,7 @@ void CMasternodeSync::Reset()
     countMasternodeWinner = 0;
     countBudgetItemProp = 0;
     countBudgetItemFin = 0;
+    setMasternodeListSnapshotPeers.clear();
     RequestedMasternodeAssets = MASTERNODE_SYNC_INITIAL;
     RequestedMasternodeAttempt = 0;
     nAssetSyncStarted = GetTime();
@@ -85,7 +95,9 @@ void CMasternodeSync::Reset()
 
 void CMasternodeSync::AddedMasternodeList(uint256 hash)
 {
-    if (mnodeman.mapSeenMasternodeBroadcast.count(hash)) {
+    const bool fSeen = mnodeman.IsBroadcastSeen(hash);
+    LOCK(cs);
+    if (fSeen) {
         if (mapSeenSyncMNB[hash] < MASTERNODE_SYNC_THRESHOLD) {
             lastMasternodeList = GetTime();
             mapSeenSyncMNB[hash]++;
@@ -96,9 +108,20 @@ void CMasternodeSync::AddedMasternodeList(uint256 hash)
     }
 }
 
+void CMasternodeSync::AddedMasternodeListSnapshot(int64_t nodeid)
+{
+    LOCK(cs);
+    if (RequestedMasternodeAssets != MASTERNODE_SYNC_LIST)
+        return;
+    lastMasternodeList = GetTime();
+    setMasternodeListSnapshotPeers.insert(nodeid);
+}
+
 void CMasternodeSync::AddedMasternodeWinner(uint256 hash)
 {
-    if (masternodePayments.mapMasternodePayeeVotes.count(hash)) {
+    const bool fSeen = WITH_LOCK(cs_mapMasternodePayeeVotes, return masternodePayments.mapMasternodePayeeVotes.count(hash) > 0);
+    LOCK(cs);
+    if (fSeen) {
         if (mapSeenSyncMNW[hash] < MASTERNODE_SYNC_THRESHOLD) {
             lastMasternodeWinner = GetTime();
             mapSeenSyncMNW[hash]++;
@@ -111,7 +134,9 @@ void CMasternodeSync::AddedMasternodeWinner(uint256 hash)
 
 void CMasternodeSync::AddedBudgetItem(uint256 hash)
 {
-    if (budget.mapSeenMasternodeBudgetProposals.count(hash) || budget.mapSeenMasternodeBudgetVotes.count(hash) || budget.mapSeenFinalizedBudgets.count(hash) || budget.mapSeenFinalizedBudgetVotes.count(hash)) {
+    const bool fSeen = WITH_LOCK(budget.cs, return budget.mapSeenMasternodeBudgetProposals.count(hash) || budget.mapSeenMasternodeBudgetVotes.count(hash) || budget.mapSeenFinalizedBudgets.count(hash) || budget.mapSeenFinalizedBudgetVotes.count(hash));
+    LOCK(cs);
+    if (fSeen) {
         if (mapSeenSyncBudget[hash] < MASTERNODE_SYNC_THRESHOLD) {
             lastBudgetItem = GetTime();
             mapSeenSyncBudget[hash]++;
@@ -124,16 +149,19 @@ void CMasternodeSync::AddedBudgetItem(uint256 hash)
 
 bool CMasternodeSync::IsBudgetPropEmpty()
 {
+    LOCK(cs);
     return sumBudgetItemProp == 0 && countBudgetItemProp > 0;
 }
 
 bool CMasternodeSync::IsBudgetFinEmpty()
 {
+    LOCK(cs);
     return sumBudgetItemFin == 0 && countBudgetItemFin > 0;
 }
 
 void CMasternodeSync::GetNextAsset(CConnman* connman)
 {
+    LOCK(cs);
     switch (RequestedMasternodeAssets) {
     case (MASTERNODE_SYNC_INITIAL):
     case (MASTERNODE_SYNC_FAILED): // should never be used here actually, use Reset() instead
@@ -187,6 +215,7 @@ void CMasternodeSync::ProcessMessage(CNode* pfrom, const std::string& strCommand
         int nCount;
         vRecv >> nItemID >> nCount;
 
+        LOCK(cs);
         if (RequestedMasternodeAssets >= MASTERNODE_SYNC_FINISHED)
             return;
 
@@ -234,17 +263,39 @@ void CMasternodeSync::ClearFulfilledRequest(CConnman& connman)
 
 void CMasternodeSync::Process(CConnman* connman)
 {
-    const CNetMsgMaker msgMaker(PROTOCOL_VERSION);
     static int tick = 0;
 
     if (tick++ % MASTERNODE_SYNC_TIMEOUT != 0)
         return;
 
+    LogPrint(BCLog::MASTERNODE, "CMasternodeSync::Process() - tick %d RequestedMasternodeAssets %d\n", tick, RequestedMasternodeAssets);
+
+    // the managers are asked before cs is taken and told after it is
+    // released, as they call in here while holding their own locks
+    const int nMnCount = mnodeman.CountEnabled();
+    std::vector<CNode*> vNodesCopy;
+    connman->CopyNodeVector(vNodesCopy);
+
+    CNode* pnodeDseg = nullptr;
+    bool fManageStatus = false;
+    WITH_LOCK(cs, ProcessAssets(connman, nMnCount, vNodesCopy, pnodeDseg, fManageStatus));
+
+    if (pnodeDseg)
+        mnodeman.DsegUpdate(pnodeDseg, connman);
+    //try to activate our masternode if possible
+    if (fManageStatus)
+        activeMasternode.ManageStatus(connman);
+}
+
+void CMasternodeSync::ProcessAssets(CConnman* connman, int nMnCount, const std::vector<CNode*>& vNodesCopy, CNode*& pnodeDseg, bool& fManageStatus)
+{
+    const CNetMsgMaker msgMaker(PROTOCOL_VERSION);
+
     if (IsSynced()) {
         /*
             Resync if we lose all masternodes from sleep/wake or failure to sync originally
         */
-        if (mnodeman.CountEnabled() == 0) {
+        if (nMnCount == 0) {
             Reset();
         } else
             return;
@@ -257,16 +308,12 @@ void CMasternodeSync::Process(CConnman* connman)
         return;
     }
 
-    LogPrint(BCLog::MASTERNODE, "CMasternodeSync::Process() - tick %d RequestedMasternodeAssets %d\n", tick, RequestedMasternodeAssets);
-
     if (RequestedMasternodeAssets == MASTERNODE_SYNC_INITIAL)
         GetNextAsset(connman);
 
     if (!IsBlockchainSynced() && RequestedMasternodeAssets > MASTERNODE_SYNC_SPORKS)
         return;
 
-    std::vector<CNode*> vNodesCopy;
-    connman->CopyNodeVector(vNodesCopy);
     for (auto& pnode : vNodesCopy)
     {
         if (RequestedMasternodeAssets == MASTERNODE_SYNC_SPORKS) {
@@ -283,6 +330,12 @@ void CMasternodeSync::Process(CConnman* connman)
         if (pnode->nVersion >= masternodePayments.GetMinMasternodePaymentsProto()) {
             if (RequestedMasternodeAssets == MASTERNODE_SYNC_LIST) {
                 LogPrint(BCLog::MASTERNODE, "CMasternodeSync::Process() - lastMasternodeList %lld (GetTime() - MASTERNODE_SYNC_TIMEOUT) %lld\n", lastMasternodeList, GetTime() - MASTERNODE_SYNC_TIMEOUT);
+                // the whole list came in at once from enough peers, nothing left to wait for
+                if (setMasternodeListSnapshotPeers.size() >= MASTERNODE_SYNC_THRESHOLD) {
+                    GetNextAsset(connman);
+                    return;
+                }
+
                 if (lastMasternodeList > 0 && lastMasternodeList < GetTime() - MASTERNODE_SYNC_TIMEOUT * 2 && RequestedMasternodeAttempt >= MASTERNODE_SYNC_THRESHOLD) { // hasn't received a new item in the last five seconds, so we'll move to the
                     GetNextAsset(connman);
                     return;
@@ -309,7 +362,7 @@ void CMasternodeSync::Process(CConnman* connman)
                 if (RequestedMasternodeAttempt >= MASTERNODE_SYNC_THRESHOLD * 3)
                     return;
 
-                mnodeman.DsegUpdate(pnode, connman);
+                pnodeDseg = pnode;
                 RequestedMasternodeAttempt++;
                 return;
             }
@@ -341,7 +394,6 @@ void CMasternodeSync::Process(CConnman* connman)
                 if (RequestedMasternodeAttempt >= MASTERNODE_SYNC_THRESHOLD * 3)
                     return;
 
-                int nMnCount = mnodeman.CountEnabled();
                 connman->PushMessage(pnode, msgMaker.Make(NetMsgType::GETMNWINNERS, nMnCount));
                 RequestedMasternodeAttempt++;
 
@@ -354,10 +406,7 @@ void CMasternodeSync::Process(CConnman* connman)
             if (lastBudgetItem > 0 && lastBudgetItem < GetTime() - MASTERNODE_SYNC_TIMEOUT * 2 && RequestedMasternodeAttempt >= MASTERNODE_SYNC_THRESHOLD) { //hasn't received a new item in the last five seconds, so we'll move to the
                 // Hasn't received a new item in the last five seconds, so we'll move to the
                 GetNextAsset(connman);
-
-                //try to activate our masternode if possible
-                activeMasternode.ManageStatus(connman);
-
+                fManageStatus = true;
                 return;
             }
 
@@ -365,7 +414,7 @@ void CMasternodeSync::Process(CConnman* connman)
             if (lastBudgetItem == 0 && (RequestedMasternodeAttempt >= MASTERNODE_SYNC_THRESHOLD * 3 || GetTime() - nAssetSyncStarted > MASTERNODE_SYNC_TIMEOUT * 5)) {
                 // maybe there is no budgets at all, so just finish syncing
                 GetNextAsset(connman);
-                activeMasternode.ManageStatus(connman);
+                fManageStatus = true;
                 return;
             }
 
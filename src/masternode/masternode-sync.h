@@ -17,6 +17,23 @@
 
 #define MASTERNODE_SYNC_TIMEOUT 5
 #define MASTERNODE_SYNC_THRESHOLD 2
+// items whose sync announcements are counted, and for how long
+#define MASTERNODE_SYNC_SEEN_MAX 50000
+#define MASTERNODE_SYNC_SEEN_SECONDS (3 * 60 * 60)
+
+#include <masternode/seencache.h>
+#include <sync.h>
+
+#include <atomic>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+class CConnman;
+class CDataStream;
+class ChainstateManager;
+class CNode;
 
 //
 // CMasternodeSync : Sync masternode assets in stages
@@ -26,34 +43,47 @@ class CMasternodeSync {
 private:
     ChainstateManager* chainman{nullptr};
 
+    // state of IsBlockchainSynced
+    bool fBlockchainSynced GUARDED_BY(cs){false};
+    int64_t nLastBlockchainSyncCheck GUARDED_BY(cs){0};
+
+    void ProcessAssets(CConnman* connman, int nMnCount, const std::vector<CNode*>& vNodes, CNode*& pnodeDseg, bool& fManageStatus) EXCLUSIVE_LOCKS_REQUIRED(cs);
+
 public:
-    std::map<uint256, int> mapSeenSyncMNB;
-    std::map<uint256, int> mapSeenSyncMNW;
-    std::map<uint256, int> mapSeenSyncBudget;
+    // critical section to protect the sync state, which the message workers
+    // and the masternode thread update at once. The managers call in while
+    // holding their own locks, so none of them is locked while holding it.
+    mutable RecursiveMutex cs;
+
+    CSeenCache<uint256, int> mapSeenSyncMNB GUARDED_BY(cs){MASTERNODE_SYNC_SEEN_MAX, MASTERNODE_SYNC_SEEN_SECONDS};
+    CSeenCache<uint256, int> mapSeenSyncMNW GUARDED_BY(cs){MASTERNODE_SYNC_SEEN_MAX, MASTERNODE_SYNC_SEEN_SECONDS};
+    CSeenCache<uint256, int> mapSeenSyncBudget GUARDED_BY(cs){MASTERNODE_SYNC_SEEN_MAX, MASTERNODE_SYNC_SEEN_SECONDS};
 
-    int64_t lastMasternodeList;
-    int64_t lastMasternodeWinner;
-    int64_t lastBudgetItem;
-    int64_t lastFailure;
-    int nCountFailures;
+    int64_t lastMasternodeList GUARDED_BY(cs);
+    int64_t lastMasternodeWinner GUARDED_BY(cs);
+    int64_t lastBudgetItem GUARDED_BY(cs);
+    int64_t lastFailure GUARDED_BY(cs);
+    int nCountFailures GUARDED_BY(cs);
 
     // sum of all counts
-    int sumMasternodeList;
-    int sumMasternodeWinner;
-    int sumBudgetItemProp;
-    int sumBudgetItemFin;
+    int sumMasternodeList GUARDED_BY(cs);
+    int sumMasternodeWinner GUARDED_BY(cs);
+    int sumBudgetItemProp GUARDED_BY(cs);
+    int sumBudgetItemFin GUARDED_BY(cs);
     // peers that reported counts
-    int countMasternodeList;
-    int countMasternodeWinner;
-    int countBudgetItemProp;
-    int countBudgetItemFin;
+    int countMasternodeList GUARDED_BY(cs);
+    int countMasternodeWinner GUARDED_BY(cs);
+    int countBudgetItemProp GUARDED_BY(cs);
+    int countBudgetItemFin GUARDED_BY(cs);
+    // ids of the peers that sent the whole list as the snapshot we asked them for
+    std::set<int64_t> setMasternodeListSnapshotPeers GUARDED_BY(cs);
 
-    // Count peers we've requested the list from
-    int RequestedMasternodeAssets;
-    int RequestedMasternodeAttempt;
+    // Count peers we've requested the list from, the asset is only changed under cs
+    std::atomic<int> RequestedMasternodeAssets;
+    int RequestedMasternodeAttempt GUARDED_BY(cs);
 
     // Time when current masternode asset sync started
-    int64_t nAssetSyncStarted;
+    int64_t nAssetSyncStarted GUARDED_BY(cs);
 
     CMasternodeSync();
 
@@ -63,6 +93,7 @@ public:
     }
 
     void AddedMasternodeList(uint256 hash);
+    void AddedMasternodeListSnapshot(int64_t nodeid);
     void AddedMasternodeWinner(uint256 hash);
     void AddedBudgetItem(uint256 hash);
     void GetNextAsset(CConnman* connman);
@@ -72,6 +103,8 @@ public:
     bool IsBudgetPropEmpty();
 
     void Reset();
+    /// Get the sizes of the seen-message caches
+    void GetSeenCacheStats(std::map<std::string, CSeenCacheStats>& mapStats);
     void Process(CConnman* connman);
     bool IsSynced();
     bool IsBlockchainSynced();
@@ -18,10 +18,8 @@
 
 // keep track of the scanning errors I've seen
 std::map<uint256, int> mapSeenMasternodeScanningErrors;
-// cache block hashes as we calculate them
-std::map<int64_t, uint256> mapCacheBlockHashes;
 
-// Get the last hash that matches the modulus given. Processed in reverse order
+// Get the hash of the block at height nBlockHeight - 1 on the chain ending in pindex
 bool GetBlockHash(uint256& hash, int nBlockHeight, CBlockIndex* pindex)
 {
     if (!pindex)
@@ -30,39 +28,16 @@ bool GetBlockHash(uint256& hash, int nBlockHeight, CBlockIndex* pindex)
     if (!nBlockHeight)
         nBlockHeight = pindex->nHeight;
 
-    if (mapCacheBlockHashes.count(nBlockHeight)) {
-        hash = mapCacheBlockHashes[nBlockHeight];
-        return true;
-    }
-
-    const CBlockIndex* BlockLastSolved = pindex;
-    const CBlockIndex* BlockReading = pindex;
-
-    if (!BlockLastSolved || BlockLastSolved->nHeight == 0 || pindex->nHeight + 1 < nBlockHeight)
+    if (pindex->nHeight == 0 || pindex->nHeight + 1 < nBlockHeight)
         return false;
 
-    int nBlocksAgo = 0;
-    if (nBlockHeight > 0)
-        nBlocksAgo = (pindex->nHeight + 1) - nBlockHeight;
-    assert(nBlocksAgo >= 0);
-
-    int n = 0;
-    for (unsigned int i = 1; BlockReading && BlockReading->nHeight > 0; i++) {
-        if (n >= nBlocksAgo) {
-            hash = BlockReading->GetBlockHash();
-            mapCacheBlockHashes[nBlockHeight] = hash;
-            return true;
-        }
-        n++;
-
-        if (BlockReading->pprev == NULL) {
-            assert(BlockReading);
-            break;
-        }
-        BlockReading = BlockReading->pprev;
-    }
+    int nHeight = nBlockHeight > 0 ? nBlockHeight - 1 : pindex->nHeight;
+    if (nHeight <= 0)
+        return false;
 
-    return false;
+    // the skip list makes this O(log n), and the ancestors of pindex do not change on reorgs
+    hash = pindex->GetAncestor(nHeight)->GetBlockHash();
+    return true;
 }
 
 CMasternode::CMasternode()
@@ -85,6 +60,7 @@ CMasternode::CMasternode()
     nLastDsq = 0;
     nScanningErrorCount = 0;
     nLastScanningErrorBlockHeight = 0;
+    fCacheChanged = true;
     lastTimeChecked = 0;
 }
 
@@ -108,6 +84,7 @@ CMasternode::CMasternode(const CMasternode& other)
     nLastDsq = other.nLastDsq;
     nScanningErrorCount = other.nScanningErrorCount;
     nLastScanningErrorBlockHeight = other.nLastScanningErrorBlockHeight;
+    fCacheChanged = other.fCacheChanged;
     lastTimeChecked = 0;
 }
 
@@ -131,6 +108,7 @@ CMasternode::CMasternode(const CMasternodeBroadcast& mnb)
     nLastDsq = mnb.nLastDsq;
     nScanningErrorCount = 0;
     nLastScanningErrorBlockHeight = 0;
+    fCacheChanged = true;
     lastTimeChecked = 0;
 }
 
@@ -150,8 +128,9 @@ bool CMasternode::UpdateFromNewBroadcast(CMasternodeBroadcast& mnb, CConnman* co
         int nDoS = 0;
         if (mnb.lastPing == CMasternodePing() || (mnb.lastPing != CMasternodePing() && mnb.lastPing.CheckAndUpdate(nDoS, connman, false))) {
             lastPing = mnb.lastPing;
-            mnodeman.mapSeenMasternodePing.insert(std::make_pair(lastPing.GetHash(), lastPing));
+            mnodeman.AddSeenPing(lastPing);
         }
+        fCacheChanged = true;
         return true;
     }
     return false;
@@ -162,7 +141,7 @@ bool CMasternode::UpdateFromNewBroadcast(CMasternodeBroadcast& mnb, CConnman* co
 // the proof of work for that block. The further away they are the better, the furthest will win the election
 // and get paid this block
 //
-uint256 CMasternode::CalculateScore(int mod, int64_t nBlockHeight, CBlockIndex* pindex)
+uint256 CMasternode::CalculateScore(int mod, int64_t nBlockHeight, CBlockIndex* pindex) const
 {
     if (!pindex)
         return uint256();
@@ -240,17 +219,17 @@ void CMasternode::Check(bool forceCheck)
         return;
 
     if (!IsPingedWithin(MASTERNODE_REMOVAL_SECONDS)) {
-        activeState = MASTERNODE_REMOVE;
+        SetActiveState(MASTERNODE_REMOVE);
         return;
     }
 
     if (!IsPingedWithin(MASTERNODE_EXPIRATION_SECONDS)) {
-        activeState = MASTERNODE_EXPIRED;
+        SetActiveState(MASTERNODE_EXPIRED);
         return;
     }
 
     if (lastPing.sigTime - sigTime < MASTERNODE_MIN_MNP_SECONDS) {
-        activeState = MASTERNODE_PRE_ENABLED;
+        SetActiveState(MASTERNODE_PRE_ENABLED);
         return;
     }
 
@@ -263,15 +242,12 @@ void CMasternode::Check(bool forceCheck)
         }
     }
 
-    activeState = MASTERNODE_ENABLED; // OK
+    SetActiveState(MASTERNODE_ENABLED); // OK
 }
 
-int64_t CMasternode::SecondsSincePayment(CBlockIndex* pindex)
+int64_t CMasternode::SecondsSincePayment(CBlockIndex* pindex, int nEnabled)
 {
-    CScript pubkeyScript;
-    pubkeyScript = GetScriptForDestination(PKHash(pubKeyCollateralAddress));
-
-    int64_t sec = (TicksSinceEpoch<std::chrono::seconds>(GetAdjustedTime()) - GetLastPaid(pindex));
+    int64_t sec = (TicksSinceEpoch<std::chrono::seconds>(GetAdjustedTime()) - GetLastPaid(pindex, nEnabled));
     int64_t month = 60 * 60 * 24 * 30;
     if (sec < month)
         return sec; // if it's less than 30 days, give seconds
@@ -287,7 +263,7 @@ int64_t CMasternode::SecondsSincePayment(CBlockIndex* pindex)
     return temp;
 }
 
-int64_t CMasternode::GetLastPaid(CBlockIndex* pindex)
+int64_t CMasternode::GetLastPaid(CBlockIndex* pindex, int nEnabled) const
 {
     if (!pindex)
         return false;
@@ -303,37 +279,16 @@ int64_t CMasternode::GetLastPaid(CBlockIndex* pindex)
     // use a deterministic offset to break a tie -- 2.5 minutes
     int64_t nOffset = UintToArith256(hash).GetCompact(false) % 150;
 
-    if (!pindex)
-        return false;
-
-    const CBlockIndex* BlockReading = pindex;
-
-    int nMnCount = mnodeman.CountEnabled() * 1.25;
-    int n = 0;
-    for (unsigned int i = 1; BlockReading && BlockReading->nHeight > 0; i++) {
-        if (n >= nMnCount) {
-            return 0;
-        }
-        n++;
-
-        if (masternodePayments.mapMasternodeBlocks.count(BlockReading->nHeight)) {
-            /*
-                Search for this payee, with at least 2 votes. This will aid in consensus allowing the network
-                to converge on the same payees quickly, then keep the same schedule.
-            */
-            if (masternodePayments.mapMasternodeBlocks[BlockReading->nHeight].HasPayeeWithVotes(mnpayee, 2)) {
-                return BlockReading->nTime + nOffset;
-            }
-        }
+    /*
+        Search the last blocks for this payee, with at least 2 votes. This will aid in consensus allowing the network
+        to converge on the same payees quickly, then keep the same schedule.
+    */
+    int nMnCount = (nEnabled < 0 ? mnodeman.CountEnabled() : nEnabled) * 1.25;
+    int nHeight = masternodePayments.GetLastPaidHeight(mnpayee, std::max(1, pindex->nHeight - nMnCount + 1), pindex->nHeight);
+    if (nHeight <= 0)
+        return 0;
 
-        if (BlockReading->pprev == NULL) {
-            assert(BlockReading);
-            break;
-        }
-        BlockReading = BlockReading->pprev;
-    }
-
-    return 0;
+    return pindex->GetAncestor(nHeight)->nTime + nOffset;
 }
 
 std::string CMasternode::GetStatus()
@@ -591,7 +546,7 @@ bool CMasternodeBroadcast::CheckAndUpdate(int& nDos, CConnman* connman)
     if (pmn->pubKeyCollateralAddress == pubKeyCollateralAddress && !pmn->IsBroadcastedWithin(MASTERNODE_MIN_MNB_SECONDS)) {
         // take the newest entry
         LogPrint(BCLog::MASTERNODE, "mnb - Got updated entry for %s\n", vin.prevout.hash.ToString());
-        if (pmn->UpdateFromNewBroadcast((*this), connman)) {
+        if (mnodeman.UpdateFromNewBroadcast(*pmn, (*this), connman)) {
             pmn->Check();
             if (pmn->IsEnabled())
                 Relay(connman);
@@ -632,8 +587,8 @@ bool CMasternodeBroadcast::CheckInputsAndAdd(int& nDoS, Chainstate& chainstate,
     if (GetInputAge(vin, chainstate) < MASTERNODE_MIN_CONFIRMATIONS) {
         LogPrint(BCLog::MASTERNODE, "mnb - Input must have at least %d confirmations\n", MASTERNODE_MIN_CONFIRMATIONS);
         // maybe we miss few blocks, let this mnb to be checked again later
-        mnodeman.mapSeenMasternodeBroadcast.erase(GetHash());
-        masternodeSync.mapSeenSyncMNB.erase(GetHash());
+        mnodeman.RemoveSeenBroadcast(GetHash());
+        WITH_LOCK(masternodeSync.cs, masternodeSync.mapSeenSyncMNB.erase(GetHash()));
         return false;
     }
 
@@ -760,7 +715,7 @@ bool CMasternodePing::Sign(CKey& keyMasternode, CPubKey& pubKeyMasternode)
     std::string strMasterNodeSignMessage;
 
     sigTime = TicksSinceEpoch<std::chrono::seconds>(GetAdjustedTime());
-    std::string strMessage = vin.ToString() + blockHash.ToString() + std::to_string(sigTime);
+    std::string strMessage = GetStrMessage();
 
     if (!legacySigner.SignMessage(strMessage, vchSig, keyMasternode)) {
         LogPrint(BCLog::MASTERNODE, "CMasternodePing::Sign() - Error: %s\n", errorMessage);
@@ -778,7 +733,7 @@ bool CMasternodePing::Sign(CKey& keyMasternode, CPubKey& pubKeyMasternode)
 bool CMasternodePing::VerifySignature(CPubKey& pubKeyMasternode, int& nDos)
 {
     std::string errorMessage;
-    std::string strMessage = vin.ToString() + blockHash.ToString() + std::to_string(sigTime);
+    std::string strMessage = GetStrMessage();
 
     if (!legacySigner.VerifyMessage(pubKeyMasternode, vchSig, strMessage, errorMessage)) {
         nDos = 33;
@@ -787,6 +742,11 @@ bool CMasternodePing::VerifySignature(CPubKey& pubKeyMasternode, int& nDos)
     return true;
 }
 
+std::string CMasternodePing::GetStrMessage() const
+{
+    return vin.ToString() + blockHash.ToString() + std::to_string(sigTime);
+}
+
 bool CMasternodePing::CheckAndUpdate(int& nDos, CConnman* connman, bool fRequireEnabled, bool fCheckSigTimeOnly)
 {
     if (sigTime > TicksSinceEpoch<std::chrono::seconds>(GetAdjustedTime()) + 60 * 60) {
@@ -841,13 +801,11 @@ bool CMasternodePing::CheckAndUpdate(int& nDos, CConnman* connman, bool fRequire
             }
 
             pmn->lastPing = *this;
+            pmn->fCacheChanged = true;
 
             // mnodeman.mapSeenMasternodeBroadcast.lastPing is probably outdated, so we'll update it
             CMasternodeBroadcast mnb(*pmn);
-            uint256 hash = mnb.GetHash();
-            if (mnodeman.mapSeenMasternodeBroadcast.count(hash)) {
-                mnodeman.mapSeenMasternodeBroadcast[hash].lastPing = *this;
-            }
+            mnodeman.UpdateSeenBroadcastPing(mnb.GetHash(), *this);
 
             pmn->Check(true);
             if (!pmn->IsEnabled())
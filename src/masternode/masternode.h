@@ -25,7 +25,6 @@ class CConnman;
 class CMasternode;
 class CMasternodeBroadcast;
 class CMasternodePing;
-extern std::map<int64_t, uint256> mapCacheBlockHashes;
 
 bool GetBlockHash(uint256& hash, int nBlockHeight, CBlockIndex* pindex);
 
@@ -56,8 +55,9 @@ public:
     bool Sign(CKey& keyMasternode, CPubKey& pubKeyMasternode);
     bool VerifySignature(CPubKey& pubKeyMasternode, int& nDos);
     void Relay(CConnman* connman);
+    std::string GetStrMessage() const;
 
-    uint256 GetHash()
+    uint256 GetHash() const
     {
         CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
         ss << vin;
@@ -105,6 +105,14 @@ private:
     mutable RecursiveMutex cs;
     int64_t lastTimeChecked;
 
+    void SetActiveState(int nState)
+    {
+        if (activeState != nState) {
+            activeState = nState;
+            fCacheChanged = true;
+        }
+    }
+
 public:
     enum state {
         MASTERNODE_PRE_ENABLED,
@@ -143,6 +151,8 @@ public:
     int nScanningErrorCount;
     int nLastScanningErrorBlockHeight;
     CMasternodePing lastPing;
+    // changed since it was last written to the masternode cache database, not serialized
+    bool fCacheChanged;
 
     CMasternode();
     CMasternode(const CMasternode& other);
@@ -171,6 +181,7 @@ public:
         swap(first.nLastDsq, second.nLastDsq);
         swap(first.nScanningErrorCount, second.nScanningErrorCount);
         swap(first.nLastScanningErrorBlockHeight, second.nLastScanningErrorBlockHeight);
+        swap(first.fCacheChanged, second.fCacheChanged);
     }
 
     CMasternode& operator=(CMasternode from)
@@ -187,7 +198,7 @@ public:
         return !(a.vin == b.vin);
     }
 
-    uint256 CalculateScore(int mod = 1, int64_t nBlockHeight = 0, CBlockIndex* pindex = nullptr);
+    uint256 CalculateScore(int mod = 1, int64_t nBlockHeight = 0, CBlockIndex* pindex = nullptr) const;
 
     SERIALIZE_METHODS(CMasternode, obj)
     {
@@ -209,7 +220,7 @@ public:
         READWRITE(obj.nLastScanningErrorBlockHeight);
     }
 
-    int64_t SecondsSincePayment(CBlockIndex* pindex);
+    int64_t SecondsSincePayment(CBlockIndex* pindex, int nEnabled = -1);
 
     bool UpdateFromNewBroadcast(CMasternodeBroadcast& mnb, CConnman* connman);
 
@@ -240,14 +251,14 @@ public:
         lastPing = CMasternodePing();
     }
 
-    bool IsEnabled()
+    bool IsEnabled() const
     {
         return activeState == MASTERNODE_ENABLED;
     }
 
     std::string GetStatus();
 
-    std::string Status()
+    std::string Status() const
     {
         std::string strStatus = "ACTIVE";
 
@@ -267,7 +278,8 @@ public:
 
     CollateralStatus CheckCollateral(const COutPoint& outpoint);
     CollateralStatus CheckCollateral(const COutPoint& outpoint, int& nHeightRet, Chainstate& chainstate);
-    int64_t GetLastPaid(CBlockIndex* pindex);
+    /// Time of the last payment within the last nEnabled * 1.25 blocks, nEnabled defaults to the enabled masternode count
+    int64_t GetLastPaid(CBlockIndex* pindex, int nEnabled = -1) const;
     bool IsValidNetAddr();
 };
 
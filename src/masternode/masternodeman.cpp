@@ -8,6 +8,7 @@
 #include <masternode/activemasternode.h>
 #include <masternode/masternode.h>
 #include <masternode/masternodeman.h>
+#include <masternode/mncachedb.h>
 #include <masternode/masternodesigner.h>
 #include <masternode/masternode-payments.h>
 #include <masternode/masternode-sync.h>
@@ -25,22 +26,6 @@ struct CompareLastPaid {
     }
 };
 
-struct CompareScoreTxIn {
-    bool operator()(const std::pair<int64_t, CTxIn>& t1,
-        const std::pair<int64_t, CTxIn>& t2) const
-    {
-        return t1.first < t2.first;
-    }
-};
-
-struct CompareScoreMN {
-    bool operator()(const std::pair<int64_t, CMasternode>& t1,
-        const std::pair<int64_t, CMasternode>& t2) const
-    {
-        return t1.first < t2.first;
-    }
-};
-
 //
 // CMasternodeDB
 //
@@ -51,39 +36,6 @@ CMasternodeDB::CMasternodeDB()
     strMagicMessage = "MasternodeCache";
 }
 
-bool CMasternodeDB::Write(const CMasternodeMan& mnodemanToSave)
-{
-    int64_t nStart = GetTimeMillis();
-
-    // serialize, checksum data up to that point, then append checksum
-    CDataStream ssMasternodes(SER_DISK, CLIENT_VERSION);
-    ssMasternodes << strMagicMessage; // masternode cache file specific magic message
-    ssMasternodes << Params().MessageStart(); // network specific magic number
-    ssMasternodes << mnodemanToSave;
-    uint256 hash = Hash(ssMasternodes);
-    ssMasternodes << hash;
-
-    // open output file, and associate with CAutoFile
-    FILE* file = fopen(pathMN.string().c_str(), "wb");
-    CAutoFile fileout(file, SER_DISK, CLIENT_VERSION);
-    if (fileout.IsNull())
-        return error("%s : Failed to open file %s", __func__, pathMN.string());
-
-    // Write and commit header, data
-    try {
-        fileout << ssMasternodes;
-    } catch (std::exception& e) {
-        return error("%s : Serialize or I/O error - %s", __func__, e.what());
-    }
-    //    FileCommit(fileout);
-    fileout.fclose();
-
-    LogPrint(BCLog::MASTERNODE, "Written info to mncache.dat  %dms\n", GetTimeMillis() - nStart);
-    LogPrint(BCLog::MASTERNODE, "  %s\n", mnodemanToSave.ToString());
-
-    return true;
-}
-
 CMasternodeDB::ReadResult CMasternodeDB::Read(CMasternodeMan& mnodemanToLoad, bool fDryRun)
 {
     int64_t nStart = GetTimeMillis();
@@ -165,36 +117,105 @@ CMasternodeDB::ReadResult CMasternodeDB::Read(CMasternodeMan& mnodemanToLoad, bo
     return Ok;
 }
 
-void DumpMasternodes()
+void CMasternodeMan::GetSeenCacheStats(std::map<std::string, CSeenCacheStats>& mapStats)
+{
+    LOCK(cs);
+    mapStats["seen_broadcasts"] = mapSeenMasternodeBroadcast.GetStats();
+    mapStats["seen_pings"] = mapSeenMasternodePing.GetStats();
+}
+
+void CMasternodeMan::SetCacheChanged()
+{
+    LOCK(cs);
+    changedMasternodes.SetAll();
+    changedSeenBroadcasts.SetAll();
+    changedSeenPings.SetAll();
+    changedState.SetAll();
+}
+
+bool CMasternodeMan::FlushCache(CMasternodeCacheDB& db)
+{
+    CDBBatch batch(db);
+    {
+        LOCK(cs);
+
+        for (CMasternode& mn : vMasternodes) {
+            if (mn.fCacheChanged) {
+                changedMasternodes.Set(mn.vin.prevout);
+                mn.fCacheChanged = false;
+            }
+        }
+        db.masternodes.Write<CMasternode>(
+            batch, changedMasternodes,
+            [&](const COutPoint& outpoint) -> const CMasternode* {
+                auto it = mapOutpointIndex.find(outpoint);
+                return it == mapOutpointIndex.end() ? nullptr : &vMasternodes[it->second];
+            },
+            [&](auto fn) {
+                for (const CMasternode& mn : vMasternodes) {
+                    fn(mn.vin.prevout, mn);
+                }
+            });
+        mapSeenMasternodeBroadcast.TakeChanges([&](const uint256& hash) { changedSeenBroadcasts.Set(hash); });
+        db.seenBroadcasts.Write(batch, mapSeenMasternodeBroadcast, changedSeenBroadcasts);
+        mapSeenMasternodePing.TakeChanges([&](const uint256& hash) { changedSeenPings.Set(hash); });
+        db.seenPings.Write(batch, mapSeenMasternodePing, changedSeenPings);
+        db.masternodeState.Write(batch, 'a', mAskedUsForMasternodeList, changedState);
+        db.masternodeState.Write(batch, 'w', mWeAskedForMasternodeList, changedState);
+        db.masternodeState.Write(batch, 'e', mWeAskedForMasternodeListEntry, changedState);
+        db.masternodeState.Write(batch, 'd', nDsqCount, changedState);
+        db.masternodeState.Finish(changedState);
+    }
+
+    return db.WriteCacheBatch(batch);
+}
+
+bool CMasternodeMan::LoadCache(CMasternodeCacheDB& db)
 {
     int64_t nStart = GetTimeMillis();
 
-    CMasternodeDB mndb;
-    CMasternodeMan tempMnodeman;
-
-    LogPrint(BCLog::MASTERNODE, "Verifying mncache.dat format...\n");
-    CMasternodeDB::ReadResult readResult = mndb.Read(tempMnodeman, true);
-    // there was an error and it was not an error on file opening => do not proceed
-    if (readResult == CMasternodeDB::FileError)
-        LogPrint(BCLog::MASTERNODE, "Missing masternode cache file - mncache.dat, will try to recreate\n");
-    else if (readResult != CMasternodeDB::Ok) {
-        LogPrint(BCLog::MASTERNODE, "Error reading mncache.dat: ");
-        if (readResult == CMasternodeDB::IncorrectFormat)
-            LogPrint(BCLog::MASTERNODE, "magic is ok but data has invalid format, will try to recreate\n");
-        else {
-            LogPrint(BCLog::MASTERNODE, "file format is unknown or invalid, please fix it manually\n");
-            return;
+    {
+        LOCK(cs);
+        Clear();
+
+        bool fOk = db.masternodes.Read<CMasternode>([&](const COutPoint&, const CMasternode& mn) { vMasternodes.push_back(mn); });
+        fOk &= db.seenBroadcasts.Read<CMasternodeBroadcast>([&](const uint256& hash, const CMasternodeBroadcast& mnb) { mapSeenMasternodeBroadcast.emplace(hash, mnb); });
+        fOk &= db.seenPings.Read<CMasternodePing>([&](const uint256& hash, const CMasternodePing& mnp) { mapSeenMasternodePing.emplace(hash, mnp); });
+        db.masternodeState.Read('a', mAskedUsForMasternodeList);
+        db.masternodeState.Read('w', mWeAskedForMasternodeList);
+        db.masternodeState.Read('e', mWeAskedForMasternodeListEntry);
+        db.masternodeState.Read('d', nDsqCount);
+        if (!fOk) {
+            Clear();
+            return error("%s : Deserialize error", __func__);
         }
+        RebuildIndexes();
+
+        // what was read is what the database has
+        for (CMasternode& mn : vMasternodes) {
+            mn.fCacheChanged = false;
+        }
+        mapSeenMasternodeBroadcast.TakeChanges([](const uint256&) {});
+        mapSeenMasternodePing.TakeChanges([](const uint256&) {});
+        changedMasternodes.Clear();
+        changedSeenBroadcasts.Clear();
+        changedSeenPings.Clear();
+        changedState.Clear();
     }
-    LogPrint(BCLog::MASTERNODE, "Writting info to mncache.dat...\n");
-    mndb.Write(mnodeman);
 
-    LogPrint(BCLog::MASTERNODE, "Masternode dump finished  %dms\n", GetTimeMillis() - nStart);
+    LogPrint(BCLog::MASTERNODE, "Loaded masternode cache  %dms\n", GetTimeMillis() - nStart);
+    LogPrint(BCLog::MASTERNODE, "Masternode manager - cleaning....\n");
+    CheckAndRemove(true);
+    LogPrint(BCLog::MASTERNODE, "  %s\n", ToString());
+    return true;
 }
 
 CMasternodeMan::CMasternodeMan()
 {
     nDsqCount = 0;
+    listSnapshot = std::make_shared<const std::vector<CMasternode>>();
+    mapSeenMasternodeBroadcast.TrackChanges();
+    mapSeenMasternodePing.TrackChanges();
 }
 
 bool CMasternodeMan::Add(CMasternode& mn)
@@ -208,12 +229,38 @@ bool CMasternodeMan::Add(CMasternode& mn)
     if (!pmn) {
         LogPrint(BCLog::MASTERNODE, "CMasternodeMan: Adding new Masternode %s - %i now\n", mn.vin.prevout.hash.ToString(), size() + 1);
         vMasternodes.push_back(mn);
+        AddToIndexes(vMasternodes.size() - 1);
         return true;
     }
 
     return false;
 }
 
+void CMasternodeMan::AddToIndexes(size_t nPos)
+{
+    mapScoreCache.clear();
+    fListChanged = true;
+
+    const CMasternode& mn = vMasternodes[nPos];
+    mapOutpointIndex.emplace(mn.vin.prevout, nPos);
+    mapPubKeyIndex.emplace(mn.pubKeyMasternode, nPos);
+    mapPayeeIndex.emplace(GetScriptForDestination(PKHash(mn.pubKeyCollateralAddress)), nPos);
+}
+
+void CMasternodeMan::RebuildIndexes()
+{
+    LOCK(cs);
+
+    mapOutpointIndex.clear();
+    mapPubKeyIndex.clear();
+    mapPayeeIndex.clear();
+    mapScoreCache.clear();
+    fListChanged = true;
+    for (size_t i = 0; i < vMasternodes.size(); i++) {
+        AddToIndexes(i);
+    }
+}
+
 void CMasternodeMan::AskForMN(CNode* pnode, CTxIn& vin, CConnman* connman)
 {
     std::map<COutPoint, int64_t>::iterator i = mWeAskedForMasternodeListEntry.find(vin.prevout);
@@ -229,6 +276,7 @@ void CMasternodeMan::AskForMN(CNode* pnode, CTxIn& vin, CConnman* connman)
     connman->PushMessage(pnode, msgMaker.Make(NetMsgType::DSEG, vin));
     int64_t askAgain = GetTime() + MASTERNODE_MIN_MNP_SECONDS;
     mWeAskedForMasternodeListEntry[vin.prevout] = askAgain;
+    changedState.Set('e');
 }
 
 void CMasternodeMan::Check()
@@ -247,6 +295,7 @@ void CMasternodeMan::CheckAndRemove(bool forceExpiredRemoval)
     LOCK(cs);
 
     // remove inactive and outdated
+    bool fRemoved = false;
     std::vector<CMasternode>::iterator it = vMasternodes.begin();
     while (it != vMasternodes.end()) {
         if ((*it).activeState == CMasternode::MASTERNODE_REMOVE || (*it).activeState == CMasternode::MASTERNODE_VIN_SPENT || (forceExpiredRemoval && (*it).activeState == CMasternode::MASTERNODE_EXPIRED) || (*it).protocolVersion < masternodePayments.GetMinMasternodePaymentsProto()) {
@@ -255,10 +304,10 @@ void CMasternodeMan::CheckAndRemove(bool forceExpiredRemoval)
             // erase all of the broadcasts we've seen from this vin
             //  -- if we missed a few pings and the node was removed, this will allow is to get it back without them
             //     sending a brand new mnb
-            std::map<uint256, CMasternodeBroadcast>::iterator it3 = mapSeenMasternodeBroadcast.begin();
+            auto it3 = mapSeenMasternodeBroadcast.begin();
             while (it3 != mapSeenMasternodeBroadcast.end()) {
                 if ((*it3).second.vin == (*it).vin) {
-                    masternodeSync.mapSeenSyncMNB.erase((*it3).first);
+                    WITH_LOCK(masternodeSync.cs, masternodeSync.mapSeenSyncMNB.erase((*it3).first));
                     mapSeenMasternodeBroadcast.erase(it3++);
                 } else {
                     ++it3;
@@ -270,22 +319,31 @@ void CMasternodeMan::CheckAndRemove(bool forceExpiredRemoval)
             while (it2 != mWeAskedForMasternodeListEntry.end()) {
                 if ((*it2).first == (*it).vin.prevout) {
                     mWeAskedForMasternodeListEntry.erase(it2++);
+                    changedState.Set('e');
                 } else {
                     ++it2;
                 }
             }
 
+            changedMasternodes.Set((*it).vin.prevout);
             it = vMasternodes.erase(it);
+            fRemoved = true;
         } else {
             ++it;
         }
     }
+    if (fRemoved)
+        RebuildIndexes();
+
+    // states changed by Check() and pings don't always mark the list as changed
+    PublishListSnapshot();
 
     // check who's asked for the Masternode list
     std::map<CNetAddr, int64_t>::iterator it1 = mAskedUsForMasternodeList.begin();
     while (it1 != mAskedUsForMasternodeList.end()) {
         if ((*it1).second < GetTime()) {
             mAskedUsForMasternodeList.erase(it1++);
+            changedState.Set('a');
         } else {
             ++it1;
         }
@@ -296,6 +354,7 @@ void CMasternodeMan::CheckAndRemove(bool forceExpiredRemoval)
     while (it1 != mWeAskedForMasternodeList.end()) {
         if ((*it1).second < GetTime()) {
             mWeAskedForMasternodeList.erase(it1++);
+            changedState.Set('w');
         } else {
             ++it1;
         }
@@ -306,24 +365,25 @@ void CMasternodeMan::CheckAndRemove(bool forceExpiredRemoval)
     while (it2 != mWeAskedForMasternodeListEntry.end()) {
         if ((*it2).second < GetTime()) {
             mWeAskedForMasternodeListEntry.erase(it2++);
+            changedState.Set('e');
         } else {
             ++it2;
         }
     }
 
     // remove expired mapSeenMasternodeBroadcast
-    std::map<uint256, CMasternodeBroadcast>::iterator it3 = mapSeenMasternodeBroadcast.begin();
+    auto it3 = mapSeenMasternodeBroadcast.begin();
     while (it3 != mapSeenMasternodeBroadcast.end()) {
         if ((*it3).second.lastPing.sigTime < GetTime() - (MASTERNODE_REMOVAL_SECONDS * 2)) {
+            WITH_LOCK(masternodeSync.cs, masternodeSync.mapSeenSyncMNB.erase((*it3).first));
             mapSeenMasternodeBroadcast.erase(it3++);
-            masternodeSync.mapSeenSyncMNB.erase((*it3).second.GetHash());
         } else {
             ++it3;
         }
     }
 
     // remove expired mapSeenMasternodePing
-    std::map<uint256, CMasternodePing>::iterator it4 = mapSeenMasternodePing.begin();
+    auto it4 = mapSeenMasternodePing.begin();
     while (it4 != mapSeenMasternodePing.end()) {
         if ((*it4).second.sigTime < GetTime() - (MASTERNODE_REMOVAL_SECONDS * 2)) {
             mapSeenMasternodePing.erase(it4++);
@@ -337,12 +397,19 @@ void CMasternodeMan::Clear()
 {
     LOCK(cs);
     vMasternodes.clear();
+    mapOutpointIndex.clear();
+    mapPubKeyIndex.clear();
+    mapPayeeIndex.clear();
+    mapScoreCache.clear();
+    fListChanged = true;
     mAskedUsForMasternodeList.clear();
     mWeAskedForMasternodeList.clear();
     mWeAskedForMasternodeListEntry.clear();
+    setAskedForListSnapshot.clear();
     mapSeenMasternodeBroadcast.clear();
     mapSeenMasternodePing.clear();
     nDsqCount = 0;
+    SetCacheChanged();
 }
 
 int CMasternodeMan::stable_size()
@@ -426,10 +493,13 @@ void CMasternodeMan::DsegUpdate(CNode* pnode, CConnman* connman)
         }
     }
 
-    const CNetMsgMaker msgMaker(PROTOCOL_VERSION);
-    connman->PushMessage(pnode, CNetMsgMaker(pnode->GetCommonVersion()).Make(NetMsgType::DSEG, CTxIn()));
+    // ask for a snapshot, peers that don't know it send the list as inventory
+    const bool fSnapshot = true;
+    connman->PushMessage(pnode, CNetMsgMaker(pnode->GetCommonVersion()).Make(NetMsgType::DSEG, CTxIn(), fSnapshot));
+    setAskedForListSnapshot.insert(pnode->GetId());
     int64_t askAgain = GetTime() + MASTERNODES_DSEG_SECONDS;
     mWeAskedForMasternodeList[pnode->addr] = askAgain;
+    changedState.Set('w');
 
     LogPrint(BCLog::MASTERNODE, "%s: asked %s for the list\n", __func__, pnode->addr.ToString());
 }
@@ -437,36 +507,99 @@ void CMasternodeMan::DsegUpdate(CNode* pnode, CConnman* connman)
 CMasternode* CMasternodeMan::Find(const CScript& payee)
 {
     LOCK(cs);
-    CScript payee2;
 
-    for (CMasternode& mn : vMasternodes) {
-        payee2 = GetScriptForDestination(PKHash(mn.pubKeyCollateralAddress));
-        if (payee2 == payee)
-            return &mn;
-    }
-    return NULL;
+    auto it = mapPayeeIndex.find(payee);
+    return it == mapPayeeIndex.end() ? NULL : &vMasternodes[it->second];
 }
 
 CMasternode* CMasternodeMan::Find(const CTxIn& vin)
 {
     LOCK(cs);
 
-    for (CMasternode& mn : vMasternodes) {
-        if (mn.vin.prevout == vin.prevout)
-            return &mn;
-    }
-    return NULL;
+    auto it = mapOutpointIndex.find(vin.prevout);
+    return it == mapOutpointIndex.end() ? NULL : &vMasternodes[it->second];
+}
+
+bool CMasternodeMan::GetMasternodePubKey(const CTxIn& vin, CPubKey& pubKeyMasternode)
+{
+    LOCK(cs);
+
+    CMasternode* pmn = Find(vin);
+    if (!pmn)
+        return false;
+
+    pubKeyMasternode = pmn->pubKeyMasternode;
+    return true;
+}
+
+bool CMasternodeMan::GetMasternodeProtocolVersion(const CTxIn& vin, int& protocolVersion)
+{
+    LOCK(cs);
+
+    CMasternode* pmn = Find(vin);
+    if (!pmn)
+        return false;
+
+    protocolVersion = pmn->protocolVersion;
+    return true;
+}
+
+bool CMasternodeMan::IsBroadcastSeen(const uint256& hash)
+{
+    LOCK(cs);
+    return mapSeenMasternodeBroadcast.count(hash) > 0;
+}
+
+bool CMasternodeMan::GetSeenBroadcast(const uint256& hash, CMasternodeBroadcast& mnb)
+{
+    LOCK(cs);
+
+    auto it = mapSeenMasternodeBroadcast.find(hash);
+    if (it == mapSeenMasternodeBroadcast.end())
+        return false;
+
+    mnb = it->second;
+    return true;
+}
+
+bool CMasternodeMan::GetSeenPing(const uint256& hash, CMasternodePing& mnp)
+{
+    LOCK(cs);
+
+    auto it = mapSeenMasternodePing.find(hash);
+    if (it == mapSeenMasternodePing.end())
+        return false;
+
+    mnp = it->second;
+    return true;
+}
+
+void CMasternodeMan::AddSeenPing(const CMasternodePing& mnp)
+{
+    LOCK(cs);
+    mapSeenMasternodePing.insert(std::make_pair(mnp.GetHash(), mnp));
+}
+
+void CMasternodeMan::UpdateSeenBroadcastPing(const uint256& hash, const CMasternodePing& mnp)
+{
+    LOCK(cs);
+    // through operator[], so the changed entry is flushed to the cache
+    if (mapSeenMasternodeBroadcast.count(hash))
+        mapSeenMasternodeBroadcast[hash].lastPing = mnp;
+}
+
+void CMasternodeMan::RemoveSeenBroadcast(const uint256& hash)
+{
+    LOCK(cs);
+    mapSeenMasternodeBroadcast.erase(hash);
 }
 
 CMasternode* CMasternodeMan::Find(const CPubKey& pubKeyMasternode)
 {
     LOCK(cs);
 
-    for (CMasternode& mn : vMasternodes) {
-        if (mn.pubKeyMasternode == pubKeyMasternode)
-            return &mn;
-    }
-    return NULL;
+    auto it = mapPubKeyIndex.find(pubKeyMasternode);
+    return it == mapPubKeyIndex.end() ? NULL : &vMasternodes[it->second];
 }
 
 //
@@ -501,7 +634,7 @@ CMasternode* CMasternodeMan::GetNextMasternodeInQueueForPayment(CBlockIndex* pin
         if (fFilterSigTime && mn.sigTime + (nMnCount * 2.6 * 60) > TicksSinceEpoch<std::chrono::seconds>(GetAdjustedTime()))
             continue;
 
-        vecMasternodeLastPaid.push_back(std::make_pair(mn.SecondsSincePayment(pindex), mn.vin));
+        vecMasternodeLastPaid.push_back(std::make_pair(mn.SecondsSincePayment(pindex, nMnCount), mn.vin));
     }
 
     nCount = (int)vecMasternodeLastPaid.size();
@@ -572,34 +705,82 @@ CMasternode* CMasternodeMan::FindRandomNotInVec(std::vector<CTxIn>& vecToExclude
     return NULL;
 }
 
+std::vector<CMasternodeMan::CMasternodeScore> CMasternodeMan::CalculateScores(const std::vector<CMasternode>& list, int64_t nBlockHeight, int minProtocol)
+{
+    std::vector<CMasternodeScore> vecScores;
+    vecScores.reserve(list.size());
+    for (size_t i = 0; i < list.size(); i++) {
+        const CMasternode& mn = list[i];
+        if (mn.protocolVersion < minProtocol)
+            continue;
+
+        // CalculateScore returns 0 without a block index, so every score is 0 and the
+        // table keeps the list order. Passing the block changes the payment winners
+        // and GetCurrentMasterNode results, which takes a network upgrade.
+        uint256 n = mn.CalculateScore(1, nBlockHeight);
+        vecScores.push_back({(int64_t)UintToArith256(n).GetCompact(false), i});
+    }
+    // high to low; equal scores keep the list order
+    std::stable_sort(vecScores.begin(), vecScores.end(), [](const CMasternodeScore& a, const CMasternodeScore& b) {
+        return a.nScore > b.nScore;
+    });
+    return vecScores;
+}
+
+const std::vector<CMasternodeMan::CMasternodeScore>& CMasternodeMan::GetScores(const uint256& hashBlock, int64_t nBlockHeight, int minProtocol)
+{
+    AssertLockHeld(cs);
+
+    auto it = mapScoreCache.find(std::make_pair(hashBlock, minProtocol));
+    if (it != mapScoreCache.end())
+        return it->second;
+
+    std::vector<CMasternodeScore> vecScores = CalculateScores(vMasternodes, nBlockHeight, minProtocol);
+    if (mapScoreCache.size() >= MASTERNODES_SCORE_CACHE_SIZE)
+        mapScoreCache.clear();
+    return mapScoreCache.emplace(std::make_pair(hashBlock, minProtocol), std::move(vecScores)).first->second;
+}
+
+const std::vector<CMasternodeMan::CMasternodeScore>& CMasternodeMan::GetScores(int64_t nBlockHeight, int minProtocol)
+{
+    AssertLockHeld(cs);
+
+    // validation takes cs after cs_main, so only try for cs_main while holding cs
+    CBlockIndex* pindex = nullptr;
+    if (chainman) {
+        TRY_LOCK(cs_main, locked);
+        if (locked)
+            pindex = chainman->ActiveChain().Tip();
+    }
+    uint256 hash{};
+    if (!GetBlockHash(hash, nBlockHeight, pindex)) {
+        // not cacheable without a block, keep a throwaway table under the null hash
+        mapScoreCache.erase(std::make_pair(uint256(), minProtocol));
+    }
+    return GetScores(hash, nBlockHeight, minProtocol);
+}
+
 CMasternode* CMasternodeMan::GetCurrentMasterNode(int mod, int64_t nBlockHeight, int minProtocol)
 {
-    int64_t score = 0;
-    CMasternode* winner = NULL;
+    LOCK(cs);
 
-    // scan for winner
-    for (CMasternode& mn : vMasternodes) {
+    // the winner is the enabled Masternode with the highest positive score
+    for (const CMasternodeScore& s : GetScores(nBlockHeight, minProtocol)) {
+        CMasternode& mn = vMasternodes[s.nPos];
         mn.Check();
-        if (mn.protocolVersion < minProtocol || !mn.IsEnabled())
+        if (!mn.IsEnabled())
             continue;
 
-        // calculate the score for each Masternode
-        uint256 n = mn.CalculateScore(mod, nBlockHeight);
-        int64_t n2 = UintToArith256(n).GetCompact(false);
-
-        // determine the winner
-        if (n2 > score) {
-            score = n2;
-            winner = &mn;
-        }
+        return s.nScore > 0 ? &mn : NULL;
     }
 
-    return winner;
+    return NULL;
 }
 
 int CMasternodeMan::GetMasternodeRank(CBlockIndex* pindex, const CTxIn& vin, int64_t nBlockHeight, int minProtocol, bool fOnlyActive)
 {
-    std::vector<std::pair<int64_t, CTxIn>> vecMasternodeScores;
+    LOCK(cs);
+
     int64_t nMasternode_Min_Age = MN_WINNER_MINIMUM_AGE;
     int64_t nMasternode_Age = 0;
 
@@ -609,14 +790,11 @@ int CMasternodeMan::GetMasternodeRank(CBlockIndex* pindex, const CTxIn& vin, int
         return -1;
     }
 
-    // scan for winner
-    for (CMasternode& mn : vMasternodes) {
-        if (mn.protocolVersion < minProtocol) {
-            LogPrint(BCLog::MASTERNODE, "Skipping Masternode with obsolete version %d\n", mn.protocolVersion);
-            continue; // Skip obsolete versions
-        }
-
-        if (IsSporkActive(SPORK_8_MASTERNODE_PAYMENT_ENFORCEMENT)) {
+    bool fCheckAge = IsSporkActive(SPORK_8_MASTERNODE_PAYMENT_ENFORCEMENT);
+    int rank = 0;
+    for (const CMasternodeScore& s : GetScores(hash, nBlockHeight, minProtocol)) {
+        CMasternode& mn = vMasternodes[s.nPos];
+        if (fCheckAge) {
             nMasternode_Age = TicksSinceEpoch<std::chrono::seconds>(GetAdjustedTime()) - mn.sigTime;
             if ((nMasternode_Age) < nMasternode_Min_Age) {
                 LogPrint(BCLog::MASTERNODE, "Skipping just activated Masternode. Age: %ld\n", nMasternode_Age);
@@ -628,18 +806,9 @@ int CMasternodeMan::GetMasternodeRank(CBlockIndex* pindex, const CTxIn& vin, int
             if (!mn.IsEnabled())
                 continue;
         }
-        uint256 n = mn.CalculateScore(1, nBlockHeight);
-        int64_t n2 = UintToArith256(n).GetCompact(false);
-
-        vecMasternodeScores.push_back(std::make_pair(n2, mn.vin));
-    }
 
-    sort(vecMasternodeScores.rbegin(), vecMasternodeScores.rend(), CompareScoreTxIn());
-
-    int rank = 0;
-    for (const auto& s : vecMasternodeScores) {
         rank++;
-        if (s.second.prevout == vin.prevout) {
+        if (mn.vin.prevout == vin.prevout) {
             return rank;
         }
     }
@@ -647,41 +816,55 @@ int CMasternodeMan::GetMasternodeRank(CBlockIndex* pindex, const CTxIn& vin, int
     return -1;
 }
 
-std::vector<std::pair<int, CMasternode>> CMasternodeMan::GetMasternodeRanks(CBlockIndex* pindex, int64_t nBlockHeight, int minProtocol)
+CMasternodeListRef CMasternodeMan::GetListSnapshot()
 {
-    std::vector<std::pair<int64_t, CMasternode>> vecMasternodeScores;
-    std::vector<std::pair<int, CMasternode>> vecMasternodeRanks;
-
-    // make sure we know about this block
-    uint256 hash {};
-    if (!GetBlockHash(hash, nBlockHeight, pindex)) {
-        return vecMasternodeRanks;
+    // refresh the snapshot when the list changed, unless that means waiting for
+    // cs; the periodic check publishes a new one anyway
+    if (fListChanged) {
+        TRY_LOCK(cs, locked);
+        if (locked && fListChanged)
+            PublishListSnapshot();
     }
 
-    // scan for winner
-    for (CMasternode& mn : vMasternodes) {
-        mn.Check();
+    LOCK(cs_list_snapshot);
+    return listSnapshot;
+}
 
-        if (mn.protocolVersion < minProtocol)
-            continue;
+void CMasternodeMan::PublishListSnapshot()
+{
+    AssertLockHeld(cs);
 
-        if (!mn.IsEnabled()) {
-            vecMasternodeScores.push_back(std::make_pair(9999, mn));
-            continue;
-        }
+    fListChanged = false;
+    CMasternodeListRef list = std::make_shared<const std::vector<CMasternode>>(vMasternodes);
+    LOCK(cs_list_snapshot);
+    listSnapshot.swap(list);
+}
 
-        uint256 n = mn.CalculateScore(1, nBlockHeight);
-        int64_t n2 = UintToArith256(n).GetCompact(false);
+std::vector<std::pair<int, const CMasternode*>> CMasternodeMan::GetMasternodeRanks(const CMasternodeListRef& list, CBlockIndex* pindex, int64_t nBlockHeight, int minProtocol)
+{
+    std::vector<std::pair<int, const CMasternode*>> vecMasternodeRanks;
 
-        vecMasternodeScores.push_back(std::make_pair(n2, mn));
+    // make sure we know about this block
+    uint256 hash {};
+    if (!list || !GetBlockHash(hash, nBlockHeight, pindex)) {
+        return vecMasternodeRanks;
     }
 
-    sort(vecMasternodeScores.rbegin(), vecMasternodeScores.rend(), CompareScoreMN());
+    // disabled entries rank as if scored 9999
+    std::vector<CMasternodeScore> vecScores = CalculateScores(*list, nBlockHeight, minProtocol);
+    for (CMasternodeScore& s : vecScores) {
+        if (!(*list)[s.nPos].IsEnabled())
+            s.nScore = 9999;
+    }
+    std::stable_sort(vecScores.begin(), vecScores.end(), [](const CMasternodeScore& a, const CMasternodeScore& b) {
+        return a.nScore > b.nScore;
+    });
 
     int rank = 0;
-    for (const auto& s : vecMasternodeScores) {
+    vecMasternodeRanks.reserve(vecScores.size());
+    for (const CMasternodeScore& s : vecScores) {
         rank++;
-        vecMasternodeRanks.push_back(std::make_pair(rank, s.second));
+        vecMasternodeRanks.push_back(std::make_pair(rank, &(*list)[s.nPos]));
     }
 
     return vecMasternodeRanks;
@@ -689,31 +872,20 @@ std::vector<std::pair<int, CMasternode>> CMasternodeMan::GetMasternodeRanks(CBlo
 
 CMasternode* CMasternodeMan::GetMasternodeByRank(int nRank, int64_t nBlockHeight, int minProtocol, bool fOnlyActive)
 {
-    std::vector<std::pair<int64_t, CTxIn>> vecMasternodeScores;
+    LOCK(cs);
 
-    // scan for winner
-    for (CMasternode& mn : vMasternodes) {
-        if (mn.protocolVersion < minProtocol)
-            continue;
+    int rank = 0;
+    for (const CMasternodeScore& s : GetScores(nBlockHeight, minProtocol)) {
+        CMasternode& mn = vMasternodes[s.nPos];
         if (fOnlyActive) {
             mn.Check();
             if (!mn.IsEnabled())
                 continue;
         }
 
-        uint256 n = mn.CalculateScore(1, nBlockHeight);
-        int64_t n2 = UintToArith256(n).GetCompact(false);
-
-        vecMasternodeScores.push_back(std::make_pair(n2, mn.vin));
-    }
-
-    sort(vecMasternodeScores.rbegin(), vecMasternodeScores.rend(), CompareScoreTxIn());
-
-    int rank = 0;
-    for (const auto& s : vecMasternodeScores) {
         rank++;
         if (rank == nRank) {
-            return Find(s.second);
+            return &mn;
         }
     }
 
@@ -733,96 +905,193 @@ void CMasternodeMan::ProcessMasternodeConnections(CConnman& connman)
     }
 }
 
-void CMasternodeMan::ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman* connman)
+void CMasternodeMan::ProcessBroadcast(CNode* pfrom, CMasternodeBroadcast& mnb, CConnman* connman)
 {
-    if (!masternodeSync.IsBlockchainSynced())
+    if (!WITH_LOCK(cs, return mapSeenMasternodeBroadcast.insert(std::make_pair(mnb.GetHash(), mnb)).second)) { // seen
+        masternodeSync.AddedMasternodeList(mnb.GetHash());
         return;
+    }
 
-    Chainstate& chainstate = chainman->ActiveChainstate();
+    int nDoS = 0;
+    if (!mnb.CheckAndUpdate(nDoS, connman)) {
+        if (nDoS > 0) {
+            //Misbehaving(pfrom->GetId(), nDoS);
+        }
 
-    LOCK(cs_process_message);
+        // failed
+        return;
+    }
 
-    if (strCommand == NetMsgType::MNBROADCAST) {
+    // make sure the vout that was signed is related to the transaction that spawned the Masternode
+    //  - this is expensive, so it's only done once per Masternode
+    if (!legacySigner.IsVinAssociatedWithPubkey(mnb.vin, mnb.pubKeyCollateralAddress)) {
+        LogPrintf("CMasternodeMan::ProcessMessage() : mnb - Got mismatched pubkey and vin\n");
+        //Misbehaving(pfrom->GetId(), 33);
+        return;
+    }
 
-        CMasternodeBroadcast mnb;
-        vRecv >> mnb;
+    // make sure it's still unspent
+    //  - this is checked later by .check() in many places and by ThreadCheckObfuScationPool()
+    if (mnb.CheckInputsAndAdd(nDoS, chainman->ActiveChainstate(), connman)) {
+        // use this as a peer
+        std::vector<CAddress> vecAddress;
+        vecAddress.push_back(CAddress(mnb.addr, NODE_NETWORK));
+        connman->addrman.Add(vecAddress, pfrom->addr, std::chrono::seconds{2 * 60 * 60});
+        masternodeSync.AddedMasternodeList(mnb.GetHash());
+    } else {
+        LogPrint(BCLog::MASTERNODE, "mnb - Rejected Masternode entry %s\n", mnb.vin.prevout.hash.ToString());
 
-        if (mapSeenMasternodeBroadcast.count(mnb.GetHash())) { // seen
-            masternodeSync.AddedMasternodeList(mnb.GetHash());
-            return;
+        if (nDoS > 0) {
+            //Misbehaving(pfrom->GetId(), nDoS);
         }
-        mapSeenMasternodeBroadcast.insert(std::make_pair(mnb.GetHash(), mnb));
+    }
+}
 
-        int nDoS = 0;
-        if (!mnb.CheckAndUpdate(nDoS, connman)) {
-            if (nDoS > 0) {
-                //Misbehaving(pfrom->GetId(), nDoS);
-            }
+void CMasternodeMan::ProcessPing(CNode* pfrom, CMasternodePing& mnp, CConnman* connman)
+{
+    LogPrint(BCLog::MASTERNODE, "mnp - Masternode ping, vin: %s\n", mnp.vin.prevout.hash.ToString());
 
-            // failed
-            return;
-        }
+    if (!WITH_LOCK(cs, return mapSeenMasternodePing.insert(std::make_pair(mnp.GetHash(), mnp)).second))
+        return; // seen
 
-        // make sure the vout that was signed is related to the transaction that spawned the Masternode
-        //  - this is expensive, so it's only done once per Masternode
-        if (!legacySigner.IsVinAssociatedWithPubkey(mnb.vin, mnb.pubKeyCollateralAddress)) {
-            LogPrintf("CMasternodeMan::ProcessMessage() : mnb - Got mismatched pubkey and vin\n");
-            //Misbehaving(pfrom->GetId(), 33);
+    int nDoS = 0;
+    if (mnp.CheckAndUpdate(nDoS, connman)) {
+        fListChanged = true;
+        return;
+    }
+
+    if (nDoS > 0) {
+        // if anything significant failed, mark that node
+        //Misbehaving(pfrom->GetId(), nDoS);
+    } else {
+        // if nothing significant failed, search existing Masternode list
+        CMasternode* pmn = Find(mnp.vin);
+        // if it's known, don't ask for the mnb, just return
+        if (pmn)
             return;
-        }
+    }
 
-        // make sure it's still unspent
-        //  - this is checked later by .check() in many places and by ThreadCheckObfuScationPool()
-        if (mnb.CheckInputsAndAdd(nDoS, chainman->ActiveChainstate(), connman)) {
-            // use this as a peer
-            std::vector<CAddress> vecAddress;
-            vecAddress.push_back(CAddress(mnb.addr, NODE_NETWORK));
-            connman->addrman.Add(vecAddress, pfrom->addr, std::chrono::seconds{2 * 60 * 60});
-            masternodeSync.AddedMasternodeList(mnb.GetHash());
-        } else {
-            LogPrint(BCLog::MASTERNODE, "mnb - Rejected Masternode entry %s\n", mnb.vin.prevout.hash.ToString());
+    // something significant is broken or mn is unknown,
+    // we might have to ask for a masternode entry once
+    AskForMN(pfrom, mnp.vin, connman);
+}
 
-            if (nDoS > 0) {
-                //Misbehaving(pfrom->GetId(), nDoS);
+void CMasternodeMan::SendListSnapshot(CNode* pnode, CConnman* connman)
+{
+    const CBlockIndex* pindexTip = WITH_LOCK(cs_main, return chainman->ActiveChain().Tip());
+    if (!pindexTip)
+        return;
+
+    std::vector<CMasternodeBroadcast> vBroadcasts;
+    {
+        LOCK(cs);
+        for (CMasternode& mn : vMasternodes) {
+            if (mn.addr.IsRFC1918())
+                continue; // local network
+
+            if (mn.IsEnabled()) {
+                CMasternodeBroadcast mnb = CMasternodeBroadcast(mn);
+                uint256 hash = mnb.GetHash();
+                if (!mapSeenMasternodeBroadcast.count(hash))
+                    mapSeenMasternodeBroadcast.insert(std::make_pair(hash, mnb));
+                vBroadcasts.push_back(mnb);
             }
         }
     }
 
-    else if (strCommand == NetMsgType::MNPING) {
+    const CNetMsgMaker msgMaker(PROTOCOL_VERSION);
+    const size_t nParts = std::max<size_t>(1, (vBroadcasts.size() + MASTERNODES_SNAPSHOT_MAX_ENTRIES - 1) / MASTERNODES_SNAPSHOT_MAX_ENTRIES);
+    for (size_t nPart = 0; nPart < nParts; nPart++) {
+        auto itFirst = vBroadcasts.begin() + nPart * MASTERNODES_SNAPSHOT_MAX_ENTRIES;
+        auto itLast = vBroadcasts.begin() + std::min(vBroadcasts.size(), (nPart + 1) * MASTERNODES_SNAPSHOT_MAX_ENTRIES);
+
+        CMasternodeListSnapshot snapshot;
+        snapshot.nHeight = pindexTip->nHeight;
+        snapshot.hashBlock = pindexTip->GetBlockHash();
+        snapshot.nPart = nPart;
+        snapshot.nParts = nParts;
+        snapshot.vBroadcasts.assign(itFirst, itLast);
+        connman->PushMessage(pnode, msgMaker.Make(NetMsgType::MNLIST, snapshot));
+    }
+
+    connman->PushMessage(pnode, msgMaker.Make(NetMsgType::SYNCSTATUSCOUNT, MASTERNODE_SYNC_LIST, (int)vBroadcasts.size()));
+    LogPrint(BCLog::MASTERNODE, "dseg - Sent a snapshot of %d Masternode entries at height %d to %s\n", vBroadcasts.size(), pindexTip->nHeight, pnode->addr.ToString());
+}
+
+void CMasternodeMan::ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman* connman)
+{
+    if (!masternodeSync.IsBlockchainSynced())
+        return;
+
+    Chainstate& chainstate = chainman->ActiveChainstate();
+
+    LOCK(cs_process_message);
+
+    if (strCommand == NetMsgType::MNBROADCAST) {
+
+        CMasternodeBroadcast mnb;
+        vRecv >> mnb;
+
+        ProcessBroadcast(pfrom, mnb, connman);
+
+    } else if (strCommand == NetMsgType::MNPING) {
 
         CMasternodePing mnp;
         vRecv >> mnp;
 
-        LogPrint(BCLog::MASTERNODE, "mnp - Masternode ping, vin: %s\n", mnp.vin.prevout.hash.ToString());
+        ProcessPing(pfrom, mnp, connman);
 
-        if (mapSeenMasternodePing.count(mnp.GetHash()))
-            return; // seen
-        mapSeenMasternodePing.insert(std::make_pair(mnp.GetHash(), mnp));
+    } else if (strCommand == NetMsgType::MNLIST) {
 
-        int nDoS = 0;
-        if (mnp.CheckAndUpdate(nDoS, connman)) {
+        CMasternodeListSnapshot snapshot;
+        vRecv >> snapshot;
+
+        if (snapshot.vBroadcasts.size() > MASTERNODES_SNAPSHOT_MAX_ENTRIES || snapshot.nPart >= snapshot.nParts) {
+            LogPrint(BCLog::MASTERNODE, "mnlist - Got invalid snapshot from peer=%i\n", pfrom->GetId());
+            //Misbehaving(pfrom->GetId(), 20);
             return;
         }
 
-        if (nDoS > 0) {
-            // if anything significant failed, mark that node
-            //Misbehaving(pfrom->GetId(), nDoS);
-        } else {
-            // if nothing significant failed, search existing Masternode list
-            CMasternode* pmn = Find(mnp.vin);
-            // if it's known, don't ask for the mnb, just return
-            if (pmn)
+        // a list taken on another chain has pings that don't check out here
+        {
+            LOCK(cs_main);
+            const CBlockIndex* pindex = chainstate.m_chain[snapshot.nHeight];
+            if (pindex && pindex->GetBlockHash() != snapshot.hashBlock) {
+                LogPrint(BCLog::MASTERNODE, "mnlist - Snapshot at height %d from peer=%i is not on our chain\n", snapshot.nHeight, pfrom->GetId());
                 return;
+            }
+        }
+
+        // verify all the signatures at once, the entries then find them in the signature cache
+        std::vector<CLegacySigCheck> vChecks;
+        vChecks.reserve(snapshot.vBroadcasts.size() * 2);
+        for (CMasternodeBroadcast& mnb : snapshot.vBroadcasts) {
+            vChecks.emplace_back(mnb.pubKeyCollateralAddress, mnb.sig, mnb.GetNewStrMessage());
+            vChecks.emplace_back(mnb.pubKeyMasternode, mnb.lastPing.vchSig, mnb.lastPing.GetStrMessage());
+        }
+        legacySigner.VerifyMessages(vChecks);
+
+        for (CMasternodeBroadcast& mnb : snapshot.vBroadcasts) {
+            // for a masternode we know, the snapshot may still have a newer ping
+            if (IsBroadcastSeen(mnb.GetHash()))
+                ProcessPing(pfrom, mnb.lastPing, connman);
+            ProcessBroadcast(pfrom, mnb, connman);
         }
 
-        // something significant is broken or mn is unknown,
-        // we might have to ask for a masternode entry once
-        AskForMN(pfrom, mnp.vin, connman);
+        LogPrint(BCLog::MASTERNODE, "mnlist - Got %d Masternode entries at height %d (part %d of %d) from peer=%i\n",
+            snapshot.vBroadcasts.size(), snapshot.nHeight, snapshot.nPart + 1, snapshot.nParts, pfrom->GetId());
+        // every entry was checked on its own, but only a list we asked for counts towards the sync
+        if (snapshot.nPart + 1 == snapshot.nParts && WITH_LOCK(cs, return setAskedForListSnapshot.erase(pfrom->GetId())))
+            masternodeSync.AddedMasternodeListSnapshot(pfrom->GetId());
 
     } else if (strCommand == NetMsgType::DSEG) {
 
         CTxIn vin;
         vRecv >> vin;
+        // newer peers ask for the list as a snapshot, older ones send the vin only
+        bool fSnapshot = false;
+        if (!vRecv.empty())
+            vRecv >> fSnapshot;
 
         if (vin == CTxIn()) { // only should ask for this once
             // local network
@@ -840,11 +1109,18 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, const std::string& strCommand,
                 }
                 int64_t askAgain = GetTime() + MASTERNODES_DSEG_SECONDS;
                 mAskedUsForMasternodeList[pfrom->addr] = askAgain;
+                changedState.Set('a');
             }
         } // else, asking for a specific node which is ok
 
+        if (vin == CTxIn() && fSnapshot) {
+            SendListSnapshot(pfrom, connman);
+            return;
+        }
+
         int nInvCount = 0;
         const CNetMsgMaker msgMaker(PROTOCOL_VERSION);
+        LOCK(cs);
         for (CMasternode& mn : vMasternodes) {
             if (mn.addr.IsRFC1918())
                 continue; // local network
@@ -888,7 +1164,9 @@ void CMasternodeMan::Remove(CTxIn vin)
     while (it != vMasternodes.end()) {
         if ((*it).vin == vin) {
             LogPrint(BCLog::MASTERNODE, "CMasternodeMan: Removing Masternode %s - %i now\n", (*it).vin.prevout.hash.ToString(), size() - 1);
+            changedMasternodes.Set((*it).vin.prevout);
             vMasternodes.erase(it);
+            RebuildIndexes();
             break;
         }
         ++it;
@@ -897,8 +1175,11 @@ void CMasternodeMan::Remove(CTxIn vin)
 
 void CMasternodeMan::UpdateMasternodeList(CMasternodeBroadcast mnb, CConnman* connman)
 {
-    mapSeenMasternodePing.insert(std::make_pair(mnb.lastPing.GetHash(), mnb.lastPing));
-    mapSeenMasternodeBroadcast.insert(std::make_pair(mnb.GetHash(), mnb));
+    {
+        LOCK(cs);
+        mapSeenMasternodePing.insert(std::make_pair(mnb.lastPing.GetHash(), mnb.lastPing));
+        mapSeenMasternodeBroadcast.insert(std::make_pair(mnb.GetHash(), mnb));
+    }
     masternodeSync.AddedMasternodeList(mnb.GetHash());
 
     LogPrint(BCLog::MASTERNODE, "CMasternodeMan::UpdateMasternodeList() -- masternode=%s\n", mnb.vin.prevout.ToString());
@@ -908,10 +1189,27 @@ void CMasternodeMan::UpdateMasternodeList(CMasternodeBroadcast mnb, CConnman* co
         CMasternode mn(mnb);
         Add(mn);
     } else {
-        pmn->UpdateFromNewBroadcast(mnb, connman);
+        UpdateFromNewBroadcast(*pmn, mnb, connman);
     }
 }
 
+bool CMasternodeMan::UpdateFromNewBroadcast(CMasternode& mn, CMasternodeBroadcast& mnb, CConnman* connman)
+{
+    LOCK(cs);
+
+    const CPubKey pubKeyMasternodeOld = mn.pubKeyMasternode;
+    const CPubKey pubKeyCollateralAddressOld = mn.pubKeyCollateralAddress;
+    if (!mn.UpdateFromNewBroadcast(mnb, connman))
+        return false;
+
+    if (mn.pubKeyMasternode != pubKeyMasternodeOld || mn.pubKeyCollateralAddress != pubKeyCollateralAddressOld)
+        RebuildIndexes();
+    else
+        mapScoreCache.clear(); // the protocol version may have changed
+    fListChanged = true;
+    return true;
+}
+
 std::string CMasternodeMan::ToString() const
 {
     std::ostringstream info;
@@ -8,18 +8,68 @@
 #include <base58.h>
 #include <key.h>
 #include <masternode/masternode.h>
+#include <masternode/mncachedb.h>
+#include <masternode/seencache.h>
 #include <net.h>
 #include <sync.h>
+#include <util/hasher.h>
 #include <util/system.h>
 #include <validation.h>
 
+#include <atomic>
+#include <memory>
+#include <set>
+#include <unordered_map>
+
 #define MASTERNODES_DUMP_SECONDS (15 * 60)
 #define MASTERNODES_DSEG_SECONDS (3 * 60 * 60)
+#define MASTERNODES_SCORE_CACHE_SIZE 16
+#define MASTERNODES_SEEN_BROADCASTS_MAX 20000
+#define MASTERNODES_SEEN_PINGS_MAX 100000
+#define MASTERNODES_SNAPSHOT_MAX_ENTRIES 5000
 
 class CMasternodeMan;
-void DumpMasternodes();
 
-/** Access to the MN database (mncache.dat)
+/** Broadcast with its last ping, leaving out the ping's copy of the outpoint and the obfuscation queue count
+ */
+struct CompactMasternodeBroadcastFormatter {
+    template <typename Stream>
+    void Ser(Stream& s, const CMasternodeBroadcast& mnb)
+    {
+        s << mnb.vin << mnb.addr << mnb.pubKeyCollateralAddress << mnb.pubKeyMasternode << mnb.sig << mnb.sigTime << mnb.protocolVersion;
+        s << mnb.lastPing.blockHash << mnb.lastPing.sigTime << mnb.lastPing.vchSig;
+    }
+
+    template <typename Stream>
+    void Unser(Stream& s, CMasternodeBroadcast& mnb)
+    {
+        s >> mnb.vin >> mnb.addr >> mnb.pubKeyCollateralAddress >> mnb.pubKeyMasternode >> mnb.sig >> mnb.sigTime >> mnb.protocolVersion;
+        mnb.lastPing.vin = mnb.vin;
+        s >> mnb.lastPing.blockHash >> mnb.lastPing.sigTime >> mnb.lastPing.vchSig;
+    }
+};
+
+/** The enabled masternodes with their last pings as of a block, sent in reply to a
+ *  list request instead of an inventory entry per masternode that is then fetched
+ *  on its own. Longer lists than MASTERNODES_SNAPSHOT_MAX_ENTRIES come in parts.
+ */
+class CMasternodeListSnapshot {
+public:
+    // tip of the sender when the list was taken
+    int nHeight{0};
+    uint256 hashBlock;
+    uint32_t nPart{0};
+    uint32_t nParts{0};
+    std::vector<CMasternodeBroadcast> vBroadcasts;
+
+    SERIALIZE_METHODS(CMasternodeListSnapshot, obj)
+    {
+        READWRITE(obj.nHeight, obj.hashBlock, obj.nPart, obj.nParts);
+        READWRITE(Using<VectorFormatter<CompactMasternodeBroadcastFormatter>>(obj.vBroadcasts));
+    }
+};
+
+/** Reader of the old MN database (mncache.dat), moved to CMasternodeCacheDB on first start
  */
 class CMasternodeDB {
 private:
@@ -38,10 +88,12 @@ public:
     };
 
     CMasternodeDB();
-    bool Write(const CMasternodeMan& mnodemanToSave);
     ReadResult Read(CMasternodeMan& mnodemanToLoad, bool fDryRun = false);
 };
 
+/** Immutable copy of the masternode list, shared by readers that don't hold CMasternodeMan::cs */
+typedef std::shared_ptr<const std::vector<CMasternode>> CMasternodeListRef;
+
 class CMasternodeMan {
 private:
     // critical section to protect the inner data structures
@@ -52,20 +104,68 @@ private:
 
     // map to hold all MNs
     std::vector<CMasternode> vMasternodes;
+    // positions in vMasternodes by outpoint, masternode key and collateral payee;
+    // when several entries share a key the first one is indexed
+    std::unordered_map<COutPoint, size_t, SaltedOutpointHasher> mapOutpointIndex;
+    std::unordered_map<CPubKey, size_t, SaltedSipHasher> mapPubKeyIndex;
+    std::unordered_map<CScript, size_t, SaltedSipHasher> mapPayeeIndex;
     // who's asked for the Masternode list and the last time
     std::map<CNetAddr, int64_t> mAskedUsForMasternodeList;
     // who we asked for the Masternode list and the last time
     std::map<CNetAddr, int64_t> mWeAskedForMasternodeList;
     // which Masternodes we've asked for
     std::map<COutPoint, int64_t> mWeAskedForMasternodeListEntry;
+    // peers we asked for a list snapshot that did not send all of it yet
+    std::set<NodeId> setAskedForListSnapshot;
+
+    // entries removed since the last cache flush, changed ones are flagged with CMasternode::fCacheChanged
+    CMasternodeCacheChanges<COutPoint> changedMasternodes;
+    CMasternodeCacheChanges<uint256> changedSeenBroadcasts;
+    CMasternodeCacheChanges<uint256> changedSeenPings;
+    // keys of the state records in CMasternodeCacheDB::masternodeState that changed
+    CMasternodeCacheChanges<uint8_t> changedState;
 
     ChainstateManager* chainman;
 
+    struct CMasternodeScore {
+        int64_t nScore;
+        // position in vMasternodes
+        size_t nPos;
+    };
+    // masternode scores sorted from high to low by (block hash, minimum protocol), cleared on list changes
+    std::map<std::pair<uint256, int>, std::vector<CMasternodeScore>> mapScoreCache;
+
+    /// Score the entries of list at or above minProtocol for nBlockHeight, from high to low keeping the list order
+    static std::vector<CMasternodeScore> CalculateScores(const std::vector<CMasternode>& list, int64_t nBlockHeight, int minProtocol);
+    /// Get the sorted scores of the masternodes at or above minProtocol for nBlockHeight
+    const std::vector<CMasternodeScore>& GetScores(const uint256& hashBlock, int64_t nBlockHeight, int minProtocol);
+    /// Get the sorted scores for nBlockHeight of the current chain
+    const std::vector<CMasternodeScore>& GetScores(int64_t nBlockHeight, int minProtocol);
+
+    // copy of vMasternodes handed to readers, replaced after the list changed
+    mutable Mutex cs_list_snapshot;
+    CMasternodeListRef listSnapshot GUARDED_BY(cs_list_snapshot);
+    std::atomic<bool> fListChanged{true};
+
+    /// Replace the list snapshot with a copy of vMasternodes
+    void PublishListSnapshot() EXCLUSIVE_LOCKS_REQUIRED(cs);
+
+    /// Add the entry at position nPos to the lookup indexes
+    void AddToIndexes(size_t nPos);
+    /// Rebuild the lookup indexes after entries were removed or changed keys
+    void RebuildIndexes();
+
+    /// Handle a broadcast or ping received on its own or in a list snapshot
+    void ProcessBroadcast(CNode* pfrom, CMasternodeBroadcast& mnb, CConnman* connman);
+    void ProcessPing(CNode* pfrom, CMasternodePing& mnp, CConnman* connman);
+    /// Send the enabled masternodes to pnode as list snapshots
+    void SendListSnapshot(CNode* pnode, CConnman* connman);
+
 public:
-    // Keep track of all broadcasts I've seen
-    std::map<uint256, CMasternodeBroadcast> mapSeenMasternodeBroadcast;
+    // Keep track of all broadcasts I've seen, outside the manager through the accessors below
+    CSeenCache<uint256, CMasternodeBroadcast> mapSeenMasternodeBroadcast GUARDED_BY(cs){MASTERNODES_SEEN_BROADCASTS_MAX, MASTERNODE_REMOVAL_SECONDS * 2};
     // Keep track of all pings I've seen
-    std::map<uint256, CMasternodePing> mapSeenMasternodePing;
+    CSeenCache<uint256, CMasternodePing> mapSeenMasternodePing GUARDED_BY(cs){MASTERNODES_SEEN_PINGS_MAX, MASTERNODE_REMOVAL_SECONDS * 2};
 
     // keep track of dsq count to prevent masternodes from gaming obfuscation queue
     int64_t nDsqCount;
@@ -81,6 +181,8 @@ public:
         READWRITE(obj.nDsqCount);
         READWRITE(obj.mapSeenMasternodeBroadcast);
         READWRITE(obj.mapSeenMasternodePing);
+        SER_READ(obj, obj.RebuildIndexes());
+        SER_READ(obj, obj.SetCacheChanged());
     }
 
     CMasternodeMan();
@@ -93,6 +195,16 @@ public:
 
     ChainstateManager* getChainMan() { return chainman; }
 
+    /// Get the sizes of the seen-message caches
+    void GetSeenCacheStats(std::map<std::string, CSeenCacheStats>& mapStats);
+
+    /// Mark every entry as changed, so that the next flush writes them all
+    void SetCacheChanged();
+    /// Write the entries that changed since the last flush
+    bool FlushCache(CMasternodeCacheDB& db);
+    /// Replace the entries with the ones in the database
+    bool LoadCache(CMasternodeCacheDB& db);
+
     /// Add an entry
     bool Add(CMasternode& mn);
 
@@ -117,6 +229,22 @@ public:
     CMasternode* Find(const CScript& payee);
     CMasternode* Find(const CTxIn& vin);
     CMasternode* Find(const CPubKey& pubKeyMasternode);
+    /// Get the masternode key of an entry
+    bool GetMasternodePubKey(const CTxIn& vin, CPubKey& pubKeyMasternode);
+    /// Get the protocol version of an entry
+    bool GetMasternodeProtocolVersion(const CTxIn& vin, int& protocolVersion);
+    /// Whether a broadcast is in mapSeenMasternodeBroadcast
+    bool IsBroadcastSeen(const uint256& hash);
+    /// Get a copy of a broadcast in mapSeenMasternodeBroadcast
+    bool GetSeenBroadcast(const uint256& hash, CMasternodeBroadcast& mnb);
+    /// Get a copy of a ping in mapSeenMasternodePing
+    bool GetSeenPing(const uint256& hash, CMasternodePing& mnp);
+    /// Add a ping to mapSeenMasternodePing
+    void AddSeenPing(const CMasternodePing& mnp);
+    /// Replace the last ping of a broadcast in mapSeenMasternodeBroadcast, if it is there
+    void UpdateSeenBroadcastPing(const uint256& hash, const CMasternodePing& mnp);
+    /// Remove a broadcast from mapSeenMasternodeBroadcast
+    void RemoveSeenBroadcast(const uint256& hash);
 
     /// Find an entry in the masternode list that is next to be paid
     CMasternode* GetNextMasternodeInQueueForPayment(CBlockIndex* pindex, int nBlockHeight, bool fFilterSigTime, int& nCount);
@@ -133,7 +261,10 @@ public:
         return vMasternodes;
     }
 
-    std::vector<std::pair<int, CMasternode>> GetMasternodeRanks(CBlockIndex* pindex, int64_t nBlockHeight, int minProtocol = 0);
+    /// Get a snapshot of the list, which can be up to one check interval old if the list is busy
+    CMasternodeListRef GetListSnapshot();
+    /// Rank the entries of a list snapshot for nBlockHeight from the highest score down, so disabled entries (scored 9999) come first
+    static std::vector<std::pair<int, const CMasternode*>> GetMasternodeRanks(const CMasternodeListRef& list, CBlockIndex* pindex, int64_t nBlockHeight, int minProtocol = 0);
     int GetMasternodeRank(CBlockIndex* pindex, const CTxIn& vin, int64_t nBlockHeight, int minProtocol = 0, bool fOnlyActive = true);
     CMasternode* GetMasternodeByRank(int nRank, int64_t nBlockHeight, int minProtocol = 0, bool fOnlyActive = true);
 
@@ -151,6 +282,9 @@ public:
 
     void Remove(CTxIn vin);
 
+    /// Update an entry from a newer broadcast, keeping the lookup indexes in sync
+    bool UpdateFromNewBroadcast(CMasternode& mn, CMasternodeBroadcast& mnb, CConnman* connman);
+
     int GetEstimatedMasternodes(int nBlock);
 
     /// Update masternode list and maps using provided CMasternodeBroadcast
@@ -4,11 +4,103 @@
 
 #include <masternode/masternodesigner.h>
 
+#include <checkqueue.h>
+#include <cuckoocache.h>
+#include <random.h>
+#include <script/sigcache.h>
+
 const std::string strMessageMagic = "Myce Signed Message:\n";
 
 class CLegacySigner;
 CLegacySigner legacySigner;
 
+namespace {
+/**
+ * Legacy signatures found valid recently. Pings, winners and votes are verified
+ * again when they are relayed back, synced and cleaned up, and after their batch
+ * was checked, which then costs a hash and a lookup instead of a key recovery.
+ */
+class CLegacySigCache
+{
+private:
+    Mutex m_mutex;
+    CuckooCache::cache<uint256, SignatureCacheHasher> m_cache GUARDED_BY(m_mutex);
+    //! salt so that peers cannot aim signatures at particular cache slots
+    const uint256 m_nonce{GetRandHash()};
+
+    uint256 GetEntry(const uint256& hashMessage, const std::vector<unsigned char>& vchSig, const CPubKey& pubkey) const
+    {
+        CHashWriter ss(SER_GETHASH, 0);
+        ss << m_nonce << hashMessage << vchSig << pubkey.GetID();
+        return ss.GetHash();
+    }
+
+public:
+    CLegacySigCache()
+    {
+        WITH_LOCK(m_mutex, m_cache.setup_bytes(LEGACY_SIGCACHE_BYTES));
+    }
+
+    bool Contains(const uint256& hashMessage, const std::vector<unsigned char>& vchSig, const CPubKey& pubkey) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        const uint256 entry = GetEntry(hashMessage, vchSig, pubkey);
+        LOCK(m_mutex);
+        return m_cache.contains(entry, /*erase=*/false);
+    }
+
+    void Insert(const uint256& hashMessage, const std::vector<unsigned char>& vchSig, const CPubKey& pubkey) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        uint256 entry = GetEntry(hashMessage, vchSig, pubkey);
+        LOCK(m_mutex);
+        m_cache.insert(entry);
+    }
+};
+
+CLegacySigCache& GetLegacySigCache()
+{
+    static CLegacySigCache cache;
+    return cache;
+}
+} // namespace
+
+static CCheckQueue<CLegacySigCheck> legacysigcheckqueue(LEGACY_SIGCHECK_BATCH_SIZE, "legacysig");
+
+void StartLegacySigCheckWorkerThreads(int threads_num)
+{
+    legacysigcheckqueue.StartWorkerThreads(threads_num);
+}
+
+void StopLegacySigCheckWorkerThreads()
+{
+    legacysigcheckqueue.StopWorkerThreads();
+}
+
+CLegacySigCheck::CLegacySigCheck(const CPubKey& pubkeyIn, const std::vector<unsigned char>& vchSigIn, const std::string& strMessage)
+    : pubkey(pubkeyIn), vchSig(vchSigIn), hashMessage(CLegacySigner::GetMessageHash(strMessage))
+{
+}
+
+bool CLegacySigCheck::operator()()
+{
+    CLegacySigCache& cache = GetLegacySigCache();
+    if (cache.Contains(hashMessage, vchSig, pubkey))
+        return true;
+
+    CPubKey pubkey2;
+    if (pubkey2.RecoverCompact(hashMessage, vchSig) && PKHash(pubkey2) == PKHash(pubkey))
+        cache.Insert(hashMessage, vchSig, pubkey);
+
+    // a bad signature is left to the message handler, the rest of the batch is still checked
+    return true;
+}
+
+void CLegacySigCheck::swap(CLegacySigCheck& check) noexcept
+{
+    std::swap(pubkey, check.pubkey);
+    std::swap(vchSig, check.vchSig);
+    std::swap(hashMessage, check.hashMessage);
+}
+
 bool CLegacySigner::GetSignatureVersion()
 {
     return true;
@@ -59,19 +151,31 @@ bool CLegacySigner::SignMessage(std::string strMessage, std::vector<unsigned cha
     return SignMessage(strMessage, errorMessage, vchSig, key);
 }
 
-bool CLegacySigner::VerifyMessage(CPubKey pubkey, std::vector<unsigned char>& vchSig, std::string strMessage, std::string& errorMessage)
+uint256 CLegacySigner::GetMessageHash(const std::string& strMessage)
 {
     CHashWriter ss(SER_GETHASH, 0);
     ss << strMessageMagic;
     ss << strMessage;
+    return ss.GetHash();
+}
+
+bool CLegacySigner::VerifyMessage(CPubKey pubkey, std::vector<unsigned char>& vchSig, std::string strMessage, std::string& errorMessage)
+{
+    const uint256 hashMessage = GetMessageHash(strMessage);
+    if (GetLegacySigCache().Contains(hashMessage, vchSig, pubkey))
+        return true;
 
     CPubKey pubkey2;
-    if (!pubkey2.RecoverCompact(ss.GetHash(), vchSig)) {
+    if (!pubkey2.RecoverCompact(hashMessage, vchSig)) {
         errorMessage = "Error recovering public key";
         return false;
     }
 
-    return PKHash(pubkey2) == PKHash(pubkey);
+    if (PKHash(pubkey2) != PKHash(pubkey))
+        return false;
+
+    GetLegacySigCache().Insert(hashMessage, vchSig, pubkey);
+    return true;
 }
 
 bool CLegacySigner::VerifyMessage(CPubKey pubkey, std::vector<unsigned char>& vchSig, std::string strMessage)
@@ -80,6 +184,13 @@ bool CLegacySigner::VerifyMessage(CPubKey pubkey, std::vector<unsigned char>& vc
     return VerifyMessage(pubkey, vchSig, strMessage, errorMessage);
 }
 
+void CLegacySigner::VerifyMessages(std::vector<CLegacySigCheck>& vChecks)
+{
+    CCheckQueueControl<CLegacySigCheck> control(&legacysigcheckqueue);
+    control.Add(vChecks);
+    control.Wait();
+}
+
 bool CLegacySigner::IsVinAssociatedWithPubkey(CTxIn& vin, CPubKey& pubkey)
 {
     CScript payee2 = GetScriptForDestination(PKHash(pubkey));
@@ -15,9 +15,33 @@
 
 using node::GetTransaction;
 
+//! number of signatures a worker takes from the legacy signature queue at once
+static const unsigned int LEGACY_SIGCHECK_BATCH_SIZE = 16;
+//! memory for remembering recently verified legacy signatures
+static const size_t LEGACY_SIGCACHE_BYTES = 4 << 20;
+
 class CLegacySigner;
 extern CLegacySigner legacySigner;
 
+/**
+ * Check of one legacy message signature, verified together with others by
+ * CLegacySigner::VerifyMessages.
+ */
+class CLegacySigCheck
+{
+private:
+    CPubKey pubkey;
+    std::vector<unsigned char> vchSig;
+    uint256 hashMessage;
+
+public:
+    CLegacySigCheck() = default;
+    CLegacySigCheck(const CPubKey& pubkeyIn, const std::vector<unsigned char>& vchSigIn, const std::string& strMessage);
+
+    bool operator()();
+    void swap(CLegacySigCheck& check) noexcept;
+};
+
 class CLegacySigner {
 public:
     bool GetSignatureVersion();
@@ -27,7 +51,14 @@ public:
     bool SignMessage(std::string strMessage, std::vector<unsigned char>& vchSig, CKey key);
     bool VerifyMessage(CPubKey pubkey, std::vector<unsigned char>& vchSig, std::string strMessage, std::string& errorMessage);
     bool VerifyMessage(CPubKey pubkey, std::vector<unsigned char>& vchSig, std::string strMessage);
+    /** Verify signatures in parallel, the valid ones are remembered so that VerifyMessage returns right away for them */
+    void VerifyMessages(std::vector<CLegacySigCheck>& vChecks);
+    static uint256 GetMessageHash(const std::string& strMessage);
     bool IsVinAssociatedWithPubkey(CTxIn& vin, CPubKey& pubkey);
 };
 
+/** Start the threads verifying legacy signatures queued by CLegacySigner::VerifyMessages */
+void StartLegacySigCheckWorkerThreads(int threads_num);
+void StopLegacySigCheckWorkerThreads();
+
 #endif // MASTERNODE_MASTERNODESIGNER_H
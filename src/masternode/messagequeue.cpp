@@ -0,0 +1,254 @@
+// Copyright (c) 2022 The Myce Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <masternode/messagequeue.h>
+
+#include <logging.h>
+#include <masternode/init.h>
+#include <masternode/masternode-budget.h>
+#include <masternode/masternode-payments.h>
+#include <masternode/masternode-sync.h>
+#include <masternode/masternodeman.h>
+#include <masternode/masternodesigner.h>
+#include <masternode/spork.h>
+#include <protocol.h>
+#include <tinyformat.h>
+#include <util/thread.h>
+
+int CMasternodeMessageQueue::GetGroup(const std::string& strCommand)
+{
+    if (strCommand == NetMsgType::MNBROADCAST || strCommand == NetMsgType::MNPING || strCommand == NetMsgType::DSEG ||
+        strCommand == NetMsgType::MNLIST)
+        return GROUP_LIST;
+    if (strCommand == NetMsgType::BUDGETVOTESYNC || strCommand == NetMsgType::BUDGETPROPOSAL || strCommand == NetMsgType::BUDGETVOTE ||
+        strCommand == NetMsgType::FINALBUDGET || strCommand == NetMsgType::FINALBUDGETVOTE)
+        return GROUP_BUDGET;
+    if (strCommand == NetMsgType::GETMNWINNERS || strCommand == NetMsgType::MNWINNER)
+        return GROUP_PAYMENTS;
+    if (strCommand == NetMsgType::SPORK || strCommand == NetMsgType::GETSPORKS)
+        return GROUP_SPORK;
+    if (strCommand == NetMsgType::SYNCSTATUSCOUNT)
+        return GROUP_SYNC;
+    return GROUP_COUNT;
+}
+
+void CMasternodeMessageQueue::ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman* connman)
+{
+    switch (GetGroup(strCommand)) {
+    case GROUP_LIST:
+        mnodeman.ProcessMessage(pfrom, strCommand, vRecv, connman);
+        break;
+    case GROUP_BUDGET:
+        budget.ProcessMessage(pfrom, strCommand, vRecv, connman);
+        break;
+    case GROUP_PAYMENTS:
+        masternodePayments.ProcessMessage(pfrom, strCommand, vRecv, connman);
+        break;
+    case GROUP_SPORK:
+        ProcessSpork(pfrom, strCommand, vRecv, connman);
+        break;
+    case GROUP_SYNC:
+        masternodeSync.ProcessMessage(pfrom, strCommand, vRecv, connman);
+        break;
+    }
+}
+
+void CMasternodeMessageQueue::Process(Message& message)
+{
+    // the peer went away while the message was queued
+    if (message.pfrom->fDisconnect)
+        return;
+
+    try {
+        ProcessMessage(message.pfrom, message.strCommand, message.vRecv, message.connman);
+    } catch (const std::exception& e) {
+        LogPrint(BCLog::NET, "%s: Exception '%s' (%s) caught processing %s from peer=%d\n", __func__, e.what(), typeid(e).name(), message.strCommand, message.pfrom->GetId());
+    }
+}
+
+bool CMasternodeMessageQueue::Push(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman* connman)
+{
+    const int nGroup = GetGroup(strCommand);
+    if (nGroup == GROUP_COUNT)
+        return false;
+
+    Message message{pfrom, connman, strCommand, std::move(vRecv)};
+    {
+        LOCK(m_mutex);
+        if (!m_worker_threads.empty()) {
+            MessageGroup& group = m_groups[nGroup];
+            std::deque<Message>& vMessages = group.mapPeerMessages[pfrom->GetId()];
+            if (vMessages.empty())
+                group.vPeers.push_back(pfrom->GetId());
+            // keep the peer alive until its message is handled
+            pfrom->AddRef();
+            vMessages.push_back(std::move(message));
+            ++m_peer_size[pfrom->GetId()];
+            ++m_size;
+            m_cv.notify_one();
+            return true;
+        }
+    }
+
+    Process(message);
+    return true;
+}
+
+void CMasternodeMessageQueue::GetSignatureChecks(const Message& message, std::vector<CLegacySigCheck>& vChecks)
+{
+    // read a copy, the handler reads the message itself
+    CDataStream vRecv(message.vRecv);
+    CPubKey pubKeyMasternode;
+
+    try {
+        if (message.strCommand == NetMsgType::MNBROADCAST) {
+            CMasternodeBroadcast mnb;
+            vRecv >> mnb;
+            vChecks.emplace_back(mnb.pubKeyCollateralAddress, mnb.sig, mnb.GetNewStrMessage());
+            vChecks.emplace_back(mnb.pubKeyMasternode, mnb.lastPing.vchSig, mnb.lastPing.GetStrMessage());
+        } else if (message.strCommand == NetMsgType::MNPING) {
+            CMasternodePing mnp;
+            vRecv >> mnp;
+            if (mnodeman.GetMasternodePubKey(mnp.vin, pubKeyMasternode))
+                vChecks.emplace_back(pubKeyMasternode, mnp.vchSig, mnp.GetStrMessage());
+        } else if (message.strCommand == NetMsgType::MNWINNER) {
+            CMasternodePaymentWinner winner;
+            vRecv >> winner;
+            if (mnodeman.GetMasternodePubKey(winner.vinMasternode, pubKeyMasternode))
+                vChecks.emplace_back(pubKeyMasternode, winner.vchSig, winner.GetStrMessage());
+        } else if (message.strCommand == NetMsgType::BUDGETVOTE) {
+            CBudgetVote vote;
+            vRecv >> vote;
+            if (mnodeman.GetMasternodePubKey(vote.vin, pubKeyMasternode))
+                vChecks.emplace_back(pubKeyMasternode, vote.vchSig, vote.GetStrMessage());
+        } else if (message.strCommand == NetMsgType::FINALBUDGETVOTE) {
+            CFinalizedBudgetVote vote;
+            vRecv >> vote;
+            if (mnodeman.GetMasternodePubKey(vote.vin, pubKeyMasternode))
+                vChecks.emplace_back(pubKeyMasternode, vote.vchSig, vote.GetStrMessage());
+        }
+    } catch (const std::exception&) {
+        // malformed messages are left to the handler
+    }
+}
+
+bool CMasternodeMessageQueue::Pop(int& nGroup, std::vector<Message>& vMessages, bool& fPeerFreed)
+{
+    for (int i = 0; i < GROUP_COUNT; i++) {
+        nGroup = (m_next_group + i) % GROUP_COUNT;
+        MessageGroup& group = m_groups[nGroup];
+        if (group.fBusy || group.vPeers.empty())
+            continue;
+
+        while (!group.vPeers.empty() && vMessages.size() < MASTERNODE_MESSAGE_BATCH_SIZE) {
+            const NodeId nodeid = group.vPeers.front();
+            group.vPeers.pop_front();
+            auto it = group.mapPeerMessages.find(nodeid);
+            vMessages.push_back(std::move(it->second.front()));
+            it->second.pop_front();
+            if (it->second.empty()) {
+                group.mapPeerMessages.erase(it);
+            } else {
+                // the peer gets its next turn after the others
+                group.vPeers.push_back(nodeid);
+            }
+            auto itSize = m_peer_size.find(nodeid);
+            if (itSize->second-- == MAX_MASTERNODE_MESSAGES_PER_PEER)
+                fPeerFreed = true;
+            if (itSize->second == 0)
+                m_peer_size.erase(itSize);
+            --m_size;
+        }
+
+        group.fBusy = true;
+        m_next_group = (nGroup + 1) % GROUP_COUNT;
+        return true;
+    }
+    return false;
+}
+
+void CMasternodeMessageQueue::Loop()
+{
+    WAIT_LOCK(m_mutex, lock);
+    while (true) {
+        int nGroup;
+        std::vector<Message> vMessages;
+        bool fPeerFreed = false;
+        while (!m_request_stop && !Pop(nGroup, vMessages, fPeerFreed)) {
+            m_cv.wait(lock);
+        }
+        if (m_request_stop)
+            return;
+
+        {
+            REVERSE_LOCK(lock);
+            // a peer that was full can be read from again
+            if (fPeerFreed && vMessages.front().connman)
+                vMessages.front().connman->WakeMessageHandler();
+
+            std::vector<CLegacySigCheck> vChecks;
+            for (const Message& message : vMessages) {
+                if (!message.pfrom->fDisconnect)
+                    GetSignatureChecks(message, vChecks);
+            }
+            legacySigner.VerifyMessages(vChecks);
+
+            for (Message& message : vMessages) {
+                Process(message);
+                message.pfrom->Release();
+            }
+        }
+
+        // the group may have more messages for another worker
+        m_groups[nGroup].fBusy = false;
+        m_cv.notify_all();
+    }
+}
+
+void CMasternodeMessageQueue::StartWorkerThreads(int nThreads)
+{
+    LOCK(m_mutex);
+    assert(m_worker_threads.empty());
+    m_request_stop = false;
+    for (int n = 0; n < nThreads; ++n) {
+        m_worker_threads.emplace_back(&util::TraceThread, strprintf("mnmsg.%i", n), [this] { Loop(); });
+    }
+}
+
+void CMasternodeMessageQueue::StopWorkerThreads()
+{
+    WITH_LOCK(m_mutex, m_request_stop = true);
+    m_cv.notify_all();
+    for (std::thread& t : m_worker_threads) {
+        t.join();
+    }
+
+    LOCK(m_mutex);
+    m_worker_threads.clear();
+    for (MessageGroup& group : m_groups) {
+        for (auto& item : group.mapPeerMessages) {
+            for (Message& message : item.second) {
+                message.pfrom->Release();
+            }
+        }
+        group.mapPeerMessages.clear();
+        group.vPeers.clear();
+        group.fBusy = false;
+    }
+    m_peer_size.clear();
+    m_size = 0;
+}
+
+bool CMasternodeMessageQueue::IsPeerFull(NodeId nodeid)
+{
+    LOCK(m_mutex);
+    auto it = m_peer_size.find(nodeid);
+    return it != m_peer_size.end() && it->second >= MAX_MASTERNODE_MESSAGES_PER_PEER;
+}
+
+size_t CMasternodeMessageQueue::size()
+{
+    LOCK(m_mutex);
+    return m_size;
+}
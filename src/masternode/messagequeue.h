@@ -0,0 +1,112 @@
+// Copyright (c) 2022 The Myce Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef MASTERNODE_MESSAGEQUEUE_H
+#define MASTERNODE_MESSAGEQUEUE_H
+
+#include <net.h>
+#include <streams.h>
+#include <sync.h>
+
+#include <array>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+class CLegacySigCheck;
+
+//! number of threads handling masternode, budget and spork messages
+static const int DEFAULT_MASTERNODE_MESSAGE_THREADS = 2;
+//! messages queued per peer, further messages from that peer are left unread until the workers catch up
+static const size_t MAX_MASTERNODE_MESSAGES_PER_PEER = 1000;
+//! messages a worker takes from a group at once, their signatures are verified together
+static const size_t MASTERNODE_MESSAGE_BATCH_SIZE = 64;
+
+/**
+ * Queue of masternode, budget, payment, spork and sync messages, handled off the
+ * message handler thread so that bursts of them don't hold up block and
+ * transaction relay.
+ *
+ * Messages are queued per handler group and per peer. Workers take the groups in
+ * turn and the peers of a group in turn, and each group is handled by one worker
+ * at a time, as the handlers expect messages one by one.
+ *
+ * A worker takes a batch of messages from a group and verifies their signatures
+ * in parallel first, so that the handlers find them in the signature cache.
+ */
+class CMasternodeMessageQueue
+{
+private:
+    enum Group {
+        GROUP_LIST,     // mnodeman
+        GROUP_BUDGET,   // budget
+        GROUP_PAYMENTS, // masternodePayments
+        GROUP_SPORK,    // sporks
+        GROUP_SYNC,     // masternodeSync
+        GROUP_COUNT
+    };
+
+    struct Message {
+        CNode* pfrom;
+        CConnman* connman;
+        std::string strCommand;
+        CDataStream vRecv;
+    };
+
+    struct MessageGroup {
+        std::map<NodeId, std::deque<Message>> mapPeerMessages;
+        //! peers with queued messages, in the order they are served
+        std::deque<NodeId> vPeers;
+        //! a worker is handling a message of this group
+        bool fBusy{false};
+    };
+
+    Mutex m_mutex;
+    std::condition_variable m_cv;
+    std::array<MessageGroup, GROUP_COUNT> m_groups GUARDED_BY(m_mutex);
+    //! queued messages per peer, over all groups
+    std::map<NodeId, size_t> m_peer_size GUARDED_BY(m_mutex);
+    //! group to look at first for the next message
+    int m_next_group GUARDED_BY(m_mutex){0};
+    size_t m_size GUARDED_BY(m_mutex){0};
+    bool m_request_stop GUARDED_BY(m_mutex){false};
+    std::vector<std::thread> m_worker_threads;
+
+    static int GetGroup(const std::string& strCommand);
+    void Process(Message& message);
+    static void GetSignatureChecks(const Message& message, std::vector<CLegacySigCheck>& vChecks);
+
+    bool Pop(int& nGroup, std::vector<Message>& vMessages, bool& fPeerFreed) EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+    void Loop() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+protected:
+    /** Pass a message to its handler, overridden by tests */
+    virtual void ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman* connman);
+
+public:
+    virtual ~CMasternodeMessageQueue() = default;
+
+    /** Whether strCommand is handled by this queue */
+    static bool IsMasternodeMessage(const std::string& strCommand) { return GetGroup(strCommand) != GROUP_COUNT; }
+
+    /** Queue a message, or handle it right away when no workers run. Returns false if strCommand is not handled by this queue. */
+    bool Push(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman* connman) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    /**
+     * Whether a peer has MAX_MASTERNODE_MESSAGES_PER_PEER messages queued. The
+     * message handler doesn't read from it meanwhile, so that sync replies are
+     * never dropped, and is woken up once the workers made room.
+     */
+    bool IsPeerFull(NodeId nodeid) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    void StartWorkerThreads(int nThreads) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    /** Stop the workers and drop the queued messages. Must be called before the peers are deleted. */
+    void StopWorkerThreads() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    size_t size() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+};
+
+#endif // MASTERNODE_MESSAGEQUEUE_H
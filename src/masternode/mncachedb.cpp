@@ -0,0 +1,85 @@
+// Copyright (c) 2022 The Myce Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <masternode/mncachedb.h>
+
+#include <logging.h>
+#include <masternode/init.h>
+#include <masternode/masternode-budget.h>
+#include <masternode/masternode-payments.h>
+#include <masternode/masternodeman.h>
+#include <util/system.h>
+#include <util/time.h>
+
+class CMasternodeCacheDB;
+CMasternodeCacheDB* pMasternodeCacheDB = NULL;
+
+static const uint8_t DB_VERSION{'V'};
+
+CMasternodeCacheDB::CMasternodeCacheDB(size_t nCacheSize, bool fMemory, bool fWipe)
+    : CDBWrapper(gArgs.GetDataDirNet() / "mncache", nCacheSize, fMemory, fWipe),
+      masternodes(*this, 'm'),
+      seenBroadcasts(*this, 'b'),
+      seenPings(*this, 'p'),
+      masternodeState(*this, 's'),
+      paymentVotes(*this, 'w'),
+      paymentBlocks(*this, 'k'),
+      proposals(*this, 'P'),
+      finalizedBudgets(*this, 'F'),
+      seenProposals(*this, 'q'),
+      seenProposalVotes(*this, 'v'),
+      orphanProposalVotes(*this, 'o'),
+      seenFinalizedBudgets(*this, 'f'),
+      seenFinalizedBudgetVotes(*this, 'u'),
+      orphanFinalizedBudgetVotes(*this, 'x')
+{
+}
+
+bool CMasternodeCacheDB::IsInitialized()
+{
+    return Exists(DB_VERSION);
+}
+
+bool CMasternodeCacheDB::WriteCacheBatch(CDBBatch& batch)
+{
+    batch.Write(DB_VERSION, CLIENT_VERSION);
+    if (WriteBatch(batch))
+        return true;
+
+    // the changes that were in the batch are lost, so write everything next time
+    masternodes.Reset();
+    seenBroadcasts.Reset();
+    seenPings.Reset();
+    masternodeState.Reset();
+    paymentVotes.Reset();
+    paymentBlocks.Reset();
+    proposals.Reset();
+    finalizedBudgets.Reset();
+    seenProposals.Reset();
+    seenProposalVotes.Reset();
+    orphanProposalVotes.Reset();
+    seenFinalizedBudgets.Reset();
+    seenFinalizedBudgetVotes.Reset();
+    orphanFinalizedBudgetVotes.Reset();
+    return false;
+}
+
+void FlushMasternodeCaches()
+{
+    // the masternode thread and shutdown both flush, one at a time
+    static Mutex cs_flush;
+    LOCK(cs_flush);
+
+    if (!pMasternodeCacheDB)
+        return;
+
+    int64_t nStart = GetTimeMillis();
+    bool fOk = mnodeman.FlushCache(*pMasternodeCacheDB);
+    fOk &= masternodePayments.FlushCache(*pMasternodeCacheDB);
+    fOk &= budget.FlushCache(*pMasternodeCacheDB);
+    if (!fOk)
+        LogPrintf("%s : Failed to write the masternode caches\n", __func__);
+
+    LogPrint(BCLog::MASTERNODE, "Flushed masternode caches  %dms\n", GetTimeMillis() - nStart);
+}
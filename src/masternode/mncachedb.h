@@ -0,0 +1,234 @@
+// Copyright (c) 2022 The Myce Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef MASTERNODE_MNCACHEDB_H
+#define MASTERNODE_MNCACHEDB_H
+
+#include <dbwrapper.h>
+#include <primitives/transaction.h>
+#include <uint256.h>
+
+#include <memory>
+#include <set>
+
+//! seconds between writes of the masternode, payment and budget caches
+static const int MASTERNODE_CACHE_FLUSH_SECONDS = 5 * 60;
+
+class CMasternodeCacheDB;
+extern CMasternodeCacheDB* pMasternodeCacheDB;
+
+/**
+ * Keys of a cached map that were added, changed or erased since the last
+ * flush, or all of them after the map was replaced as a whole.
+ */
+template <typename K>
+class CMasternodeCacheChanges
+{
+private:
+    std::set<K> setKeys;
+    //! every entry may have changed, so the next flush writes them all
+    bool fAll{true};
+
+public:
+    void Set(const K& key)
+    {
+        if (!fAll)
+            setKeys.insert(key);
+    }
+
+    void SetAll()
+    {
+        fAll = true;
+        setKeys.clear();
+    }
+
+    bool IsAll() const { return fAll; }
+    bool IsSet(const K& key) const { return fAll || setKeys.count(key); }
+    const std::set<K>& GetKeys() const { return setKeys; }
+
+    /** Forget the changes once they were written, or after the map was read from the database */
+    void Clear()
+    {
+        fAll = false;
+        setKeys.clear();
+    }
+};
+
+/**
+ * The records of one cached map that are in the database. A flush writes the
+ * records whose keys were marked as changed and erases the ones that went
+ * away, so it costs as much as the changes instead of the whole map.
+ */
+template <typename K>
+class CMasternodeCacheRecords
+{
+private:
+    CDBWrapper& db;
+    const uint8_t chPrefix;
+    //! keys of the records in the database
+    std::set<K> setWritten;
+    //! the last flush failed, so the next one writes every record
+    bool fRewrite{false};
+
+public:
+    CMasternodeCacheRecords(CDBWrapper& dbIn, uint8_t chPrefixIn) : db(dbIn), chPrefix(chPrefixIn) {}
+
+    /**
+     * Write the changed records. find(key) returns the record with that key
+     * or nullptr, forEach(fn) calls fn(key, record) for every record.
+     */
+    template <typename V, typename Find, typename ForEach>
+    void Write(CDBBatch& batch, CMasternodeCacheChanges<K>& changes, Find find, ForEach forEach)
+    {
+        if (fRewrite || changes.IsAll()) {
+            std::set<K> setKept;
+            forEach([&](const K& key, const V& value) {
+                batch.Write(std::make_pair(chPrefix, key), value);
+                setKept.insert(key);
+            });
+            for (const K& key : setWritten) {
+                if (!setKept.count(key))
+                    batch.Erase(std::make_pair(chPrefix, key));
+            }
+            setWritten.swap(setKept);
+        } else {
+            for (const K& key : changes.GetKeys()) {
+                const V* pvalue = find(key);
+                if (pvalue) {
+                    batch.Write(std::make_pair(chPrefix, key), *pvalue);
+                    setWritten.insert(key);
+                } else if (setWritten.erase(key)) {
+                    batch.Erase(std::make_pair(chPrefix, key));
+                }
+            }
+        }
+        changes.Clear();
+        fRewrite = false;
+    }
+
+    template <typename M>
+    void Write(CDBBatch& batch, const M& mapRecords, CMasternodeCacheChanges<K>& changes)
+    {
+        typedef typename M::mapped_type V;
+        Write<V>(
+            batch, changes,
+            [&](const K& key) -> const V* {
+                auto it = mapRecords.find(key);
+                return it == mapRecords.end() ? nullptr : &it->second;
+            },
+            [&](auto fn) {
+                for (const auto& item : mapRecords) {
+                    fn(item.first, item.second);
+                }
+            });
+    }
+
+    /** Write a single record if it changed, call Finish once all of them were added */
+    template <typename V>
+    void Write(CDBBatch& batch, const K& key, const V& value, const CMasternodeCacheChanges<K>& changes)
+    {
+        if (fRewrite || changes.IsSet(key)) {
+            batch.Write(std::make_pair(chPrefix, key), value);
+            setWritten.insert(key);
+        }
+    }
+
+    void Finish(CMasternodeCacheChanges<K>& changes)
+    {
+        changes.Clear();
+        fRewrite = false;
+    }
+
+    /** The batch was not written, so read back which records the database has and write every record next time */
+    void Reset()
+    {
+        setWritten.clear();
+        fRewrite = true;
+
+        std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+        pcursor->Seek(chPrefix);
+        for (; pcursor->Valid(); pcursor->Next()) {
+            std::pair<uint8_t, K> key;
+            if (!pcursor->GetKey(key) || key.first != chPrefix)
+                break;
+            setWritten.insert(key.second);
+        }
+    }
+
+    /** Read a single record */
+    template <typename V>
+    bool Read(const K& key, V& value)
+    {
+        if (!db.Read(std::make_pair(chPrefix, key), value))
+            return false;
+        setWritten.insert(key);
+        return true;
+    }
+
+    /** Read the records one by one, passing them to fn. Returns false on a bad record. */
+    template <typename V, typename F>
+    bool Read(F fn)
+    {
+        std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+        pcursor->Seek(chPrefix);
+
+        for (; pcursor->Valid(); pcursor->Next()) {
+            std::pair<uint8_t, K> key;
+            if (!pcursor->GetKey(key) || key.first != chPrefix)
+                break;
+
+            V value;
+            if (!pcursor->GetValue(value))
+                return false;
+            fn(key.second, value);
+            setWritten.insert(key.second);
+        }
+        return true;
+    }
+};
+
+/**
+ * Access to the masternode list, payment votes and budgets kept across
+ * restarts, which were saved as a whole in mncache.dat, mnpayments.dat and
+ * budget.dat before.
+ */
+class CMasternodeCacheDB : public CDBWrapper
+{
+public:
+    CMasternodeCacheDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+
+private:
+    CMasternodeCacheDB(const CMasternodeCacheDB&);
+    void operator=(const CMasternodeCacheDB&);
+
+public:
+    // CMasternodeMan
+    CMasternodeCacheRecords<COutPoint> masternodes;
+    CMasternodeCacheRecords<uint256> seenBroadcasts;
+    CMasternodeCacheRecords<uint256> seenPings;
+    CMasternodeCacheRecords<uint8_t> masternodeState;
+
+    // CMasternodePayments
+    CMasternodeCacheRecords<uint256> paymentVotes;
+    CMasternodeCacheRecords<int> paymentBlocks;
+
+    // CBudgetManager
+    CMasternodeCacheRecords<uint256> proposals;
+    CMasternodeCacheRecords<uint256> finalizedBudgets;
+    CMasternodeCacheRecords<uint256> seenProposals;
+    CMasternodeCacheRecords<uint256> seenProposalVotes;
+    CMasternodeCacheRecords<uint256> orphanProposalVotes;
+    CMasternodeCacheRecords<uint256> seenFinalizedBudgets;
+    CMasternodeCacheRecords<uint256> seenFinalizedBudgetVotes;
+    CMasternodeCacheRecords<uint256> orphanFinalizedBudgetVotes;
+
+    /** Whether the caches were written to the database, otherwise they are still in the .dat files */
+    bool IsInitialized();
+    bool WriteCacheBatch(CDBBatch& batch);
+};
+
+/** Write the changes to the masternode, payment and budget caches */
+void FlushMasternodeCaches();
+
+#endif // MASTERNODE_MNCACHEDB_H
@@ -0,0 +1,229 @@
+// Copyright (c) 2022 The Myce Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef MASTERNODE_SEENCACHE_H
+#define MASTERNODE_SEENCACHE_H
+
+#include <memusage.h>
+#include <serialize.h>
+#include <util/hasher.h>
+#include <util/time.h>
+
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+struct CSeenCacheStats {
+    size_t nSize{0};
+    size_t nUsage{0};
+};
+
+/**
+ * Map of recently seen masternode and budget gossip, bounded in size and age.
+ *
+ * Entries are kept in the order they were added. Once there are more than
+ * nMaxSize of them, or the oldest was added more than nMaxAge seconds ago, the
+ * oldest are dropped, so memory stays flat however long the node runs instead
+ * of depending on cleanup passes.
+ *
+ * The interface is the part of std::map that the masternode code uses.
+ * Assigning through operator[] does not count as adding; insert_or_assign does.
+ *
+ * With TrackChanges, the keys of entries that were added, erased, dropped or
+ * accessed through operator[] are kept until TakeChanges, so that only those
+ * are written to the masternode cache database.
+ */
+template <typename K, typename V, typename Hasher = SaltedTxidHasher>
+class CSeenCache
+{
+public:
+    typedef std::unordered_map<K, V, Hasher> map_type;
+    typedef V mapped_type;
+    typedef typename map_type::value_type value_type;
+    typedef typename map_type::iterator iterator;
+    typedef typename map_type::const_iterator const_iterator;
+
+private:
+    size_t nMaxSize;
+    int64_t nMaxAge;
+
+    map_type mapEntries;
+    //! when each entry was added
+    std::unordered_map<K, int64_t, Hasher> mapAdded;
+    //! entries in the order they were added, also holding ones erased since
+    std::deque<std::pair<int64_t, K>> vAdded;
+    bool fTrackChanges{false};
+    //! keys changed since the last TakeChanges
+    std::unordered_set<K, Hasher> setChanged;
+
+    void Changed(const K& key)
+    {
+        if (fTrackChanges)
+            setChanged.insert(key);
+    }
+
+    void Added(const K& key)
+    {
+        Changed(key);
+        const int64_t nNow = GetTime();
+        mapAdded[key] = nNow;
+        vAdded.emplace_back(nNow, key);
+        Trim(nNow);
+    }
+
+    void Trim(int64_t nNow)
+    {
+        while (!vAdded.empty()) {
+            const std::pair<int64_t, K>& front = vAdded.front();
+            auto it = mapAdded.find(front.second);
+            if (it != mapAdded.end() && it->second == front.first) {
+                if (mapEntries.size() <= nMaxSize && front.first >= nNow - nMaxAge)
+                    break;
+                Changed(front.second);
+                mapEntries.erase(front.second);
+                mapAdded.erase(it);
+            }
+            vAdded.pop_front();
+        }
+
+        // forget erased and re-added entries once they outnumber the live ones
+        if (vAdded.size() > 2 * mapAdded.size() + 64) {
+            std::deque<std::pair<int64_t, K>> vLive;
+            for (const std::pair<int64_t, K>& item : vAdded) {
+                auto it = mapAdded.find(item.second);
+                if (it != mapAdded.end() && it->second == item.first)
+                    vLive.push_back(item);
+            }
+            vAdded.swap(vLive);
+        }
+    }
+
+public:
+    CSeenCache(size_t nMaxSizeIn, int64_t nMaxAgeIn) : nMaxSize(nMaxSizeIn), nMaxAge(nMaxAgeIn) {}
+
+    iterator begin() { return mapEntries.begin(); }
+    iterator end() { return mapEntries.end(); }
+    const_iterator begin() const { return mapEntries.begin(); }
+    const_iterator end() const { return mapEntries.end(); }
+
+    size_t size() const { return mapEntries.size(); }
+    bool empty() const { return mapEntries.empty(); }
+    size_t count(const K& key) const { return mapEntries.count(key); }
+    iterator find(const K& key) { return mapEntries.find(key); }
+    const_iterator find(const K& key) const { return mapEntries.find(key); }
+
+    /** Keep the keys of changed entries from now on */
+    void TrackChanges() { fTrackChanges = true; }
+
+    /** Call fn with the key of each entry changed since the last call */
+    template <typename F>
+    void TakeChanges(F fn)
+    {
+        for (const K& key : setChanged) {
+            fn(key);
+        }
+        setChanged.clear();
+    }
+
+    V& operator[](const K& key)
+    {
+        auto it = mapEntries.find(key);
+        if (it != mapEntries.end()) {
+            Changed(key);
+            return it->second;
+        }
+
+        it = mapEntries.emplace(key, V()).first;
+        Added(key);
+        return it->second;
+    }
+
+    std::pair<iterator, bool> insert(const value_type& value)
+    {
+        std::pair<iterator, bool> ret = mapEntries.insert(value);
+        if (ret.second)
+            Added(value.first);
+        return ret;
+    }
+
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(Args&&... args)
+    {
+        std::pair<iterator, bool> ret = mapEntries.emplace(std::forward<Args>(args)...);
+        if (ret.second)
+            Added(ret.first->first);
+        return ret;
+    }
+
+    /** Set the entry and count it as added now */
+    void insert_or_assign(const K& key, const V& value)
+    {
+        mapEntries[key] = value;
+        Added(key);
+    }
+
+    size_t erase(const K& key)
+    {
+        Changed(key);
+        mapAdded.erase(key);
+        return mapEntries.erase(key);
+    }
+
+    iterator erase(iterator it)
+    {
+        Changed(it->first);
+        mapAdded.erase(it->first);
+        return mapEntries.erase(it);
+    }
+
+    void clear()
+    {
+        if (fTrackChanges) {
+            for (const value_type& item : mapEntries) {
+                setChanged.insert(item.first);
+            }
+        }
+        mapEntries.clear();
+        mapAdded.clear();
+        vAdded.clear();
+    }
+
+    size_t DynamicMemoryUsage() const
+    {
+        return memusage::DynamicUsage(mapEntries) + memusage::DynamicUsage(mapAdded) + vAdded.size() * sizeof(std::pair<int64_t, K>) + memusage::DynamicUsage(setChanged);
+    }
+
+    CSeenCacheStats GetStats() const
+    {
+        CSeenCacheStats stats;
+        stats.nSize = mapEntries.size();
+        stats.nUsage = DynamicMemoryUsage();
+        return stats;
+    }
+
+    // serialized like a std::map, so the .dat files read as before
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        WriteCompactSize(s, mapEntries.size());
+        for (const value_type& item : mapEntries) {
+            s << item;
+        }
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s)
+    {
+        clear();
+        const uint64_t nSize = ReadCompactSize(s);
+        for (uint64_t i = 0; i < nSize; i++) {
+            std::pair<K, V> item;
+            s >> item;
+            insert(item);
+        }
+    }
+};
+
+#endif // MASTERNODE_SEENCACHE_H
@@ -16,6 +16,9 @@
 #include <util/system.h>
 #include <validation.h>
 
+#include <array>
+#include <atomic>
+
 #include <boost/lexical_cast.hpp>
 
 using namespace std;
@@ -24,9 +27,73 @@ using namespace boost;
 class CSporkMessage;
 class CSporkManager;
 
+Mutex cs_sporks;
 std::map<uint256, CSporkMessage> mapSporks;
 std::map<int, CSporkMessage> mapSporksActive;
 
+static int64_t GetSporkDefault(int nSporkID)
+{
+    switch (nSporkID) {
+    case SPORK_2_SWIFTTX: return SPORK_2_SWIFTTX_DEFAULT;
+    case SPORK_3_SWIFTTX_BLOCK_FILTERING: return SPORK_3_SWIFTTX_BLOCK_FILTERING_DEFAULT;
+    case SPORK_5_MAX_VALUE: return SPORK_5_MAX_VALUE_DEFAULT;
+    case SPORK_7_MASTERNODE_SCANNING: return SPORK_7_MASTERNODE_SCANNING_DEFAULT;
+    case SPORK_8_MASTERNODE_PAYMENT_ENFORCEMENT: return SPORK_8_MASTERNODE_PAYMENT_ENFORCEMENT_DEFAULT;
+    case SPORK_9_MASTERNODE_BUDGET_ENFORCEMENT: return SPORK_9_MASTERNODE_BUDGET_ENFORCEMENT_DEFAULT;
+    case SPORK_10_MASTERNODE_PAY_UPDATED_NODES: return SPORK_10_MASTERNODE_PAY_UPDATED_NODES_DEFAULT;
+    case SPORK_13_ENABLE_SUPERBLOCKS: return SPORK_13_ENABLE_SUPERBLOCKS_DEFAULT;
+    case SPORK_14_NEW_PROTOCOL_ENFORCEMENT: return SPORK_14_NEW_PROTOCOL_ENFORCEMENT_DEFAULT;
+    case SPORK_15_NEW_PROTOCOL_ENFORCEMENT_2: return SPORK_15_NEW_PROTOCOL_ENFORCEMENT_2_DEFAULT;
+    case SPORK_16_ZEROCOIN_MAINTENANCE_MODE: return SPORK_16_ZEROCOIN_MAINTENANCE_MODE_DEFAULT;
+    default: return -1;
+    }
+}
+
+/**
+ * Current value of every spork, indexed by nSporkID - SPORK_START, so that
+ * the checks in the masternode loops read a single atomic instead of looking
+ * up mapSporksActive. Written under cs_sporks together with mapSporksActive.
+ */
+class CSporkValues
+{
+private:
+    std::array<std::atomic<int64_t>, SPORK_END - SPORK_START + 1> values;
+
+public:
+    CSporkValues()
+    {
+        for (int i = SPORK_START; i <= SPORK_END; ++i) {
+            values[i - SPORK_START].store(GetSporkDefault(i), std::memory_order_relaxed);
+        }
+    }
+
+    int64_t Get(int nSporkID) const
+    {
+        if (nSporkID < SPORK_START || nSporkID > SPORK_END)
+            return -1;
+        return values[nSporkID - SPORK_START].load(std::memory_order_relaxed);
+    }
+
+    void Set(int nSporkID, int64_t nValue) EXCLUSIVE_LOCKS_REQUIRED(cs_sporks)
+    {
+        AssertLockHeld(cs_sporks);
+        if (nSporkID < SPORK_START || nSporkID > SPORK_END)
+            return;
+        values[nSporkID - SPORK_START].store(nValue, std::memory_order_relaxed);
+    }
+};
+
+static CSporkValues sporkValues;
+
+/** Make spork the active one for its ID */
+static void SetSporkActive(const CSporkMessage& spork) EXCLUSIVE_LOCKS_REQUIRED(cs_sporks)
+{
+    AssertLockHeld(cs_sporks);
+    mapSporks[spork.GetHash()] = spork;
+    mapSporksActive[spork.nSporkID] = spork;
+    sporkValues.Set(spork.nSporkID, spork.nValue);
+}
+
 // Myce: on startup load spork values from previous session if they exist in the sporkDB
 void LoadSporksFromDB()
 {
@@ -44,8 +111,7 @@ void LoadSporksFromDB()
         }
 
         // add spork to memory
-        mapSporks[spork.GetHash()] = spork;
-        mapSporksActive[spork.nSporkID] = spork;
+        WITH_LOCK(cs_sporks, SetSporkActive(spork));
         std::time_t result = spork.nValue;
         // If SPORK Value is greater than 1,000,000 assume it's actually a Date and then convert to a more readable format
         if (spork.nValue > 1000000) {
@@ -73,12 +139,16 @@ void ProcessSpork(CNode* pfrom, const std::string& strCommand, CDataStream& vRec
             return;
 
         uint256 hash = spork.GetHash();
-        if (mapSporksActive.count(spork.nSporkID)) {
-            if (mapSporksActive[spork.nSporkID].nTimeSigned >= spork.nTimeSigned) {
-                LogPrintf("%s : seen %s (signed %d)\n", __func__, hash.ToString(), spork.nTimeSigned);
-                return;
-            } else {
-                LogPrintf("%s : got updated spork %s (signed %d)\n", __func__, hash.ToString(), spork.nTimeSigned);
+        {
+            LOCK(cs_sporks);
+            auto it = mapSporksActive.find(spork.nSporkID);
+            if (it != mapSporksActive.end()) {
+                if (it->second.nTimeSigned >= spork.nTimeSigned) {
+                    LogPrintf("%s : seen %s (signed %d)\n", __func__, hash.ToString(), spork.nTimeSigned);
+                    return;
+                } else {
+                    LogPrintf("%s : got updated spork %s (signed %d)\n", __func__, hash.ToString(), spork.nTimeSigned);
+                }
             }
         }
 
@@ -96,8 +166,14 @@ void ProcessSpork(CNode* pfrom, const std::string& strCommand, CDataStream& vRec
             return;
         }
 
-        mapSporks[hash] = spork;
-        mapSporksActive[spork.nSporkID] = spork;
+        {
+            LOCK(cs_sporks);
+            // a newer one may have been accepted while the signature was checked
+            auto it = mapSporksActive.find(spork.nSporkID);
+            if (it != mapSporksActive.end() && it->second.nTimeSigned >= spork.nTimeSigned)
+                return;
+            SetSporkActive(spork);
+        }
         sporkManager.Relay(spork, connman);
 
         // Myce: add to spork database.
@@ -107,11 +183,16 @@ void ProcessSpork(CNode* pfrom, const std::string& strCommand, CDataStream& vRec
     if (strCommand == NetMsgType::GETSPORKS) {
 
         const CNetMsgMaker msgMaker(PROTOCOL_VERSION);
-        std::map<int, CSporkMessage>::iterator it = mapSporksActive.begin();
+        std::vector<CSporkMessage> vSporks;
+        {
+            LOCK(cs_sporks);
+            for (const auto& item : mapSporksActive) {
+                vSporks.push_back(item.second);
+            }
+        }
 
-        while (it != mapSporksActive.end()) {
-            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::SPORK, it->second));
-            it++;
+        for (const CSporkMessage& spork : vSporks) {
+            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::SPORK, spork));
         }
     }
 }
@@ -119,37 +200,9 @@ void ProcessSpork(CNode* pfrom, const std::string& strCommand, CDataStream& vRec
 // grab the value of the spork on the network, or the default
 int64_t GetSporkValue(int nSporkID)
 {
-    int64_t r = -1;
-
-    if (mapSporksActive.count(nSporkID)) {
-        r = mapSporksActive[nSporkID].nValue;
-    } else {
-        if (nSporkID == SPORK_2_SWIFTTX)
-            r = SPORK_2_SWIFTTX_DEFAULT;
-        if (nSporkID == SPORK_3_SWIFTTX_BLOCK_FILTERING)
-            r = SPORK_3_SWIFTTX_BLOCK_FILTERING_DEFAULT;
-        if (nSporkID == SPORK_5_MAX_VALUE)
-            r = SPORK_5_MAX_VALUE_DEFAULT;
-        if (nSporkID == SPORK_7_MASTERNODE_SCANNING)
-            r = SPORK_7_MASTERNODE_SCANNING_DEFAULT;
-        if (nSporkID == SPORK_8_MASTERNODE_PAYMENT_ENFORCEMENT)
-            r = SPORK_8_MASTERNODE_PAYMENT_ENFORCEMENT_DEFAULT;
-        if (nSporkID == SPORK_9_MASTERNODE_BUDGET_ENFORCEMENT)
-            r = SPORK_9_MASTERNODE_BUDGET_ENFORCEMENT_DEFAULT;
-        if (nSporkID == SPORK_10_MASTERNODE_PAY_UPDATED_NODES)
-            r = SPORK_10_MASTERNODE_PAY_UPDATED_NODES_DEFAULT;
-        if (nSporkID == SPORK_13_ENABLE_SUPERBLOCKS)
-            r = SPORK_13_ENABLE_SUPERBLOCKS_DEFAULT;
-        if (nSporkID == SPORK_14_NEW_PROTOCOL_ENFORCEMENT)
-            r = SPORK_14_NEW_PROTOCOL_ENFORCEMENT_DEFAULT;
-        if (nSporkID == SPORK_15_NEW_PROTOCOL_ENFORCEMENT_2)
-            r = SPORK_15_NEW_PROTOCOL_ENFORCEMENT_2_DEFAULT;
-        if (nSporkID == SPORK_16_ZEROCOIN_MAINTENANCE_MODE)
-            r = SPORK_16_ZEROCOIN_MAINTENANCE_MODE_DEFAULT;
-
-        if (r == -1)
-            LogPrintf("%s : Unknown Spork %d\n", __func__, nSporkID);
-    }
+    int64_t r = sporkValues.Get(nSporkID);
+    if (r == -1)
+        LogPrintf("%s : Unknown Spork %d\n", __func__, nSporkID);
 
     return r;
 }
@@ -209,8 +262,7 @@ bool CSporkManager::UpdateSpork(int nSporkID, int64_t nValue, CConnman* connman)
 
     if (Sign(msg)) {
         Relay(msg, connman);
-        mapSporks[msg.GetHash()] = msg;
-        mapSporksActive[nSporkID] = msg;
+        WITH_LOCK(cs_sporks, SetSporkActive(msg));
         return true;
     }
 
@@ -53,11 +53,13 @@ using namespace boost;
 #define SPORK_16_ZEROCOIN_MAINTENANCE_MODE_DEFAULT 4070908800 // OFF
 
 class CSporkMessage;
-extern std::map<uint256, CSporkMessage> mapSporks;
-extern std::map<int, CSporkMessage> mapSporksActive;
+extern Mutex cs_sporks;
+extern std::map<uint256, CSporkMessage> mapSporks GUARDED_BY(cs_sporks);
+extern std::map<int, CSporkMessage> mapSporksActive GUARDED_BY(cs_sporks);
 
 void LoadSporksFromDB();
 void ProcessSpork(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman* connman);
+/** Value of a spork, without taking a lock. -1 for unknown sporks. */
 int64_t GetSporkValue(int nSporkID);
 bool IsSporkActive(int nSporkID);
 
@@ -73,7 +75,7 @@ public:
     int64_t nValue;
     int64_t nTimeSigned;
 
-    uint256 GetHash()
+    uint256 GetHash() const
     {
         CHashWriter s(SER_GETHASH, 0);
         s << nSporkID;
@@ -5,13 +5,16 @@ void ProcessGetDataMasternodeTypes(CNode* pfrom, const CChainParams& chainparams
     const CNetMsgMaker msgMaker(PROTOCOL_VERSION);
 
     if (!pushed && inv.type == MSG_SPORK) {
-        if (mapSporks.count(inv.hash)) {
-            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::SPORK, mapSporks[inv.hash]));
+        LOCK(cs_sporks);
+        auto it = mapSporks.find(inv.hash);
+        if (it != mapSporks.end()) {
+            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::SPORK, it->second));
             pushed = true;
         }
     }
 
     if (!pushed && inv.type == MSG_MASTERNODE_WINNER) {
+        LOCK(cs_mapMasternodePayeeVotes);
         if (masternodePayments.mapMasternodePayeeVotes.count(inv.hash)) {
             connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::MNWINNER, masternodePayments.mapMasternodePayeeVotes[inv.hash]));
             pushed = true;
@@ -19,27 +22,31 @@ void ProcessGetDataMasternodeTypes(CNode* pfrom, const CChainParams& chainparams
     }
 
     if (!pushed && inv.type == MSG_MASTERNODE_ANNOUNCE) {
-        if (mnodeman.mapSeenMasternodeBroadcast.count(inv.hash)) {
-            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::MNBROADCAST, mnodeman.mapSeenMasternodeBroadcast[inv.hash]));
+        CMasternodeBroadcast mnb;
+        if (mnodeman.GetSeenBroadcast(inv.hash, mnb)) {
+            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::MNBROADCAST, mnb));
             pushed = true;
         }
     }
 
     if (!pushed && inv.type == MSG_MASTERNODE_PING) {
-        if (mnodeman.mapSeenMasternodePing.count(inv.hash)){
-            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::MNPING, mnodeman.mapSeenMasternodePing[inv.hash]));
+        CMasternodePing mnp;
+        if (mnodeman.GetSeenPing(inv.hash, mnp)) {
+            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::MNPING, mnp));
             pushed = true;
         }
     }
 
     if (!pushed && inv.type == MSG_BUDGET_VOTE) {
-        if (budget.mapSeenMasternodeBudgetVotes.count(inv.hash)) {
-            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::BUDGETVOTE, budget.mapSeenMasternodeBudgetVotes[inv.hash]));
+        CBudgetVote vote;
+        if (budget.GetProposalVote(inv.hash, vote)) {
+            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::BUDGETVOTE, vote));
             pushed = true;
         }
     }
 
     if (!pushed && inv.type == MSG_BUDGET_PROPOSAL) {
+        LOCK(budget.cs);
         if (budget.mapSeenMasternodeBudgetProposals.count(inv.hash)) {
             connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::BUDGETPROPOSAL, budget.mapSeenMasternodeBudgetProposals[inv.hash]));
             pushed = true;
@@ -47,13 +54,15 @@ void ProcessGetDataMasternodeTypes(CNode* pfrom, const CChainParams& chainparams
     }
 
     if (!pushed && inv.type == MSG_BUDGET_FINALIZED_VOTE) {
-        if (budget.mapSeenFinalizedBudgetVotes.count(inv.hash)) {
-            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::FINALBUDGETVOTE, budget.mapSeenFinalizedBudgetVotes[inv.hash]));
+        CFinalizedBudgetVote vote;
+        if (budget.GetFinalizedBudgetVote(inv.hash, vote)) {
+            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::FINALBUDGETVOTE, vote));
             pushed = true;
         }
     }
 
     if (!pushed && inv.type == MSG_BUDGET_FINALIZED) {
+        LOCK(budget.cs);
         if (budget.mapSeenFinalizedBudgets.count(inv.hash)) {
             connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::FINALBUDGET, budget.mapSeenFinalizedBudgets[inv.hash]));
             pushed = true;
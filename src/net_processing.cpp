@@ -47,6 +47,7 @@
 #include <masternode/masternode-payments.h>
 #include <masternode/masternode-sync.h>
 #include <masternode/masternodeman.h>
+#include <masternode/messagequeue.h>
 #include <masternode/spork.h>
 
 #include <algorithm>
@@ -4865,13 +4866,9 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
         return;
     }
 
-    // masternode-type messages
-    {
-        mnodeman.ProcessMessage(&pfrom, msg_type, vRecv, &m_connman);
-        budget.ProcessMessage(&pfrom, msg_type, vRecv, &m_connman);
-        masternodePayments.ProcessMessage(&pfrom, msg_type, vRecv, &m_connman);
-        ProcessSpork(&pfrom, msg_type, vRecv, &m_connman);
-        masternodeSync.ProcessMessage(&pfrom, msg_type, vRecv, &m_connman);
+    // masternode-type messages are handled on the masternode message threads
+    if (CMasternodeMessageQueue::IsMasternodeMessage(msg_type)) {
+        masternodeMessageQueue.Push(&pfrom, msg_type, vRecv, &m_connman);
     }
 
     return;
@@ -4955,6 +4952,10 @@ bool PeerManagerImpl::ProcessMessages(CNode* pfrom, std::atomic<bool>& interrupt
     // Don't bother if send buffer is too full to respond anyway
     if (pfrom->fPauseSend) return false;
 
+    // Leave the messages unread until the masternode message workers caught up
+    // with the peer, the receive buffer filling up then stops reading its socket
+    if (masternodeMessageQueue.IsPeerFull(pfrom->GetId())) return false;
+
     std::list<CNetMessage> msgs;
     {
         LOCK(pfrom->cs_vProcessMsg);
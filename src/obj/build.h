@@ -0,0 +1 @@
+#define BUILD_GIT_COMMIT "a4a19f12be0a-dirty"
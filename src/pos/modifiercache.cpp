@@ -0,0 +1,98 @@
+// Copyright (c) 2022 The Myce Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <pos/modifiercache.h>
+
+#include <chain.h>
+
+#include <algorithm>
+
+bool CompareStakeModifierCandidate::operator()(const CBlockIndex* a, const CBlockIndex* b) const
+{
+    if (a->GetBlockTime() != b->GetBlockTime())
+        return a->GetBlockTime() < b->GetBlockTime();
+    // Timestamp equals - compare block hashes
+    const uint32_t *pa = a->phashBlock->GetDataPtr();
+    const uint32_t *pb = b->phashBlock->GetDataPtr();
+    int cnt = 256 / 32;
+    do {
+        --cnt;
+        if (pa[cnt] != pb[cnt])
+            return pa[cnt] < pb[cnt];
+    } while(cnt);
+    return false; // Elements are equal
+}
+
+const CBlockIndex* CStakeModifierCache::GetLastGenerated(const CBlockIndex* pindex)
+{
+    const CBlockIndex* pindexWalk = pindex;
+    while (pindexWalk != pindexLast && pindexWalk->pprev && !pindexWalk->GeneratedStakeModifier()) {
+        pindexWalk = pindexWalk->pprev;
+    }
+    if (pindexLast && pindexWalk == pindexLast) {
+        pindexWalk = pindexLastGenerated;
+    }
+
+    pindexLast = pindex;
+    pindexLastGenerated = pindexWalk;
+    return pindexWalk;
+}
+
+void CStakeModifierCache::UpdateWindow(const CBlockIndex* pindexPrev, int64_t nSelectionIntervalStart)
+{
+    // the window must be a segment of the chain ending in pindexPrev
+    if (!vWindow.empty() && (vWindow.back()->nHeight > pindexPrev->nHeight || pindexPrev->GetAncestor(vWindow.back()->nHeight) != vWindow.back())) {
+        vWindow.clear();
+        setSorted.clear();
+    }
+
+    // add the blocks connected since the last selection
+    if (vWindow.empty()) {
+        vWindow.push_back(pindexPrev);
+        setSorted.insert(pindexPrev);
+    } else {
+        const size_t nOldSize = vWindow.size();
+        for (const CBlockIndex* pindex = pindexPrev; pindex != vWindow[nOldSize - 1]; pindex = pindex->pprev) {
+            vWindow.push_back(pindex);
+            setSorted.insert(pindex);
+        }
+        std::reverse(vWindow.begin() + nOldSize, vWindow.end());
+    }
+
+    // the walk back from pindexPrev stops at the highest block older than the
+    // interval start; those sort first, so only the front of the set is scanned
+    int nHeightStop = -1;
+    for (const CBlockIndex* pindex : setSorted) {
+        if (pindex->GetBlockTime() >= nSelectionIntervalStart) {
+            break;
+        }
+        nHeightStop = std::max(nHeightStop, pindex->nHeight);
+    }
+
+    if (nHeightStop >= 0) {
+        while (!vWindow.empty() && vWindow.front()->nHeight <= nHeightStop) {
+            setSorted.erase(vWindow.front());
+            vWindow.pop_front();
+        }
+    } else {
+        // the walk continues below the current window
+        while (vWindow.front()->pprev && vWindow.front()->pprev->GetBlockTime() >= nSelectionIntervalStart) {
+            vWindow.push_front(vWindow.front()->pprev);
+            setSorted.insert(vWindow.front());
+        }
+    }
+}
+
+int CStakeModifierCache::GetFirstHeight(const CBlockIndex* pindexPrev) const
+{
+    return vWindow.empty() ? pindexPrev->nHeight + 1 : vWindow.front()->nHeight;
+}
+
+void CStakeModifierCache::Clear()
+{
+    vWindow.clear();
+    setSorted.clear();
+    pindexLast = nullptr;
+    pindexLastGenerated = nullptr;
+}
@@ -0,0 +1,60 @@
+// Copyright (c) 2022 The Myce Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef POS_MODIFIERCACHE_H
+#define POS_MODIFIERCACHE_H
+
+#include <cstdint>
+#include <deque>
+#include <set>
+
+class CBlockIndex;
+
+/** Selection order of stake modifier candidates: by timestamp, then by block hash. */
+struct CompareStakeModifierCandidate
+{
+    bool operator()(const CBlockIndex* a, const CBlockIndex* b) const;
+};
+
+/**
+ * State carried between consecutive ComputeNextStakeModifier calls.
+ *
+ * Remembers the last modifier generating block and the candidate window of
+ * the last modifier selection, sorted in selection order, so that extending
+ * the chain only touches the blocks that entered or left the window.
+ */
+class CStakeModifierCache
+{
+public:
+    typedef std::set<const CBlockIndex*, CompareStakeModifierCandidate> sorted_type;
+
+private:
+    //! candidate window as a contiguous chain segment, by ascending height
+    std::deque<const CBlockIndex*> vWindow;
+    //! the same candidates in selection order
+    sorted_type setSorted;
+
+    //! last block passed to GetLastGenerated and the result for it
+    const CBlockIndex* pindexLast{nullptr};
+    const CBlockIndex* pindexLastGenerated{nullptr};
+
+public:
+    /** Walk back from pindex to the last block that generated a modifier, stopping at genesis. */
+    const CBlockIndex* GetLastGenerated(const CBlockIndex* pindex);
+
+    /**
+     * Make the window hold the blocks a selection on top of pindexPrev walks
+     * back over: every block down to the first one older than nSelectionIntervalStart.
+     */
+    void UpdateWindow(const CBlockIndex* pindexPrev, int64_t nSelectionIntervalStart);
+
+    const sorted_type& GetSorted() const { return setSorted; }
+
+    /** Height of the lowest candidate, or pindexPrev's height + 1 if there is none. */
+    int GetFirstHeight(const CBlockIndex* pindexPrev) const;
+
+    void Clear();
+};
+
+#endif // POS_MODIFIERCACHE_H
@@ -0,0 +1,214 @@
+// Copyright (c) 2022 The Myce Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <pos/modifierindex.h>
+
+#include <chain.h>
+#include <logging.h>
+#include <pos/pos.h>
+#include <util/system.h>
+
+static constexpr uint8_t DB_KERNEL_MODIFIER{'k'};
+
+//! flush the catch-up batch once it grows beyond this size
+static constexpr size_t MAX_CATCHUP_BATCH_SIZE{16 << 20};
+
+std::unique_ptr<CStakeModifierIndex> g_stake_modifier_index;
+
+CStakeModifierDB::CStakeModifierDB(size_t nCacheSize, bool fMemory, bool fWipe)
+    : CDBWrapper(gArgs.GetDataDirNet() / "stakemodifiers", nCacheSize, fMemory, fWipe)
+{
+}
+
+bool CStakeModifierDB::ReadEntries(std::vector<std::pair<int, CKernelModifierEntry>>& vEntries)
+{
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    pcursor->Seek(std::make_pair(DB_KERNEL_MODIFIER, 0));
+
+    while (pcursor->Valid()) {
+        std::pair<uint8_t, int> key;
+        if (!pcursor->GetKey(key) || key.first != DB_KERNEL_MODIFIER) {
+            break;
+        }
+        CKernelModifierEntry entry;
+        if (!pcursor->GetValue(entry)) {
+            return error("%s: failed to read value", __func__);
+        }
+        vEntries.emplace_back(key.second, entry);
+        pcursor->Next();
+    }
+    return true;
+}
+
+CStakeModifierIndex::CStakeModifierIndex(size_t nCacheSize, bool fMemory, bool fWipe)
+    : db(std::make_unique<CStakeModifierDB>(nCacheSize, fMemory, fWipe))
+{
+}
+
+void CStakeModifierIndex::ConnectLocked(const CBlockIndex* pindex, CDBBatch& batch)
+{
+    const int nHeight = pindex->nHeight;
+
+    // a freshly generated modifier resolves every pending block whose
+    // selection interval has elapsed by the time of this block
+    if (pindex->GeneratedStakeModifier()) {
+        const int64_t nTime = pindex->GetBlockTime();
+        const auto itEnd = mapPending.upper_bound(nTime);
+        if (itEnd != mapPending.begin()) {
+            std::vector<int>& vResolved = mapResolvedBy[nHeight];
+            for (auto it = mapPending.begin(); it != itEnd; ++it) {
+                CKernelModifierEntry& entry = vEntries[it->second];
+                entry.hashBlockModifier = pindex->GetBlockHash();
+                entry.nModifierHeight = nHeight;
+                entry.nModifierTime = nTime;
+                entry.nStakeModifier = pindex->nStakeModifier;
+                batch.Write(std::make_pair(DB_KERNEL_MODIFIER, it->second), entry);
+                vResolved.push_back(it->second);
+            }
+            mapPending.erase(mapPending.begin(), itEnd);
+        }
+    }
+
+    CKernelModifierEntry entry;
+    entry.hashBlockFrom = pindex->GetBlockHash();
+    vEntries.push_back(entry);
+    mapPending.emplace(pindex->GetBlockTime() + nSelectionInterval, nHeight);
+}
+
+bool CStakeModifierIndex::Init(const CChain& chain)
+{
+    LOCK(cs);
+
+    nSelectionInterval = GetStakeModifierSelectionInterval();
+    vEntries.clear();
+    mapPending.clear();
+    mapResolvedBy.clear();
+
+    std::vector<std::pair<int, CKernelModifierEntry>> vStored;
+    if (!db->ReadEntries(vStored)) {
+        return error("%s: failed to read stake modifier index", __func__);
+    }
+
+    // keep only entries that still describe the active chain
+    const int nTipHeight = chain.Height();
+    std::vector<CKernelModifierEntry> vLoaded(nTipHeight + 1);
+    CDBBatch batch(*db);
+    for (const auto& [nHeight, entry] : vStored) {
+        const bool fValid = nHeight >= 0 && nHeight < entry.nModifierHeight && entry.nModifierHeight <= nTipHeight &&
+                            chain[nHeight]->GetBlockHash() == entry.hashBlockFrom &&
+                            chain[entry.nModifierHeight]->GetBlockHash() == entry.hashBlockModifier;
+        if (!fValid) {
+            batch.Erase(std::make_pair(DB_KERNEL_MODIFIER, nHeight));
+            continue;
+        }
+        vLoaded[nHeight] = entry;
+    }
+
+    int nStart = 0;
+    while (nStart <= nTipHeight && !vLoaded[nStart].IsNull()) {
+        ++nStart;
+    }
+    vEntries.reserve(vLoaded.size());
+    vEntries.assign(vLoaded.begin(), vLoaded.begin() + nStart);
+    for (int nHeight = 0; nHeight < nStart; ++nHeight) {
+        mapResolvedBy[vEntries[nHeight].nModifierHeight].push_back(nHeight);
+    }
+
+    // replay the remainder of the chain to resolve whatever is missing
+    for (int nHeight = nStart; nHeight <= nTipHeight; ++nHeight) {
+        const CBlockIndex* pindex = chain[nHeight];
+        ConnectLocked(pindex, batch);
+        if (!vLoaded[nHeight].IsNull()) {
+            auto range = mapPending.equal_range(pindex->GetBlockTime() + nSelectionInterval);
+            for (auto it = range.first; it != range.second; ++it) {
+                if (it->second == nHeight) {
+                    mapPending.erase(it);
+                    break;
+                }
+            }
+            vEntries[nHeight] = vLoaded[nHeight];
+            mapResolvedBy[vLoaded[nHeight].nModifierHeight].push_back(nHeight);
+        }
+        if (batch.SizeEstimate() > MAX_CATCHUP_BATCH_SIZE) {
+            if (!db->WriteBatch(batch)) {
+                return error("%s: failed to write stake modifier index", __func__);
+            }
+            batch.Clear();
+        }
+    }
+    if (!db->WriteBatch(batch, true)) {
+        return error("%s: failed to write stake modifier index", __func__);
+    }
+
+    LogPrint(BCLog::POS, "%s: loaded %u stake modifier entries, replayed from height %d, %u pending\n", __func__, vStored.size(), nStart, mapPending.size());
+    return true;
+}
+
+void CStakeModifierIndex::BlockConnected(const CBlockIndex* pindex)
+{
+    LOCK(cs);
+    if (pindex->nHeight != (int)vEntries.size()) {
+        LogPrintf("%s: block %s at height %d does not extend the index (size %u)\n", __func__, pindex->GetBlockHash().ToString(), pindex->nHeight, vEntries.size());
+        return;
+    }
+
+    CDBBatch batch(*db);
+    ConnectLocked(pindex, batch);
+    db->WriteBatch(batch);
+}
+
+void CStakeModifierIndex::BlockDisconnected(const CBlockIndex* pindex)
+{
+    LOCK(cs);
+    const int nHeight = pindex->nHeight;
+    if (nHeight + 1 != (int)vEntries.size() || vEntries.back().hashBlockFrom != pindex->GetBlockHash()) {
+        LogPrintf("%s: block %s at height %d is not the index tip\n", __func__, pindex->GetBlockHash().ToString(), nHeight);
+        return;
+    }
+
+    CDBBatch batch(*db);
+
+    // the tip itself can only be pending
+    auto range = mapPending.equal_range(pindex->GetBlockTime() + nSelectionInterval);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second == nHeight) {
+            mapPending.erase(it);
+            break;
+        }
+    }
+    vEntries.pop_back();
+
+    // everything this block resolved goes back to pending
+    auto it = mapResolvedBy.find(nHeight);
+    if (it != mapResolvedBy.end()) {
+        for (const int nHeightFrom : it->second) {
+            CKernelModifierEntry& entry = vEntries[nHeightFrom];
+            entry = CKernelModifierEntry();
+            entry.hashBlockFrom = pindex->GetAncestor(nHeightFrom)->GetBlockHash();
+            mapPending.emplace(pindex->GetAncestor(nHeightFrom)->GetBlockTime() + nSelectionInterval, nHeightFrom);
+            batch.Erase(std::make_pair(DB_KERNEL_MODIFIER, nHeightFrom));
+        }
+        mapResolvedBy.erase(it);
+    }
+
+    db->WriteBatch(batch);
+}
+
+bool CStakeModifierIndex::Lookup(const CBlockIndex* pindexFrom, uint64_t& nStakeModifier, int& nStakeModifierHeight, int64_t& nStakeModifierTime) const
+{
+    LOCK(cs);
+    if (!pindexFrom || pindexFrom->nHeight < 0 || pindexFrom->nHeight >= (int)vEntries.size()) {
+        return false;
+    }
+
+    const CKernelModifierEntry& entry = vEntries[pindexFrom->nHeight];
+    if (entry.IsNull() || entry.hashBlockFrom != pindexFrom->GetBlockHash()) {
+        return false;
+    }
+
+    nStakeModifier = entry.nStakeModifier;
+    nStakeModifierHeight = entry.nModifierHeight;
+    nStakeModifierTime = entry.nModifierTime;
+    return true;
+}
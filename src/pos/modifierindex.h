@@ -0,0 +1,92 @@
+// Copyright (c) 2022 The Myce Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef POS_MODIFIERINDEX_H
+#define POS_MODIFIERINDEX_H
+
+#include <dbwrapper.h>
+#include <serialize.h>
+#include <sync.h>
+#include <uint256.h>
+
+#include <map>
+#include <memory>
+#include <vector>
+
+class CBlockIndex;
+class CChain;
+
+/**
+ * Kernel stake modifier in effect for coins confirmed in a given block of the
+ * active chain, i.e. the result GetKernelStakeModifier() would compute by
+ * walking forward from that block.
+ */
+struct CKernelModifierEntry
+{
+    uint256 hashBlockFrom{};
+    uint256 hashBlockModifier{};
+    int nModifierHeight{-1};
+    int64_t nModifierTime{0};
+    uint64_t nStakeModifier{0};
+
+    bool IsNull() const { return hashBlockModifier.IsNull(); }
+
+    SERIALIZE_METHODS(CKernelModifierEntry, obj)
+    {
+        READWRITE(obj.hashBlockFrom, obj.hashBlockModifier, obj.nModifierHeight, obj.nModifierTime, obj.nStakeModifier);
+    }
+};
+
+class CStakeModifierDB : public CDBWrapper
+{
+public:
+    CStakeModifierDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+
+private:
+    CStakeModifierDB(const CStakeModifierDB&);
+    void operator=(const CStakeModifierDB&);
+
+public:
+    bool ReadEntries(std::vector<std::pair<int, CKernelModifierEntry>>& vEntries);
+};
+
+/**
+ * Height-indexed cache of kernel stake modifiers for the active chain.
+ *
+ * An entry for height h is resolved by the first block after h that generated
+ * a stake modifier at least one selection interval after block h. Entries are
+ * resolved as blocks are connected to the tip and reverted as they are
+ * disconnected, so lookups never need to walk the chain.
+ */
+class CStakeModifierIndex
+{
+private:
+    mutable Mutex cs;
+    std::unique_ptr<CStakeModifierDB> db;
+    int64_t nSelectionInterval{0};
+
+    //! resolved (or null) entries by height, sized to the tip height + 1
+    std::vector<CKernelModifierEntry> vEntries GUARDED_BY(cs);
+    //! unresolved heights keyed by the earliest modifier time able to resolve them
+    std::multimap<int64_t, int> mapPending GUARDED_BY(cs);
+    //! heights resolved by each modifier generating block, to revert on disconnect
+    std::map<int, std::vector<int>> mapResolvedBy GUARDED_BY(cs);
+
+    void ConnectLocked(const CBlockIndex* pindex, CDBBatch& batch) EXCLUSIVE_LOCKS_REQUIRED(cs);
+
+public:
+    CStakeModifierIndex(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+
+    /** Load persisted entries, drop those not on the active chain and catch up to the tip. */
+    bool Init(const CChain& chain);
+
+    void BlockConnected(const CBlockIndex* pindex);
+    void BlockDisconnected(const CBlockIndex* pindex);
+
+    bool Lookup(const CBlockIndex* pindexFrom, uint64_t& nStakeModifier, int& nStakeModifierHeight, int64_t& nStakeModifierTime) const;
+};
+
+extern std::unique_ptr<CStakeModifierIndex> g_stake_modifier_index;
+
+#endif // POS_MODIFIERINDEX_H
@@ -7,20 +7,24 @@
 #include <index/disktxpos.h>
 #include <index/txindex.h>
 #include <node/transaction.h>
+#include <pos/modifiercache.h>
+#include <pos/modifierindex.h>
 #include <pos/stakeinput.h>
+#include <pos/stakemetrics.h>
+#include <pos/stakesearch.h>
+#include <pos/util.h>
 #include <timedata.h>
+#include <undo.h>
 #include <util/system.h>
 #include <validation.h>
 
-static bool GetLastStakeModifier(const CBlockIndex* pindex, uint64_t& nStakeModifier, int64_t& nModifierTime)
+static bool GetLastStakeModifier(CStakeModifierCache& cache, const CBlockIndex* pindex, uint64_t& nStakeModifier, int64_t& nModifierTime)
 {
     if (!pindex) {
         LogPrint(BCLog::POS, "%s: null pindex", __func__);
         return false;
     }
-    while (pindex && pindex->pprev && !pindex->GeneratedStakeModifier()) {
-        pindex = pindex->pprev;
-    }
+    pindex = cache.GetLastGenerated(pindex);
     if (!pindex->GeneratedStakeModifier()) {
         LogPrint(BCLog::POS, "%s: no generation at genesis block", __func__);
         return false;
@@ -36,7 +40,7 @@ static int64_t GetStakeModifierSelectionIntervalSection(int nSection)
     return (int64_t) (Params().GetConsensus().nModifierInterval * 63 / (63 + ((63 - nSection) * (MODIFIER_INTERVAL_RATIO - 1))));
 }
 
-static int64_t GetStakeModifierSelectionInterval()
+int64_t GetStakeModifierSelectionInterval()
 {
     int64_t nSelectionInterval = 0;
     for (int nSection = 0; nSection < 64; nSection++)
@@ -44,61 +48,30 @@ static int64_t GetStakeModifierSelectionInterval()
     return nSelectionInterval;
 }
 
-static bool SelectBlockFromCandidates(
-    std::vector<std::pair<int64_t, uint256> >& vSortedByTimestamp,
-    std::map<uint256, const CBlockIndex*>& mapSelectedBlocks,
-    int64_t nSelectionIntervalStop, uint64_t nStakeModifierPrev,
-    const CBlockIndex** pindexSelected,
-    const Consensus::Params& params,
-    Chainstate& chainstate)
+static int SelectBlockFromCandidates(
+    const std::vector<const CBlockIndex*>& vSortedByTimestamp,
+    const std::vector<arith_uint256>& vHashSelection,
+    const std::vector<bool>& vSelected,
+    int64_t nSelectionIntervalStop)
 {
-    bool fModifierV2 = false;
-    bool fFirstRun = true;
     bool fSelected = false;
     arith_uint256 hashBest = arith_uint256();
-    *pindexSelected = nullptr;
-    for (const auto& item : vSortedByTimestamp) {
-        const CBlockIndex* pindex = chainstate.m_blockman.LookupBlockIndex(item.second);
-        if (!pindex) {
-            LogPrint(BCLog::POS, "%s: failed to find block index for candidate block %s\n", __func__, item.second.ToString());
-            return false;
-        }
-        if (fSelected && pindex->GetBlockTime() > nSelectionIntervalStop) {
+    int nSelectedIndex = -1;
+    for (size_t i = 0; i < vSortedByTimestamp.size(); i++) {
+        if (fSelected && vSortedByTimestamp[i]->GetBlockTime() > nSelectionIntervalStop) {
             break;
         }
-        if (fFirstRun) {
-            fModifierV2 = pindex->nHeight >= params.nModifierUpgrade;
-            fFirstRun = false;
-        }
-        if (mapSelectedBlocks.count(pindex->GetBlockHash()) > 0) {
+        if (vSelected[i]) {
             continue;
         }
-        uint256 hashProof;
-        if (fModifierV2)
-            hashProof = pindex->GetBlockHash();
-        else
-            hashProof = pindex->IsProofOfStake() ? uint256() : pindex->GetBlockHash();
-
-        // compute the selection hash by hashing its proof-hash and the
-        // previous proof-of-stake modifier
-        CDataStream ss(SER_GETHASH, 0);
-        ss << hashProof << nStakeModifierPrev;
-        arith_uint256 hashSelection = UintToArith256(Hash(ss));
-
-        // the selection hash is divided by 2**32 so that proof-of-stake block
-        // is always favored over proof-of-work block. this is to preserve
-        // the energy efficiency property
-        if (pindex->IsProofOfStake()) {
-            hashSelection >>= 32;
-        }
 
-        if (fSelected && hashSelection < hashBest) {
-            hashBest = hashSelection;
-            *pindexSelected = (const CBlockIndex*)pindex;
+        if (fSelected && vHashSelection[i] < hashBest) {
+            hashBest = vHashSelection[i];
+            nSelectedIndex = i;
         } else if (!fSelected) {
             fSelected = true;
-            hashBest = hashSelection;
-            *pindexSelected = (const CBlockIndex*)pindex;
+            hashBest = vHashSelection[i];
+            nSelectedIndex = i;
         }
     }
 
@@ -106,10 +79,15 @@ static bool SelectBlockFromCandidates(
         LogPrint(BCLog::POS, "%s: selection hash=%s\n", __func__, hashBest.ToString());
     }
 
-    return fSelected;
+    return nSelectedIndex;
 }
 
 bool ComputeNextStakeModifier(Chainstate& chainstate, const CBlockIndex* pindexCurrent, uint64_t& nStakeModifier, bool& fGeneratedStakeModifier)
+{
+    return ComputeNextStakeModifier(chainstate.m_stake_modifier_cache, pindexCurrent, nStakeModifier, fGeneratedStakeModifier);
+}
+
+bool ComputeNextStakeModifier(CStakeModifierCache& cache, const CBlockIndex* pindexCurrent, uint64_t& nStakeModifier, bool& fGeneratedStakeModifier)
 {
     const Consensus::Params& params = Params().GetConsensus();
     const CBlockIndex* pindexPrev = pindexCurrent->pprev;
@@ -129,7 +107,7 @@ bool ComputeNextStakeModifier(Chainstate& chainstate, const CBlockIndex* pindexC
     // First find current stake modifier and its generation block time
     // if it's not old enough, return the same stake modifier
     int64_t nModifierTime = 0;
-    if (!GetLastStakeModifier(pindexPrev, nStakeModifier, nModifierTime)) {
+    if (!GetLastStakeModifier(cache, pindexPrev, nStakeModifier, nModifierTime)) {
         LogPrint(BCLog::POS, "%s: unable to get last modifier", __func__);
         return false;
     }
@@ -140,55 +118,60 @@ bool ComputeNextStakeModifier(Chainstate& chainstate, const CBlockIndex* pindexC
         return true;
     }
 
-    // Sort candidate blocks by timestamp
-    std::vector<std::pair<int64_t, uint256>> vSortedByTimestamp;
-    vSortedByTimestamp.reserve(64 * params.nModifierInterval / ((pindexPrev->nHeight + 1 >= params.nModifierUpgrade) ? (int) params.nPowTargetSpacing : 60));
+    // Candidate blocks sorted by timestamp, carried over from the previous selection
     int64_t nSelectionInterval = GetStakeModifierSelectionInterval();
     int64_t nSelectionIntervalStart = (pindexPrev->GetBlockTime() / params.nModifierInterval) * params.nModifierInterval - nSelectionInterval;
-    const CBlockIndex* pindex = pindexPrev;
+    cache.UpdateWindow(pindexPrev, nSelectionIntervalStart);
+    const std::vector<const CBlockIndex*> vSortedByTimestamp(cache.GetSorted().begin(), cache.GetSorted().end());
+    int nHeightFirstCandidate = cache.GetFirstHeight(pindexPrev);
+
+    // The selection hash of a candidate only depends on the previous modifier,
+    // so compute it once for all rounds
+    std::vector<arith_uint256> vHashSelection;
+    vHashSelection.reserve(vSortedByTimestamp.size());
+    const bool fModifierV2 = !vSortedByTimestamp.empty() && vSortedByTimestamp.front()->nHeight >= params.nModifierUpgrade;
+    for (const CBlockIndex* pindex : vSortedByTimestamp) {
+        uint256 hashProof;
+        if (fModifierV2)
+            hashProof = pindex->GetBlockHash();
+        else
+            hashProof = pindex->IsProofOfStake() ? uint256() : pindex->GetBlockHash();
+
+        // compute the selection hash by hashing its proof-hash and the
+        // previous proof-of-stake modifier
+        CDataStream ss(SER_GETHASH, 0);
+        ss << hashProof << nStakeModifier;
+        arith_uint256 hashSelection = UintToArith256(Hash(ss));
 
-    while (pindex && pindex->GetBlockTime() >= nSelectionIntervalStart) {
-        vSortedByTimestamp.push_back(std::make_pair(pindex->GetBlockTime(), pindex->GetBlockHash()));
-        pindex = pindex->pprev;
+        // the selection hash is divided by 2**32 so that proof-of-stake block
+        // is always favored over proof-of-work block. this is to preserve
+        // the energy efficiency property
+        if (pindex->IsProofOfStake()) {
+            hashSelection >>= 32;
+        }
+        vHashSelection.push_back(hashSelection);
     }
-    int nHeightFirstCandidate = pindex ? (pindex->nHeight + 1) : 0;
-
-    // Shuffle before sort
-    for(int i = vSortedByTimestamp.size() - 1; i > 1; --i)
-    std::swap(vSortedByTimestamp[i], vSortedByTimestamp[GetRand(i)]);
-
-    std::sort(vSortedByTimestamp.begin(), vSortedByTimestamp.end(), [] (const std::pair<int64_t, uint256> &a, const std::pair<int64_t, uint256> &b)
-    {
-        if (a.first != b.first)
-            return a.first < b.first;
-        // Timestamp equals - compare block hashes
-        const uint32_t *pa = a.second.GetDataPtr();
-        const uint32_t *pb = b.second.GetDataPtr();
-        int cnt = 256 / 32;
-        do {
-            --cnt;
-            if (pa[cnt] != pb[cnt])
-                return pa[cnt] < pb[cnt];
-        } while(cnt);
-            return false; // Elements are equal
-    });
 
     // Select 64 blocks from candidate blocks to generate stake modifier
     uint64_t nStakeModifierNew = 0;
     int64_t nSelectionIntervalStop = nSelectionIntervalStart;
-    std::map<uint256, const CBlockIndex*> mapSelectedBlocks;
+    std::vector<bool> vSelected(vSortedByTimestamp.size(), false);
+    std::vector<const CBlockIndex*> vSelectedBlocks;
     for (int nRound = 0; nRound < std::min(64, (int)vSortedByTimestamp.size()); nRound++) {
         // add an interval section to the current selection round
         nSelectionIntervalStop += GetStakeModifierSelectionIntervalSection(nRound);
         // select a block from the candidates of current round
-        if (!SelectBlockFromCandidates(vSortedByTimestamp, mapSelectedBlocks, nSelectionIntervalStop, nStakeModifier, &pindex, params, chainstate)) {
+        int nSelectedIndex = SelectBlockFromCandidates(vSortedByTimestamp, vHashSelection, vSelected, nSelectionIntervalStop);
+        if (nSelectedIndex < 0) {
             LogPrint(BCLog::POS, "%s: unable to select block at round %d\n", __func__, nRound);
             return false;
         }
+        const CBlockIndex* pindex = vSortedByTimestamp[nSelectedIndex];
         // write the entropy bit of the selected block
         nStakeModifierNew |= (((uint64_t)pindex->GetStakeEntropyBit()) << nRound);
         // add the selected block from candidates to selected list
-        mapSelectedBlocks.insert(std::make_pair(pindex->GetBlockHash(), pindex));
+        vSelected[nSelectedIndex] = true;
+        vSelectedBlocks.push_back(pindex);
         if (gArgs.GetBoolArg("-printstakemodifier", DEFAULT_PRINTSTAKEMODIFIER)) {
             LogPrint(BCLog::POS, "%s: selected round %d stop=%s height=%d bit=%d\n", __func__, nRound, FormatISO8601DateTime(nSelectionIntervalStop), pindex->nHeight, pindex->GetStakeEntropyBit());
         }
@@ -199,17 +182,17 @@ bool ComputeNextStakeModifier(Chainstate& chainstate, const CBlockIndex* pindexC
         std::string strSelectionMap = "";
         // '-' indicates proof-of-work blocks not selected
         strSelectionMap.insert(0, pindexPrev->nHeight - nHeightFirstCandidate + 1, '-');
-        pindex = pindexPrev;
+        const CBlockIndex* pindex = pindexPrev;
         while (pindex && pindex->nHeight >= nHeightFirstCandidate) {
             // '=' indicates proof-of-stake blocks not selected
             if (pindex->IsProofOfStake())
                 strSelectionMap.replace(pindex->nHeight - nHeightFirstCandidate, 1, "=");
             pindex = pindex->pprev;
         }
-        for (const auto& item : mapSelectedBlocks) {
+        for (const CBlockIndex* pindexSelected : vSelectedBlocks) {
             // 'S' indicates selected proof-of-stake blocks
             // 'W' indicates selected proof-of-work blocks
-            strSelectionMap.replace(item.second->nHeight - nHeightFirstCandidate, 1, item.second->IsProofOfStake() ? "S" : "W");
+            strSelectionMap.replace(pindexSelected->nHeight - nHeightFirstCandidate, 1, pindexSelected->IsProofOfStake() ? "S" : "W");
         }
         LogPrintf("%s: selection height [%d, %d] map %s\n", __func__, nHeightFirstCandidate, pindexPrev->nHeight, strSelectionMap);
     }
@@ -231,6 +214,12 @@ bool GetKernelStakeModifier(Chainstate& chainstate, CBlockIndex* pindexPrev, uin
         return false;
     }
 
+    const bool fIndexHit = g_stake_modifier_index && g_stake_modifier_index->Lookup(pindexFrom, nStakeModifier, nStakeModifierHeight, nStakeModifierTime);
+    g_staking_metrics.AddModifierLookup(fIndexHit);
+    if (fIndexHit) {
+        return true;
+    }
+
     nStakeModifierHeight = pindexFrom->nHeight;
     nStakeModifierTime = pindexFrom->GetBlockTime();
     int64_t nStakeModifierSelectionInterval = GetStakeModifierSelectionInterval();
@@ -273,7 +262,8 @@ bool checkStake(const CDataStream& ssUniqueID, CAmount nValueIn, const uint64_t
     CDataStream ss(SER_GETHASH, 0);
     ss << nStakeModifier << nTimeBlockFrom << ssUniqueID << nTimeTx;
     hashProofOfStake = Hash(ss);
-    LogPrintf("%s: modifier:%d nTimeBlockFrom:%d nTimeTx:%d hash:%s\n", __func__, nStakeModifier, nTimeBlockFrom, nTimeTx, hashProofOfStake.ToString());
+    g_staking_metrics.AddKernelHashes(1);
+    LogPrint(BCLog::POS, "%s: modifier:%d nTimeBlockFrom:%d nTimeTx:%d hash:%s\n", __func__, nStakeModifier, nTimeBlockFrom, nTimeTx, hashProofOfStake.ToString());
     return stakeTargetHit(hashProofOfStake, nValueIn, bnTarget);
 }
 
@@ -301,30 +291,141 @@ bool buildStake(CStakeInput* stakeInput, unsigned int nBits, unsigned int nTimeB
         return error("failed to get kernel stake modifier");
     }
 
-    bool fSuccess = false;
-    unsigned int nTryTime = 0;
-    const int nHashDrift = 60;
-    CDataStream ssUniqueID = stakeInput->GetUniqueness();
-    CAmount nValueIn = stakeInput->GetValue();
-    for (int i = 0; i < nHashDrift; i++)
-    {
-        nTryTime = nTimeTx + nHashDrift - i;
-        if (!checkStake(ssUniqueID, nValueIn, nStakeModifier, bnTargetPerCoinDay, nTimeBlockFrom, nTryTime, hashProofOfStake)) {
-            continue;
+    const int64_t nTimeStart = GetTimeMicros();
+    const unsigned int nTimeFirst = nTimeTx + STAKE_HASH_DRIFT;
+    const CStakeKernel kernel(nStakeModifier, nTimeBlockFrom, stakeInput->GetUniqueness(), stakeInput->GetValue());
+    const bool fHit = kernel.CheckWindow(kernel.GetTargetWeight(bnTargetPerCoinDay), nTimeFirst, STAKE_HASH_DRIFT, nTimeTx, hashProofOfStake);
+    g_staking_metrics.AddSearchRound(fHit ? nTimeFirst - nTimeTx + 1 : STAKE_HASH_DRIFT, GetTimeMicros() - nTimeStart);
+    return fHit;
+}
+
+static bool CheckStakeVersion(const CBlock& block, Chainstate& chainstate) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    const Consensus::Params& params = Params().GetConsensus();
+    if (block.nVersion < params.nWalletVersion && chainstate.m_chain.Height() + 1 >= params.nWalletUpgrade)
+        return false;
+    else if (block.nVersion >= params.nWalletVersion && chainstate.m_chain.Height() + 1 < params.nWalletUpgrade)
+        return false;
+    return true;
+}
+
+/**
+ * Find a coin that a block of the active chain above the fork with pindexPrev
+ * spent, in the undo data of that block. For the competing branch the coin is
+ * still unspent. Forks deeper than pruning keeps undo data for are not searched.
+ */
+static bool FindCoinSpentAfterFork(const COutPoint& prevout, const CBlockIndex* pindexPrev, Chainstate& chainstate, Coin& coin) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    const CBlockIndex* pindexFork = chainstate.m_chain.FindFork(pindexPrev);
+    if (!pindexFork || chainstate.m_chain.Height() - pindexFork->nHeight > (int)MIN_BLOCKS_TO_KEEP)
+        return false;
+
+    for (const CBlockIndex* pindex = chainstate.m_chain.Tip(); pindex != pindexFork; pindex = pindex->pprev) {
+        if (!(pindex->nStatus & BLOCK_HAVE_DATA) || !(pindex->nStatus & BLOCK_HAVE_UNDO))
+            return false;
+
+        CBlock blockSpent;
+        CBlockUndo blockUndo;
+        if (!node::ReadBlockFromDisk(blockSpent, pindex, Params().GetConsensus()) || !node::UndoReadFromDisk(blockUndo, pindex))
+            return false;
+        if (blockUndo.vtxundo.size() + 1 != blockSpent.vtx.size())
+            return false;
+
+        // the coinbase has no undo entry
+        for (size_t i = 1; i < blockSpent.vtx.size(); i++) {
+            const std::vector<CTxIn>& vin = blockSpent.vtx[i]->vin;
+            for (size_t j = 0; j < vin.size(); j++) {
+                if (vin[j].prevout == prevout && j < blockUndo.vtxundo[i - 1].vprevout.size()) {
+                    coin = blockUndo.vtxundo[i - 1].vprevout[j];
+                    return true;
+                }
+            }
         }
+    }
+
+    return false;
+}
 
-        fSuccess = true;
-        nTimeTx = nTryTime;
-        break;
+/** Look up the kernel of a coinstake and its stake modifier. Reads the UTXO set, the undo data or the tx index, and the modifier index. */
+static bool LoadStakeKernel(const CBlock& block, std::unique_ptr<CStakeInput>& stake, Chainstate& chainstate,
+                            const CBlockIndex*& pindexFrom, uint64_t& nStakeModifier, BlockValidationState& state)
+{
+    const CTransactionRef& tx = block.vtx[1];
+    const CTxIn& txin = tx->vin[0];
+
+    // Recreate stake object, preferably from the UTXO set so that neither the
+    // tx index nor the block files are touched
+    CMyceStake* myceInput = new CMyceStake();
+    stake = std::unique_ptr<CStakeInput>(myceInput);
+
+    // A kernel already spent on the active chain happens for blocks of a
+    // competing fork, the undo data of the blocks above the fork still has it
+    Coin coin;
+    const bool fCoin = WITH_LOCK(cs_main, {
+        if (chainstate.CoinsTip().GetCoin(txin.prevout, coin))
+            return true;
+        const CBlockIndex* pindexPrev = chainstate.m_blockman.LookupBlockIndex(block.hashPrevBlock);
+        return pindexPrev && FindCoinSpentAfterFork(txin.prevout, pindexPrev, chainstate, coin);
+    });
+    if (fCoin) {
+        if (!myceInput->SetInput(txin.prevout, coin, chainstate)) {
+            return error("CheckProofOfStake() : kernel %s not from a block of the active chain", txin.prevout.ToString());
+        }
+    } else {
+        // spent below the fork, or the undo data is gone, only the tx index can tell
+        if (!g_txindex) {
+            state.Error("kernel-spent");
+            return error("CheckProofOfStake() : kernel %s spent and tx index disabled", txin.prevout.ToString());
+        }
+        uint256 blockhash{};
+        CTransactionRef txPrev;
+        g_staking_metrics.AddTxIndexRead();
+        if (!g_txindex->FindTx(txin.prevout.hash, blockhash, txPrev)) {
+            return error("CheckProofOfStake() : tx index not found");  // tx index not found
+        }
+        if (!myceInput->SetInput(txPrev, txin.prevout.n)) {
+            return error("CheckProofOfStake() : kernel %s out of range", txin.prevout.ToString());
+        }
+    }
+
+    // Retrieve header via blockindex
+    CBlockIndex* pindex = stake->GetIndexFrom(chainstate);
+    if (!pindex) {
+        return error("%s: Failed to find the block index", __func__);
     }
 
-    return fSuccess;
+    if (!WITH_LOCK(cs_main, return CheckStakeVersion(block, chainstate)))
+        return false;
+
+    nStakeModifier = 0;
+    if (!WITH_LOCK(cs_main, return stake->GetModifier(nStakeModifier, chainstate)))
+        return error("%s failed to get modifier for stake input\n", __func__);
+    pindexFrom = pindex;
+
+    return true;
 }
 
-bool CheckProofOfStake(const CBlock& block, uint256& hashProofOfStake, std::unique_ptr<CStakeInput>& stake, Chainstate& chainstate)
+/** Hash a kernel found by LoadStakeKernel against the block target. Touches neither the chain nor the disk. */
+static bool CheckStakeKernelHash(const CBlock& block, CStakeInput& stake, const CBlockIndex* pindexFrom, uint64_t nStakeModifier, uint256& hashProofOfStake)
 {
     const Consensus::Params& params = Params().GetConsensus();
+    const CTransactionRef& tx = block.vtx[1];
 
+    arith_uint256 bnTargetPerCoinDay;
+    bnTargetPerCoinDay.SetCompact(block.nBits);
+
+    unsigned int nTxTime = block.nTime;
+    unsigned int nBlockFromTime = pindexFrom->nTime;
+
+    if (block.nVersion >= params.nWalletVersion && !checkStake(stake.GetUniqueness(), stake.GetValue(), nStakeModifier, bnTargetPerCoinDay, nBlockFromTime, nTxTime, hashProofOfStake)) {
+        return error("CheckProofOfStake() : INFO: check kernel failed on coinstake %s, hashProof=%s\n", tx->GetHash().ToString(), hashProofOfStake.ToString());
+    }
+
+    return true;
+}
+
+bool CheckProofOfStake(const CBlock& block, uint256& hashProofOfStake, std::unique_ptr<CStakeInput>& stake, Chainstate& chainstate, BlockValidationState& state)
+{
     const CTransactionRef& tx = block.vtx[1];
     if (!tx->IsCoinStake()) {
         return error("CheckProofOfStake() : called on non-coinstake %s", tx->GetHash().ToString());
@@ -334,46 +435,66 @@ bool CheckProofOfStake(const CBlock& block, uint256& hashProofOfStake, std::uniq
         return true;
     }
 
-    const CTxIn& txin = tx->vin[0];
+    const int64_t nTimeStart = GetTimeMicros();
+    const CBlockIndex* pindexFrom = nullptr;
+    uint64_t nStakeModifier = 0;
+    const bool fValid = LoadStakeKernel(block, stake, chainstate, pindexFrom, nStakeModifier, state) &&
+                        CheckStakeKernelHash(block, *stake, pindexFrom, nStakeModifier, hashProofOfStake);
+    g_staking_metrics.AddCheckProofOfStake(GetTimeMicros() - nTimeStart);
+    return fValid;
+}
 
-    // Get transaction index for the previous transaction
-    uint256 blockhash{};
-    CTransactionRef txPrev;
-    if (!g_txindex->FindTx(txin.prevout.hash, blockhash, txPrev)) {
-        return error("CheckProofOfStake() : tx index not found");  // tx index not found
+void PreValidateProofOfStake(const CBlock& block, CStakePreValidation& result, Chainstate& chainstate)
+{
+    AssertLockNotHeld(cs_main);
+
+    if (!block.IsProofOfStake()) {
+        return;
     }
 
-    // Recreate stake object
-    CMyceStake* myceInput = new CMyceStake();
-    myceInput->SetInput(txPrev, txin.prevout.n);
-    stake = std::unique_ptr<CStakeInput>(myceInput);
+    // the block signature does not depend on the chain at all
+    result.fSignatureChecked = CheckBlockSignature(block);
 
-    // Retrieve header via blockindex
-    CBlockIndex* pindex = stake->GetIndexFrom(chainstate);
-    if (!pindex) {
-        return error("%s: Failed to find the block index", __func__);
+    if (node::fImporting || node::fReindex) {
+        return;
     }
 
-    CBlockHeader blockPrev = pindex->GetBlockHeader();
+    const int64_t nTimeStart = GetTimeMicros();
+    std::unique_ptr<CStakeInput> stake;
+    BlockValidationState state;
+    uint256 hashProofOfStake;
+    result.fKernelChecked = LoadStakeKernel(block, stake, chainstate, result.pindexFrom, result.nStakeModifier, state) &&
+                            CheckStakeKernelHash(block, *stake, result.pindexFrom, result.nStakeModifier, hashProofOfStake);
+    result.nCheckTime = GetTimeMicros() - nTimeStart;
+}
 
-    if (block.nVersion < params.nWalletVersion && chainstate.m_chain.Height() + 1 >= params.nWalletUpgrade)
-        return false;
-    else if (block.nVersion >= params.nWalletVersion && chainstate.m_chain.Height() + 1 < params.nWalletUpgrade)
+bool ConfirmProofOfStake(const CBlock& block, const CStakePreValidation& result, Chainstate& chainstate)
+{
+    AssertLockHeld(cs_main);
+
+    if (!result.fKernelChecked) {
         return false;
+    }
 
-    arith_uint256 bnTargetPerCoinDay;
-    bnTargetPerCoinDay.SetCompact(block.nBits);
+    // The kernel was checked against the chain as it was before cs_main was
+    // taken. It still holds as long as the origin block is on the active
+    // chain and the modifier selected for it did not change.
+    if (!chainstate.m_chain.Contains(result.pindexFrom) || !CheckStakeVersion(block, chainstate)) {
+        return false;
+    }
 
     uint64_t nStakeModifier = 0;
-    if (!stake->GetModifier(nStakeModifier, chainstate))
-        return error("%s failed to get modifier for stake input\n", __func__);
-
-    unsigned int nTxTime = block.nTime;
-    unsigned int nBlockFromTime = blockPrev.nTime;
-
-    if (block.nVersion >= params.nWalletVersion && !checkStake(stake->GetUniqueness(), stake->GetValue(), nStakeModifier, bnTargetPerCoinDay, nBlockFromTime, nTxTime, hashProofOfStake)) {
-        return error("CheckProofOfStake() : INFO: check kernel failed on coinstake %s, hashProof=%s\n", tx->GetHash().ToString(), hashProofOfStake.ToString());
+    int nStakeModifierHeight = 0;
+    int64_t nStakeModifierTime = 0;
+    CBlockIndex* pindexFrom = chainstate.m_chain[result.pindexFrom->nHeight];
+    if (!GetKernelStakeModifier(chainstate, pindexFrom, pindexFrom->GetBlockHash(), nStakeModifier, nStakeModifierHeight, nStakeModifierTime, false)) {
+        return false;
+    }
+    if (nStakeModifier != result.nStakeModifier) {
+        return false;
     }
 
+    // counted once the check is used, otherwise CheckProofOfStake redoes and counts it
+    g_staking_metrics.AddCheckProofOfStake(result.nCheckTime);
     return true;
 }
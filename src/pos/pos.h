@@ -10,17 +10,50 @@
 
 static const int MODIFIER_INTERVAL_RATIO = 3;
 
+//! number of timestamps tried per kernel when searching for a stake
+static const int STAKE_HASH_DRIFT = 60;
+
 class CStakeInput;
+class CStakeModifierCache;
 
 // Logging defaults
 static const bool DEFAULT_PRINTSTAKEMODIFIER = false;
 static const bool DEFAULT_PRINTHASHPROOF = false;
 static const bool DEFAULT_PRINTCOINAGE = false;
 
-bool ComputeNextStakeModifier(Chainstate& chainstate, const CBlockIndex* pindexCurrent, uint64_t& nStakeModifier, bool& fGeneratedStakeModifier);
+int64_t GetStakeModifierSelectionInterval();
+bool ComputeNextStakeModifier(Chainstate& chainstate, const CBlockIndex* pindexCurrent, uint64_t& nStakeModifier, bool& fGeneratedStakeModifier) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+bool ComputeNextStakeModifier(CStakeModifierCache& cache, const CBlockIndex* pindexCurrent, uint64_t& nStakeModifier, bool& fGeneratedStakeModifier);
 bool GetKernelStakeModifier(Chainstate& chainstate, CBlockIndex* pindexPrev, uint256 hashBlockFrom, uint64_t& nStakeModifier, int& nStakeModifierHeight, int64_t& nStakeModifierTime, bool fPrintProofOfStake = true);
 
-bool CheckProofOfStake(const CBlock& block, uint256& hashProofOfStake, std::unique_ptr<CStakeInput>& stake, Chainstate& chainstate);
+/**
+ * Check the coinstake kernel of a block. The kernel is looked up in the UTXO
+ * set; a kernel already spent on the active chain (a block of a competing
+ * fork) is found in the undo data of the blocks above the fork, and with
+ * -txindex also below it. Otherwise the check fails with the "kernel-spent"
+ * error recorded in state.
+ */
+bool CheckProofOfStake(const CBlock& block, uint256& hashProofOfStake, std::unique_ptr<CStakeInput>& stake, Chainstate& chainstate, BlockValidationState& state);
+
+/** Proof-of-stake checks of a block done before cs_main is taken, see PreValidateProofOfStake. */
+struct CStakePreValidation {
+    bool fSignatureChecked{false};
+    bool fKernelChecked{false};
+    //! chain state the kernel was checked against
+    const CBlockIndex* pindexFrom{nullptr};
+    uint64_t nStakeModifier{0};
+    //! microseconds the kernel check took
+    int64_t nCheckTime{0};
+};
+
+/**
+ * Verify the block signature and the stake kernel without holding cs_main.
+ * Only checks that passed are recorded; whatever failed or was skipped is
+ * repeated, and reported, by the regular validation under cs_main.
+ */
+void PreValidateProofOfStake(const CBlock& block, CStakePreValidation& result, Chainstate& chainstate) LOCKS_EXCLUDED(cs_main);
+/** Whether a kernel check recorded by PreValidateProofOfStake still applies to the current chain. */
+bool ConfirmProofOfStake(const CBlock& block, const CStakePreValidation& result, Chainstate& chainstate) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 bool stakeTargetHit(const uint256& hashProofOfStake, const int64_t& nValueIn, const uint256& bnTargetPerCoinDay);
 bool checkStake(const CDataStream& ssUniqueID, CAmount nValueIn, const uint64_t nStakeModifier, arith_uint256& bnTarget, unsigned int nTimeBlockFrom, unsigned int& nTimeTx, uint256& hashProofOfStake);
 bool buildStake(CStakeInput* stakeInput, unsigned int nBits, unsigned int nTimeBlockFrom, unsigned int& nTimeTx, uint256& hashProofOfStake, Chainstate& chainstate);
@@ -3,33 +3,54 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <chain.h>
+#include <coins.h>
+#include <index/txindex.h>
+#include <node/transaction.h>
 #include <pos/pos.h>
 #include <pos/stakeinput.h>
+#include <pos/stakemetrics.h>
 #include <pos/wallet.h>
 #include <validation.h>
 
 bool CMyceStake::SetInput(CTransactionRef txPrev, unsigned int n)
 {
+    if (n >= txPrev->vout.size()) {
+        return false;
+    }
     this->txFrom = txPrev;
-    this->nPosition = n;
+    this->prevout = COutPoint(txPrev->GetHash(), n);
+    this->txout = txPrev->vout[n];
     return true;
 }
 
+bool CMyceStake::SetInput(const COutPoint& outpoint, const Coin& coin, Chainstate& chainstate)
+{
+    LOCK(cs_main);
+    this->txFrom = nullptr;
+    this->prevout = outpoint;
+    this->txout = coin.out;
+    this->pindexFrom = chainstate.m_chain[coin.nHeight];
+    return pindexFrom != nullptr;
+}
+
 bool CMyceStake::GetTxFrom(CTransactionRef& tx)
 {
+    if (!txFrom) {
+        return false;
+    }
     tx = txFrom;
     return true;
 }
 
 bool CMyceStake::CreateTxIn(CStakeWallet* wallet, CTxIn& txIn, uint256 hashTxOut)
 {
-    txIn = CTxIn(txFrom->GetHash(), nPosition);
+    txIn = CTxIn(prevout.hash, prevout.n);
     return true;
 }
 
 CAmount CMyceStake::GetValue()
 {
-    return txFrom->vout[nPosition].nValue;
+    return txout.nValue;
 }
 
 bool CMyceStake::CreateTxOuts(CStakeWallet* wallet, std::vector<CTxOut>& vout, CAmount nTotal)
@@ -41,7 +62,7 @@ bool CMyceStake::CreateTxOuts(CStakeWallet* wallet, std::vector<CTxOut>& vout, C
     }
 
     std::vector<valtype> vSolutions;
-    CScript scriptPubKeyKernel = txFrom->vout[nPosition].scriptPubKey;
+    CScript scriptPubKeyKernel = txout.scriptPubKey;
     TxoutType whichType = Solver(scriptPubKeyKernel, vSolutions);
     if (whichType == TxoutType::NONSTANDARD) {
         LogPrint(BCLog::POS, "%s: failed to parse kernel\n", __func__);
@@ -119,16 +140,36 @@ bool CMyceStake::GetModifier(uint64_t& nStakeModifier, Chainstate& chainstate)
 CDataStream CMyceStake::GetUniqueness()
 {
     CDataStream ss(SER_NETWORK, 0);
-    ss << nPosition << txFrom->GetHash();
+    ss << prevout.n << prevout.hash;
     return ss;
 }
 
 CBlockIndex* CMyceStake::GetIndexFrom(Chainstate& chainstate)
 {
+    LOCK(cs_main);
+    if (pindexFrom && chainstate.m_chain.Contains(pindexFrom)) {
+        return pindexFrom;
+    }
+
+    // the UTXO set records the confirmation height of an unspent kernel
+    Coin coin;
+    if (chainstate.CoinsTip().GetCoin(prevout, coin)) {
+        pindexFrom = chainstate.m_chain[coin.nHeight];
+        return pindexFrom;
+    }
+
+    // spent kernels (e.g. blocks on a competing branch) need the tx index
+    if (!g_txindex) {
+        LogPrint(BCLog::POS, "%s: kernel %s not in UTXO set and tx index disabled\n", __func__, prevout.ToString());
+        pindexFrom = nullptr;
+        return pindexFrom;
+    }
+
     const Consensus::Params& params = Params().GetConsensus();
 
     uint256 hashBlock{};
-    CTransactionRef tx = node::GetTransaction(nullptr, nullptr, txFrom->GetHash(), params, hashBlock);
+    g_staking_metrics.AddTxIndexRead();
+    CTransactionRef tx = node::GetTransaction(nullptr, nullptr, prevout.hash, params, hashBlock);
     if (tx) {
         CBlockIndex* pindex = chainstate.m_blockman.LookupBlockIndex(hashBlock);
         if (pindex) {
@@ -140,7 +181,7 @@ CBlockIndex* CMyceStake::GetIndexFrom(Chainstate& chainstate)
             pindexFrom = nullptr;
         }
     } else {
-        LogPrint(BCLog::POS, "%s: failed to find tx %s\n", __func__, txFrom->GetHash().ToString());
+        LogPrint(BCLog::POS, "%s: failed to find tx %s\n", __func__, prevout.hash.ToString());
         pindexFrom = nullptr;
     }
 
@@ -6,6 +6,7 @@
 #define POS_STAKEINPUT_H
 
 class CDataStream;
+class Coin;
 class CKeyStore;
 class CStakeWallet;
 class CWallet;
@@ -36,7 +37,8 @@ class CMyceStake : public CStakeInput
 {
 private:
     CTransactionRef txFrom;
-    unsigned int nPosition;
+    COutPoint prevout;
+    CTxOut txout;
 
 public:
     CMyceStake()
@@ -45,6 +47,7 @@ public:
     }
 
     bool SetInput(CTransactionRef txPrev, unsigned int n);
+    bool SetInput(const COutPoint& outpoint, const Coin& coin, Chainstate& chainstate);
 
     CBlockIndex* GetIndexFrom(Chainstate& chainstate) override;
     bool GetTxFrom(CTransactionRef& tx) override;
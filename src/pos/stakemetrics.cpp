@@ -0,0 +1,72 @@
+// Copyright (c) 2022 The Myce Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <pos/stakemetrics.h>
+
+#include <algorithm>
+
+CStakingMetrics g_staking_metrics;
+
+void CStakingMetrics::AddSearchRound(uint64_t nHashes, int64_t nMicros)
+{
+    AddKernelHashes(nHashes);
+
+    LOCK(m_mutex);
+    ++nSearchRounds;
+    nSearchHashes += nHashes;
+    nSearchTime += nMicros;
+    if (nMicros > 0) {
+        dLastRoundHashRate = nHashes * 1000000.0 / nMicros;
+    }
+}
+
+void CStakingMetrics::AddModifierLookup(bool fIndexHit)
+{
+    nModifierLookups.fetch_add(1, std::memory_order_relaxed);
+    if (fIndexHit) {
+        nModifierIndexHits.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void CStakingMetrics::AddCheckProofOfStake(int64_t nMicros)
+{
+    LOCK(m_mutex);
+    ++nCheckProofOfStake;
+    if (vLatency.size() < STAKE_LATENCY_SAMPLES) {
+        vLatency.push_back(nMicros);
+    } else {
+        vLatency[nLatencyNext] = nMicros;
+        nLatencyNext = (nLatencyNext + 1) % STAKE_LATENCY_SAMPLES;
+    }
+}
+
+CStakingMetrics::Snapshot CStakingMetrics::GetSnapshot() const
+{
+    Snapshot snapshot;
+    snapshot.nKernelHashes = nKernelHashes.load(std::memory_order_relaxed);
+    snapshot.nModifierLookups = nModifierLookups.load(std::memory_order_relaxed);
+    snapshot.nModifierIndexHits = nModifierIndexHits.load(std::memory_order_relaxed);
+    snapshot.nTxIndexReads = nTxIndexReads.load(std::memory_order_relaxed);
+
+    std::vector<int64_t> vSorted;
+    {
+        LOCK(m_mutex);
+        snapshot.nSearchRounds = nSearchRounds;
+        snapshot.dHashRate = nSearchTime > 0 ? nSearchHashes * 1000000.0 / nSearchTime : 0;
+        snapshot.dLastRoundHashRate = dLastRoundHashRate;
+        snapshot.nCheckProofOfStake = nCheckProofOfStake;
+        vSorted = vLatency;
+    }
+
+    std::sort(vSorted.begin(), vSorted.end());
+    auto percentile = [&vSorted](int nPercent) -> int64_t {
+        if (vSorted.empty()) return 0;
+        return vSorted[(vSorted.size() - 1) * nPercent / 100];
+    };
+    snapshot.nLatencyP50 = percentile(50);
+    snapshot.nLatencyP90 = percentile(90);
+    snapshot.nLatencyP99 = percentile(99);
+    snapshot.nLatencyMax = percentile(100);
+    return snapshot;
+}
@@ -0,0 +1,70 @@
+// Copyright (c) 2022 The Myce Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef POS_STAKEMETRICS_H
+#define POS_STAKEMETRICS_H
+
+#include <sync.h>
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+//! number of CheckProofOfStake timings kept for the latency percentiles
+static const size_t STAKE_LATENCY_SAMPLES = 1000;
+
+/**
+ * Counters of the proof-of-stake hot paths: kernel hashing while staking and
+ * stake validation. Counters are updated with relaxed atomics or once per
+ * search round / checked block, so they are cheap enough to be always on.
+ */
+class CStakingMetrics
+{
+private:
+    std::atomic<uint64_t> nKernelHashes{0};
+    std::atomic<uint64_t> nModifierLookups{0};
+    std::atomic<uint64_t> nModifierIndexHits{0};
+    std::atomic<uint64_t> nTxIndexReads{0};
+
+    mutable Mutex m_mutex;
+    uint64_t nSearchRounds GUARDED_BY(m_mutex){0};
+    uint64_t nSearchHashes GUARDED_BY(m_mutex){0};
+    int64_t nSearchTime GUARDED_BY(m_mutex){0};
+    double dLastRoundHashRate GUARDED_BY(m_mutex){0};
+
+    uint64_t nCheckProofOfStake GUARDED_BY(m_mutex){0};
+    //! ring of the most recent CheckProofOfStake durations in microseconds
+    std::vector<int64_t> vLatency GUARDED_BY(m_mutex);
+    size_t nLatencyNext GUARDED_BY(m_mutex){0};
+
+public:
+    struct Snapshot {
+        uint64_t nKernelHashes;
+        uint64_t nSearchRounds;
+        double dHashRate;
+        double dLastRoundHashRate;
+        uint64_t nModifierLookups;
+        uint64_t nModifierIndexHits;
+        uint64_t nTxIndexReads;
+        uint64_t nCheckProofOfStake;
+        //! CheckProofOfStake latency in microseconds over the recent samples
+        int64_t nLatencyP50;
+        int64_t nLatencyP90;
+        int64_t nLatencyP99;
+        int64_t nLatencyMax;
+    };
+
+    void AddKernelHashes(uint64_t nHashes) { nKernelHashes.fetch_add(nHashes, std::memory_order_relaxed); }
+    /** Record a kernel search round of nHashes hashes that took nMicros. */
+    void AddSearchRound(uint64_t nHashes, int64_t nMicros) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    void AddModifierLookup(bool fIndexHit);
+    void AddTxIndexRead() { nTxIndexReads.fetch_add(1, std::memory_order_relaxed); }
+    void AddCheckProofOfStake(int64_t nMicros) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    Snapshot GetSnapshot() const EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+};
+
+extern CStakingMetrics g_staking_metrics;
+
+#endif // POS_STAKEMETRICS_H
@@ -0,0 +1,186 @@
+// Copyright (c) 2022 The Myce Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <pos/stakesearch.h>
+
+#include <crypto/common.h>
+#include <pos/stakemetrics.h>
+#include <streams.h>
+#include <tinyformat.h>
+#include <util/time.h>
+#include <util/threadnames.h>
+
+#include <algorithm>
+
+CStakeKernel::CStakeKernel(uint64_t nStakeModifierIn, unsigned int nTimeBlockFromIn, const CDataStream& ssUniqueID, CAmount nValueIn)
+    : bnCoinDayWeight(nValueIn / 100), nStakeModifier(nStakeModifierIn), nTimeBlockFrom(nTimeBlockFromIn)
+{
+    CDataStream ss(SER_GETHASH, 0);
+    ss << nStakeModifier << nTimeBlockFrom << ssUniqueID;
+    hasherPrefix.Write(UCharCast(ss.data()), ss.size());
+}
+
+uint256 CStakeKernel::GetHash(unsigned int nTimeTx) const
+{
+    unsigned char time[4];
+    WriteLE32(time, nTimeTx);
+
+    uint256 hash;
+    CSHA256(hasherPrefix).Write(time, sizeof(time)).Finalize(hash.begin());
+    CSHA256().Write(hash.begin(), CSHA256::OUTPUT_SIZE).Finalize(hash.begin());
+    return hash;
+}
+
+bool CStakeKernel::CheckWindow(const arith_uint256& bnTargetWeight, unsigned int nTimeFirst, int nCount, unsigned int& nTimeTx, uint256& hashProofOfStake) const
+{
+    for (int i = 0; i < nCount; i++) {
+        const unsigned int nTryTime = nTimeFirst - i;
+        hashProofOfStake = GetHash(nTryTime);
+        if (UintToArith256(hashProofOfStake) < bnTargetWeight) {
+            nTimeTx = nTryTime;
+            return true;
+        }
+    }
+    return false;
+}
+
+CStakeSearcher::CStakeSearcher(int nThreads)
+{
+    for (int n = 0; n < nThreads; ++n) {
+        m_worker_threads.emplace_back([this, n]() {
+            util::ThreadRename(strprintf("stakesearch.%i", n));
+            Loop();
+        });
+    }
+}
+
+CStakeSearcher::~CStakeSearcher()
+{
+    WITH_LOCK(m_mutex, m_request_stop = true);
+    m_worker_cv.notify_all();
+    for (std::thread& t : m_worker_threads) {
+        t.join();
+    }
+}
+
+void CStakeSearcher::Work()
+{
+    const std::vector<const CStakeKernel*>& vKernels = *pvKernels;
+    uint64_t nHashes = 0;
+    bool fDone = false;
+    while (!fDone && !fFound.load(std::memory_order_relaxed)) {
+        const size_t nBegin = nNextKernel.fetch_add(KERNEL_BATCH_SIZE);
+        if (nBegin >= vKernels.size()) {
+            break;
+        }
+        const size_t nEnd = std::min(nBegin + KERNEL_BATCH_SIZE, vKernels.size());
+        for (size_t i = nBegin; i < nEnd; ++i) {
+            const CStakeKernel& kernel = *vKernels[i];
+            unsigned int nTimeTx;
+            uint256 hashProofOfStake;
+            if (kernel.CheckWindow(kernel.GetTargetWeight(bnTargetPerCoinDay), nTimeFirst, nHashDrift, nTimeTx, hashProofOfStake)) {
+                nHashes += nTimeFirst - nTimeTx + 1;
+                LOCK(m_mutex);
+                if (!fFound.exchange(true)) {
+                    nKernelFound = i;
+                    nTimeFound = nTimeTx;
+                    hashFound = hashProofOfStake;
+                }
+                fDone = true;
+                break;
+            }
+            nHashes += nHashDrift;
+        }
+    }
+    nHashesRound.fetch_add(nHashes, std::memory_order_relaxed);
+}
+
+void CStakeSearcher::Loop()
+{
+    uint64_t nRoundSeen = 0;
+    while (true) {
+        {
+            WAIT_LOCK(m_mutex, lock);
+            m_worker_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_request_stop || nRoundId != nRoundSeen; });
+            if (m_request_stop) {
+                return;
+            }
+            nRoundSeen = nRoundId;
+        }
+        Work();
+        {
+            LOCK(m_mutex);
+            if (--nActive == 0) {
+                m_master_cv.notify_one();
+            }
+        }
+    }
+}
+
+bool CStakeSearcher::Search(const std::vector<const CStakeKernel*>& vKernels, unsigned int nBits, unsigned int nTimeFirstIn, int nHashDriftIn,
+                            size_t& nKernel, unsigned int& nTimeTx, uint256& hashProofOfStake)
+{
+    if (vKernels.empty()) {
+        return false;
+    }
+
+    {
+        LOCK(m_mutex);
+        pvKernels = &vKernels;
+        bnTargetPerCoinDay.SetCompact(nBits);
+        nTimeFirst = nTimeFirstIn;
+        nHashDrift = nHashDriftIn;
+        nNextKernel = 0;
+        fFound = false;
+        nHashesRound = 0;
+        nActive = m_worker_threads.size();
+        ++nRoundId;
+    }
+    const int64_t nTimeStart = GetTimeMicros();
+    m_worker_cv.notify_all();
+
+    // join the workers until the round is exhausted
+    Work();
+
+    WAIT_LOCK(m_mutex, lock);
+    m_master_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return nActive == 0; });
+    pvKernels = nullptr;
+    g_staking_metrics.AddSearchRound(nHashesRound, GetTimeMicros() - nTimeStart);
+    if (!fFound) {
+        return false;
+    }
+    nKernel = nKernelFound;
+    nTimeTx = nTimeFound;
+    hashProofOfStake = hashFound;
+    return true;
+}
+
+const CStakeKernel* CStakeSearcher::GetCachedKernel(const COutPoint& prevout, const uint256& hashBlockFrom, uint64_t nStakeModifier)
+{
+    auto it = mapKernelCache.find(prevout);
+    if (it == mapKernelCache.end() || it->second.hashBlockFrom != hashBlockFrom || it->second.kernel.GetStakeModifier() != nStakeModifier) {
+        return nullptr;
+    }
+    it->second.nRound = nCacheRound;
+    return &it->second.kernel;
+}
+
+const CStakeKernel* CStakeSearcher::AddCachedKernel(const COutPoint& prevout, const uint256& hashBlockFrom, const CStakeKernel& kernel)
+{
+    mapKernelCache.erase(prevout);
+    auto it = mapKernelCache.emplace(prevout, CacheEntry{hashBlockFrom, kernel, nCacheRound}).first;
+    return &it->second.kernel;
+}
+
+void CStakeSearcher::NewCacheRound()
+{
+    for (auto it = mapKernelCache.begin(); it != mapKernelCache.end();) {
+        if (it->second.nRound < nCacheRound) {
+            it = mapKernelCache.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    ++nCacheRound;
+}
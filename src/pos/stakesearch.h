@@ -0,0 +1,133 @@
+// Copyright (c) 2022 The Myce Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef POS_STAKESEARCH_H
+#define POS_STAKESEARCH_H
+
+#include <arith_uint256.h>
+#include <consensus/amount.h>
+#include <crypto/sha256.h>
+#include <primitives/transaction.h>
+#include <sync.h>
+#include <uint256.h>
+#include <util/hasher.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+class CDataStream;
+
+/**
+ * Stake kernel of one input with everything but the transaction time
+ * precomputed. The kernel hash is the double SHA256 of
+ * (modifier, nTimeBlockFrom, uniqueness, nTimeTx), so the hasher state after
+ * the constant prefix and the coin day weight can be reused for every try.
+ */
+class CStakeKernel
+{
+private:
+    CSHA256 hasherPrefix;
+    arith_uint256 bnCoinDayWeight;
+    uint64_t nStakeModifier;
+    unsigned int nTimeBlockFrom;
+
+public:
+    CStakeKernel(uint64_t nStakeModifierIn, unsigned int nTimeBlockFromIn, const CDataStream& ssUniqueID, CAmount nValueIn);
+
+    uint64_t GetStakeModifier() const { return nStakeModifier; }
+    unsigned int GetTimeBlockFrom() const { return nTimeBlockFrom; }
+
+    /** Coin day weighted target, only depends on the block difficulty. */
+    arith_uint256 GetTargetWeight(const arith_uint256& bnTargetPerCoinDay) const { return bnCoinDayWeight * bnTargetPerCoinDay; }
+
+    uint256 GetHash(unsigned int nTimeTx) const;
+
+    /** Try nCount timestamps counting down from nTimeFirst, stop at the first hit. */
+    bool CheckWindow(const arith_uint256& bnTargetWeight, unsigned int nTimeFirst, int nCount, unsigned int& nTimeTx, uint256& hashProofOfStake) const;
+};
+
+/**
+ * Pool of worker threads searching the kernels of many stake inputs at once.
+ *
+ * The calling thread pushes a round of kernels and joins the workers until
+ * either a kernel hits the target or every kernel has been tried. Kernels are
+ * claimed in small batches so that all threads finish at about the same time.
+ */
+class CStakeSearcher
+{
+public:
+    struct CacheEntry {
+        uint256 hashBlockFrom;
+        CStakeKernel kernel;
+        uint64_t nRound;
+    };
+
+private:
+    //! Mutex to protect the inner state
+    Mutex m_mutex;
+
+    //! Worker threads block on this until a new round is pushed
+    std::condition_variable m_worker_cv;
+
+    //! Master thread blocks on this until all workers left the round
+    std::condition_variable m_master_cv;
+
+    std::vector<std::thread> m_worker_threads;
+    bool m_request_stop GUARDED_BY(m_mutex){false};
+
+    //! Identifier of the round currently pushed to the workers
+    uint64_t nRoundId GUARDED_BY(m_mutex){0};
+    //! Number of workers that did not finish the current round yet
+    int nActive GUARDED_BY(m_mutex){0};
+
+    // Round parameters, written under m_mutex before the round is published
+    const std::vector<const CStakeKernel*>* pvKernels{nullptr};
+    arith_uint256 bnTargetPerCoinDay;
+    unsigned int nTimeFirst{0};
+    int nHashDrift{0};
+
+    std::atomic<size_t> nNextKernel{0};
+    std::atomic<bool> fFound{false};
+    //! Kernel hashes computed by all threads in the current round
+    std::atomic<uint64_t> nHashesRound{0};
+    size_t nKernelFound GUARDED_BY(m_mutex){0};
+    unsigned int nTimeFound GUARDED_BY(m_mutex){0};
+    uint256 hashFound GUARDED_BY(m_mutex);
+
+    //! Kernels of the inputs seen in recent rounds, keyed by outpoint
+    std::unordered_map<COutPoint, CacheEntry, SaltedOutpointHasher> mapKernelCache;
+    uint64_t nCacheRound{0};
+
+    void Work() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    void Loop() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+public:
+    //! The number of kernels a thread claims at once
+    static constexpr size_t KERNEL_BATCH_SIZE = 64;
+
+    explicit CStakeSearcher(int nThreads);
+    ~CStakeSearcher();
+
+    /**
+     * Search vKernels for a hit at any of the nHashDriftIn timestamps counting
+     * down from nTimeFirstIn. Returns the index of the hitting kernel.
+     */
+    bool Search(const std::vector<const CStakeKernel*>& vKernels, unsigned int nBits, unsigned int nTimeFirstIn, int nHashDriftIn,
+                size_t& nKernel, unsigned int& nTimeTx, uint256& hashProofOfStake) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    /**
+     * Cached kernel for an input, valid as long as its origin block and stake
+     * modifier are unchanged. The modifier of an origin block is only final
+     * once the chain is a selection interval past it, so it is checked too.
+     */
+    const CStakeKernel* GetCachedKernel(const COutPoint& prevout, const uint256& hashBlockFrom, uint64_t nStakeModifier);
+    const CStakeKernel* AddCachedKernel(const COutPoint& prevout, const uint256& hashBlockFrom, const CStakeKernel& kernel);
+    /** Start a new caching round and drop kernels not used in the previous one. */
+    void NewCacheRound();
+};
+
+#endif // POS_STAKESEARCH_H
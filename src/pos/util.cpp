@@ -1,5 +1,7 @@
 #include <pos/util.h>
 
+#include <pos/stakemetrics.h>
+
 bool GetCoinAge(const CTransaction& tx, const ChainstateManager& chainman, const CCoinsViewCache &view, uint64_t& nCoinAge, unsigned int nTimeTx)
 {
     arith_uint256 bnCentSecond = 0;
@@ -25,6 +27,7 @@ bool GetCoinAge(const CTransaction& tx, const ChainstateManager& chainman, const
 
         uint256 blockHash;
         CTransactionRef txPrev;
+        g_staking_metrics.AddTxIndexRead();
         if (g_txindex->FindTx(prevout.hash, blockHash, txPrev))
         {
             const CBlockIndex* pindex{chainman.m_blockman.LookupBlockIndex(blockHash)};
@@ -15,9 +15,10 @@
 
 const CBlockIndex* GetLastBlockIndex(const CBlockIndex* pindex, bool fProofOfStake)
 {
-    while (pindex && pindex->pprev && (pindex->IsProofOfStake() != fProofOfStake))
-        pindex = pindex->pprev;
-    return pindex;
+    if (!pindex || !pindex->pprev || pindex->IsProofOfStake() == fProofOfStake)
+        return pindex;
+    // without a block of the requested type the search ends at the genesis block
+    return pindex->pprevOtherType ? pindex->pprevOtherType : pindex->GetAncestor(0);
 }
 
 unsigned int GetNextWorkRequired(const CBlockIndex* pindexLast, const Consensus::Params& params, bool fProofOfStake)
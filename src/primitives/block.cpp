@@ -5,6 +5,8 @@
 
 #include <primitives/block.h>
 
+#include <crypto/common.h>
+#include <crypto/scrypt.h>
 #include <hash.h>
 #include <tinyformat.h>
 
@@ -20,6 +22,27 @@ uint256 CBlockHeader::GetPoWHash() const
     return scrypt_1024_1_1_256(*this);
 }
 
+std::vector<uint256> GetPoWHashes(const std::vector<CBlockHeader>& headers)
+{
+    std::vector<unsigned char> input(80 * headers.size());
+    for (size_t i = 0; i < headers.size(); i++) {
+        const CBlockHeader& header = headers[i];
+        unsigned char* p = input.data() + 80 * i;
+        WriteLE32(p, header.nVersion);
+        memcpy(p + 4, header.hashPrevBlock.begin(), 32);
+        memcpy(p + 36, header.hashMerkleRoot.begin(), 32);
+        WriteLE32(p + 68, header.nTime);
+        WriteLE32(p + 72, header.nBits);
+        WriteLE32(p + 76, header.nNonce);
+    }
+
+    std::vector<uint256> hashes(headers.size());
+    if (!headers.empty()) {
+        scrypt_1024_1_1_256_batch((const char*)input.data(), (char*)hashes.data(), headers.size());
+    }
+    return hashes;
+}
+
 std::string CBlock::ToString() const
 {
     std::stringstream s;
@@ -66,6 +66,9 @@ public:
     }
 };
 
+/** Proof-of-work hashes of many headers at once, see scrypt_1024_1_1_256_batch. */
+std::vector<uint256> GetPoWHashes(const std::vector<CBlockHeader>& headers);
+
 
 class CBlock : public CBlockHeader
 {
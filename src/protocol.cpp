@@ -64,6 +64,7 @@ const char* FINALBUDGETVOTE = "fbvote";
 const char* SYNCSTATUSCOUNT = "ssc";
 const char* DSEG = "dseg";
 const char* DSEEP = "dseep";
+const char* MNLIST = "mnlist";
 } // namespace NetMsgType
 
 /** All known message types. Keep this in the same order as the list of
@@ -119,7 +120,8 @@ const static std::string allNetMessageTypes[] = {
     NetMsgType::FINALBUDGET,
     NetMsgType::FINALBUDGETVOTE,
     NetMsgType::SYNCSTATUSCOUNT,
-    NetMsgType::DSEG
+    NetMsgType::DSEG,
+    NetMsgType::MNLIST
 };
 const static std::vector<std::string> allNetMessageTypesVec(std::begin(allNetMessageTypes), std::end(allNetMessageTypes));
 
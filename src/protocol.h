@@ -288,6 +288,11 @@ extern const char* GETMNWINNERS;
 * The dseg message is used to request the Masternode list or an specific entry
 */
 extern const char* DSEG;
+/**
+ * The mnlist message is used to send the Masternode list in reply to a dseg
+ * message asking for a snapshot
+ */
+extern const char* MNLIST;
 /**
  * The budgetproposal message is used to broadcast or relay budget proposal metadata to connected peers
  */
@@ -59,57 +59,52 @@ static RPCHelpMan listmasternodes()
     if (request.params.size() == 1) strFilter = request.params[0].get_str();
 
     ChainstateManager& chainman = EnsureAnyChainman(request.context);
-    LOCK(cs_main);
-    Chainstate& active_chainstate = chainman.ActiveChainstate();
-    CChain& active_chain = active_chainstate.m_chain;
 
     UniValue ret(UniValue::VARR);
-    CBlockIndex* pindex = nullptr;
-    int nHeight;
-    {
-        LOCK(cs_main);
-        pindex = active_chain.Tip();
-        if(!pindex) return 0;
-        nHeight = pindex->nHeight;
-    }
-
-    std::vector<std::pair<int, CMasternode> > vMasternodeRanks = mnodeman.GetMasternodeRanks(pindex, nHeight);
+    CBlockIndex* pindex = WITH_LOCK(cs_main, return chainman.ActiveChain().Tip());
+    if (!pindex) return 0;
+    int nHeight = pindex->nHeight;
+
+    // work on a snapshot of the list, so that neither cs_main nor the masternode list is locked meanwhile
+    CMasternodeListRef vMasternodes = mnodeman.GetListSnapshot();
+    const int nMinProtocol = masternodePayments.GetMinMasternodePaymentsProto();
+    const int nEnabled = std::count_if(vMasternodes->begin(), vMasternodes->end(), [nMinProtocol](const CMasternode& mn) {
+        return mn.protocolVersion >= nMinProtocol && mn.IsEnabled();
+    });
+
+    std::vector<std::pair<int, const CMasternode*> > vMasternodeRanks = CMasternodeMan::GetMasternodeRanks(vMasternodes, pindex, nHeight);
     for (auto& s : vMasternodeRanks) {
         UniValue obj(UniValue::VOBJ);
-        string strVin = s.second.vin.prevout.ToStringShort();
-        string strTxHash = s.second.vin.prevout.hash.ToString();
-        uint32_t oIdx = s.second.vin.prevout.n;
-
-        CMasternode* mn = mnodeman.Find(s.second.vin);
-
-        if (mn != NULL) {
-            if (strFilter != "" && strTxHash.find(strFilter) == string::npos &&
-                mn->Status().find(strFilter) == string::npos &&
-                EncodeDestination(PKHash(mn->pubKeyCollateralAddress)).find(strFilter) == string::npos) continue;
-
-            string strStatus = mn->Status();
-            string strHost;
-            uint16_t port;
-            SplitHostPort(mn->addr.ToString(), port, strHost);
-
-            CNetAddr node;
-            node.SetSpecial(strHost);
-            string strNetwork = GetNetworkName(node.GetNetwork());
-
-            obj.pushKV("rank", (strStatus == "ENABLED" ? s.first : 0));
-            obj.pushKV("network", strNetwork);
-            obj.pushKV("txhash", strTxHash);
-            obj.pushKV("outidx", (uint64_t)oIdx);
-            obj.pushKV("pubkey", HexStr(mn->pubKeyMasternode));
-            obj.pushKV("status", strStatus);
-            obj.pushKV("addr", EncodeDestination(PKHash(mn->pubKeyCollateralAddress)));
-            obj.pushKV("version", mn->protocolVersion);
-            obj.pushKV("lastseen", (int64_t)mn->lastPing.sigTime);
-            obj.pushKV("activetime", (int64_t)(mn->lastPing.sigTime - mn->sigTime));
-            obj.pushKV("lastpaid", (int64_t)mn->GetLastPaid(pindex));
+        const CMasternode& mn = *s.second;
+        string strTxHash = mn.vin.prevout.hash.ToString();
+        uint32_t oIdx = mn.vin.prevout.n;
+
+        if (strFilter != "" && strTxHash.find(strFilter) == string::npos &&
+            mn.Status().find(strFilter) == string::npos &&
+            EncodeDestination(PKHash(mn.pubKeyCollateralAddress)).find(strFilter) == string::npos) continue;
+
+        string strStatus = mn.Status();
+        string strHost;
+        uint16_t port;
+        SplitHostPort(mn.addr.ToString(), port, strHost);
+
+        CNetAddr node;
+        node.SetSpecial(strHost);
+        string strNetwork = GetNetworkName(node.GetNetwork());
+
+        obj.pushKV("rank", (strStatus == "ENABLED" ? s.first : 0));
+        obj.pushKV("network", strNetwork);
+        obj.pushKV("txhash", strTxHash);
+        obj.pushKV("outidx", (uint64_t)oIdx);
+        obj.pushKV("pubkey", HexStr(mn.pubKeyMasternode));
+        obj.pushKV("status", strStatus);
+        obj.pushKV("addr", EncodeDestination(PKHash(mn.pubKeyCollateralAddress)));
+        obj.pushKV("version", mn.protocolVersion);
+        obj.pushKV("lastseen", (int64_t)mn.lastPing.sigTime);
+        obj.pushKV("activetime", (int64_t)(mn.lastPing.sigTime - mn.sigTime));
+        obj.pushKV("lastpaid", (int64_t)mn.GetLastPaid(pindex, nEnabled));
 
-            ret.push_back(obj);
-        }
+        ret.push_back(obj);
     }
 
     return ret;
@@ -578,18 +573,10 @@ static RPCHelpMan getmasternodewinners()
     [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
 {
     ChainstateManager& chainman = EnsureAnyChainman(request.context);
-    LOCK(cs_main);
-    Chainstate& active_chainstate = chainman.ActiveChainstate();
-    CChain& active_chain = active_chainstate.m_chain;
 
-    CBlockIndex* pindex = nullptr;
-    int nHeight;
-    {
-        LOCK(cs_main);
-        pindex = active_chain.Tip();
-        if(!pindex) return 0;
-        nHeight = pindex->nHeight;
-    }
+    CBlockIndex* pindex = WITH_LOCK(cs_main, return chainman.ActiveChain().Tip());
+    if (!pindex) return 0;
+    int nHeight = pindex->nHeight;
 
     int nLast = 10;
     string strFilter = "";
@@ -661,18 +648,10 @@ static RPCHelpMan getmasternodescores()
     [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
 {
     ChainstateManager& chainman = EnsureAnyChainman(request.context);
-    LOCK(cs_main);
-    Chainstate& active_chainstate = chainman.ActiveChainstate();
-    CChain& active_chain = active_chainstate.m_chain;
 
-    CBlockIndex* pindex = nullptr;
-    int nHeight;
-    {
-        LOCK(cs_main);
-        pindex = active_chain.Tip();
-        if(!pindex) return 0;
-        nHeight = pindex->nHeight;
-    }
+    CBlockIndex* pindex = WITH_LOCK(cs_main, return chainman.ActiveChain().Tip());
+    if (!pindex) return 0;
+    int nHeight = pindex->nHeight;
 
     int nLast = 10;
     if (request.params.size() == 1) {
@@ -684,19 +663,19 @@ static RPCHelpMan getmasternodescores()
     }
 
     UniValue obj(UniValue::VOBJ);
-    std::vector<CMasternode> vMasternodes = mnodeman.GetFullMasternodeVector();
-    for (int nHeight = active_chain.Tip()->nHeight - nLast; nHeight < active_chain.Tip()->nHeight + 20; nHeight++) {
+    CMasternodeListRef vMasternodes = mnodeman.GetListSnapshot();
+    for (int nScoreHeight = nHeight - nLast; nScoreHeight < nHeight + 20; nScoreHeight++) {
         uint256 nHigh = uint256();
-        CMasternode* pBestMasternode = NULL;
-        for (CMasternode& mn : vMasternodes) {
-            uint256 n = mn.CalculateScore(1, nHeight - 100);
+        const CMasternode* pBestMasternode = NULL;
+        for (const CMasternode& mn : *vMasternodes) {
+            uint256 n = mn.CalculateScore(1, nScoreHeight - 100);
             if (UintToArith256(n) > UintToArith256(nHigh)) {
                 nHigh = n;
                 pBestMasternode = &mn;
             }
         }
         if (pBestMasternode)
-            obj.pushKV(strprintf("%d", nHeight), pBestMasternode->vin.prevout.hash.ToString().c_str());
+            obj.pushKV(strprintf("%d", nScoreHeight), pBestMasternode->vin.prevout.hash.ToString().c_str());
     }
 
     return obj;
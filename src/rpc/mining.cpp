@@ -17,6 +17,7 @@
 #include <net.h>
 #include <node/context.h>
 #include <node/miner.h>
+#include <pos/stakemetrics.h>
 #include <pow.h>
 #include <rpc/blockchain.h>
 #include <rpc/mining.h>
@@ -434,6 +435,59 @@ static RPCHelpMan getmininginfo()
 }
 
 
+static RPCHelpMan getstakingmetrics()
+{
+    return RPCHelpMan{"getstakingmetrics",
+                "\nReturns counters of the proof-of-stake hot paths since startup.",
+                {},
+                RPCResult{
+                    RPCResult::Type::OBJ, "", "",
+                    {
+                        {RPCResult::Type::NUM, "kernelhashes", "Total number of stake kernel hashes computed"},
+                        {RPCResult::Type::NUM, "searchrounds", "Number of kernel search rounds run while staking"},
+                        {RPCResult::Type::NUM, "kernelhashps", "Kernel hashes per second averaged over all search rounds"},
+                        {RPCResult::Type::NUM, "lastroundhashps", "Kernel hashes per second of the last search round"},
+                        {RPCResult::Type::NUM, "modifierlookups", "Number of kernel stake modifier lookups"},
+                        {RPCResult::Type::NUM, "modifierindexhits", "Lookups answered by the stake modifier index"},
+                        {RPCResult::Type::NUM, "txindexreads", "Number of tx index reads done by proof-of-stake code"},
+                        {RPCResult::Type::OBJ, "checkproofofstake", "CheckProofOfStake calls and latency in microseconds over the recent calls",
+                        {
+                            {RPCResult::Type::NUM, "count", "Number of calls"},
+                            {RPCResult::Type::NUM, "p50", "Median latency"},
+                            {RPCResult::Type::NUM, "p90", "90th percentile latency"},
+                            {RPCResult::Type::NUM, "p99", "99th percentile latency"},
+                            {RPCResult::Type::NUM, "max", "Maximum latency"},
+                        }},
+                    }},
+                RPCExamples{
+                    HelpExampleCli("getstakingmetrics", "")
+            + HelpExampleRpc("getstakingmetrics", "")
+                },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    const CStakingMetrics::Snapshot metrics = g_staking_metrics.GetSnapshot();
+
+    UniValue latency(UniValue::VOBJ);
+    latency.pushKV("count", metrics.nCheckProofOfStake);
+    latency.pushKV("p50", metrics.nLatencyP50);
+    latency.pushKV("p90", metrics.nLatencyP90);
+    latency.pushKV("p99", metrics.nLatencyP99);
+    latency.pushKV("max", metrics.nLatencyMax);
+
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("kernelhashes", metrics.nKernelHashes);
+    obj.pushKV("searchrounds", metrics.nSearchRounds);
+    obj.pushKV("kernelhashps", metrics.dHashRate);
+    obj.pushKV("lastroundhashps", metrics.dLastRoundHashRate);
+    obj.pushKV("modifierlookups", metrics.nModifierLookups);
+    obj.pushKV("modifierindexhits", metrics.nModifierIndexHits);
+    obj.pushKV("txindexreads", metrics.nTxIndexReads);
+    obj.pushKV("checkproofofstake", latency);
+    return obj;
+},
+    };
+}
+
 // NOTE: Unlike wallet RPC (which use BTC values), mining RPCs follow GBT (BIP 22) in using satoshi amounts
 static RPCHelpMan prioritisetransaction()
 {
@@ -1038,6 +1092,7 @@ void RegisterMiningRPCCommands(CRPCTable& t)
     static const CRPCCommand commands[]{
         {"mining", &getnetworkhashps},
         {"mining", &getmininginfo},
+        {"mining", &getstakingmetrics},
         {"mining", &prioritisetransaction},
         {"mining", &getblocktemplate},
         {"mining", &submitblock},
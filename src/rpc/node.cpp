@@ -12,6 +12,11 @@
 #include <interfaces/echo.h>
 #include <interfaces/init.h>
 #include <interfaces/ipc.h>
+#include <masternode/init.h>
+#include <masternode/masternode-budget.h>
+#include <masternode/masternode-payments.h>
+#include <masternode/masternode-sync.h>
+#include <masternode/masternodeman.h>
 #include <node/context.h>
 #include <rpc/server.h>
 #include <rpc/server_util.h>
@@ -136,6 +141,24 @@ static UniValue RPCLockedMemoryInfo()
     return obj;
 }
 
+static UniValue RPCMasternodeMemoryInfo()
+{
+    std::map<std::string, CSeenCacheStats> mapStats;
+    mnodeman.GetSeenCacheStats(mapStats);
+    masternodePayments.GetSeenCacheStats(mapStats);
+    budget.GetSeenCacheStats(mapStats);
+    masternodeSync.GetSeenCacheStats(mapStats);
+
+    UniValue obj(UniValue::VOBJ);
+    for (const auto& [name, stats] : mapStats) {
+        UniValue cache(UniValue::VOBJ);
+        cache.pushKV("size", uint64_t(stats.nSize));
+        cache.pushKV("usage", uint64_t(stats.nUsage));
+        obj.pushKV(name, cache);
+    }
+    return obj;
+}
+
 #ifdef HAVE_MALLOC_INFO
 static std::string RPCMallocInfo()
 {
@@ -180,6 +203,14 @@ static RPCHelpMan getmemoryinfo()
                                 {RPCResult::Type::NUM, "chunks_used", "Number allocated chunks"},
                                 {RPCResult::Type::NUM, "chunks_free", "Number unused chunks"},
                             }},
+                            {RPCResult::Type::OBJ_DYN, "masternode", "Seen-message caches of the masternode, payment and budget managers",
+                            {
+                                {RPCResult::Type::OBJ, "name", "",
+                                {
+                                    {RPCResult::Type::NUM, "size", "Number of entries"},
+                                    {RPCResult::Type::NUM, "usage", "Bytes used by the cache, not counting memory owned by the entries"},
+                                }},
+                            }},
                         }
                     },
                     RPCResult{"mode \"mallocinfo\"",
@@ -196,6 +227,7 @@ static RPCHelpMan getmemoryinfo()
     if (mode == "stats") {
         UniValue obj(UniValue::VOBJ);
         obj.pushKV("locked", RPCLockedMemoryInfo());
+        obj.pushKV("masternode", RPCMasternodeMemoryInfo());
         return obj;
     } else if (mode == "mallocinfo") {
 #ifdef HAVE_MALLOC_INFO
@@ -0,0 +1,159 @@
+// Copyright (c) 2022 The Myce Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <clientversion.h>
+#include <masternode/budgetcollateralindex.h>
+#include <masternode/masternode-budget.h>
+#include <script/standard.h>
+#include <streams.h>
+#include <test/util/setup_common.h>
+#include <util/time.h>
+#include <version.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(budget_tests, BasicTestingSetup)
+
+static CBudgetVote MakeVote(int n, int nVote, int64_t nTime)
+{
+    CBudgetVote vote(CTxIn(ArithToUint256(arith_uint256(n)), 0), uint256::ONE, nVote);
+    vote.nTime = nTime;
+    return vote;
+}
+
+BOOST_AUTO_TEST_CASE(budget_proposal_tallies)
+{
+    const int64_t nNow = 1600000000;
+    SetMockTime(nNow);
+
+    CBudgetProposal proposal;
+    std::string strError;
+    for (int i = 0; i < 5; i++) {
+        CBudgetVote vote = MakeVote(i, VOTE_YES, nNow);
+        BOOST_CHECK(proposal.AddOrUpdateVote(vote, strError));
+    }
+    for (int i = 5; i < 7; i++) {
+        CBudgetVote vote = MakeVote(i, VOTE_NO, nNow);
+        BOOST_CHECK(proposal.AddOrUpdateVote(vote, strError));
+    }
+    CBudgetVote voteAbstain = MakeVote(7, VOTE_ABSTAIN, nNow);
+    BOOST_CHECK(proposal.AddOrUpdateVote(voteAbstain, strError));
+    BOOST_CHECK_EQUAL(proposal.GetYeas(), 5);
+    BOOST_CHECK_EQUAL(proposal.GetNays(), 2);
+    BOOST_CHECK_EQUAL(proposal.GetAbstains(), 1);
+    BOOST_CHECK_EQUAL(proposal.GetNetVotes(), 3);
+
+    // a vote that is too soon leaves the tallies alone, a later one replaces the old vote
+    CBudgetVote voteChanged = MakeVote(0, VOTE_NO, nNow + 60);
+    BOOST_CHECK(!proposal.AddOrUpdateVote(voteChanged, strError));
+    BOOST_CHECK_EQUAL(proposal.GetYeas(), 5);
+    voteChanged.nTime = nNow + BUDGET_VOTE_UPDATE_MIN;
+    SetMockTime(nNow + BUDGET_VOTE_UPDATE_MIN);
+    BOOST_CHECK(proposal.AddOrUpdateVote(voteChanged, strError));
+    BOOST_CHECK_EQUAL(proposal.GetYeas(), 4);
+    BOOST_CHECK_EQUAL(proposal.GetNays(), 3);
+    BOOST_CHECK_EQUAL(proposal.GetNetVotes(), 1);
+
+    // copies and deserialized proposals count the same votes
+    CBudgetProposal proposalCopy(proposal);
+    BOOST_CHECK_EQUAL(proposalCopy.GetYeas(), 4);
+    BOOST_CHECK_EQUAL(proposalCopy.GetNays(), 3);
+
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << proposal;
+    CBudgetProposal proposalRead;
+    ss >> proposalRead;
+    BOOST_CHECK_EQUAL(proposalRead.GetYeas(), 4);
+    BOOST_CHECK_EQUAL(proposalRead.GetNays(), 3);
+    BOOST_CHECK_EQUAL(proposalRead.GetAbstains(), 1);
+
+    SetMockTime(0);
+}
+
+BOOST_AUTO_TEST_CASE(budget_collateral_entry)
+{
+    const uint256 hashProposal = InsecureRand256();
+
+    CMutableTransaction mtx;
+    mtx.vin.resize(1);
+    mtx.vout.emplace_back(PROPOSAL_FEE_TX, CScript() << OP_RETURN << ToByteVector(hashProposal));
+    mtx.vout.emplace_back(COIN, GetScriptForDestination(PKHash(uint160())));
+
+    CBudgetCollateralEntry entry;
+    BOOST_CHECK(CBudgetCollateralIndex::GetEntry(CTransaction(mtx), entry));
+    BOOST_REQUIRE_EQUAL(entry.vCommitments.size(), 1U);
+    BOOST_CHECK(entry.vCommitments[0].first == hashProposal);
+    BOOST_CHECK_EQUAL(entry.vCommitments[0].second, PROPOSAL_FEE_TX);
+
+    // a lock time or a non-standard output can't pay a budget fee
+    CMutableTransaction mtxLocked(mtx);
+    mtxLocked.nLockTime = 1;
+    BOOST_CHECK(!CBudgetCollateralIndex::GetEntry(CTransaction(mtxLocked), entry));
+
+    CMutableTransaction mtxNonStandard(mtx);
+    mtxNonStandard.vout.emplace_back(COIN, CScript() << OP_TRUE);
+    BOOST_CHECK(!CBudgetCollateralIndex::GetEntry(CTransaction(mtxNonStandard), entry));
+
+    // nor can a transaction without a commitment
+    CMutableTransaction mtxPlain;
+    mtxPlain.vin.resize(1);
+    mtxPlain.vout.emplace_back(COIN, GetScriptForDestination(PKHash(uint160())));
+    BOOST_CHECK(!CBudgetCollateralIndex::GetEntry(CTransaction(mtxPlain), entry));
+}
+
+BOOST_AUTO_TEST_CASE(budget_vote_older_than_seen_cache)
+{
+    const int64_t nNow = 1600000000;
+    SetMockTime(nNow);
+
+    // a proposal with two votes, as a node that has been up for weeks holds it
+    CBudgetProposal proposal;
+    std::string strError;
+    CBudgetVote voteOld = MakeVote(1, VOTE_YES, nNow);
+    CBudgetVote voteReplaced = MakeVote(2, VOTE_YES, nNow);
+    BOOST_CHECK(proposal.AddOrUpdateVote(voteOld, strError));
+    BOOST_CHECK(proposal.AddOrUpdateVote(voteReplaced, strError));
+    std::map<uint256, CBudgetProposal> mapProposals;
+    mapProposals.emplace(uint256::ONE, proposal);
+
+    CBudgetManager manager;
+    {
+        CDataStream ss(SER_DISK, CLIENT_VERSION);
+        ss << manager.mapSeenMasternodeBudgetProposals << manager.mapSeenMasternodeBudgetVotes;
+        ss << manager.mapSeenFinalizedBudgets << manager.mapSeenFinalizedBudgetVotes;
+        ss << manager.mapOrphanMasternodeBudgetVotes << manager.mapOrphanFinalizedBudgetVotes;
+        ss << mapProposals << std::map<uint256, CFinalizedBudget>();
+        LOCK(manager.cs);
+        ss >> manager;
+    }
+    {
+        LOCK(manager.cs);
+        manager.mapSeenMasternodeBudgetVotes.insert_or_assign(voteOld.GetHash(), voteOld);
+    }
+
+    // once the seen cache has dropped the vote, Sync still announces it and getdata still finds it
+    SetMockTime(nNow + BUDGET_SEEN_VOTES_SECONDS + 60);
+    {
+        LOCK(manager.cs);
+        CBudgetVote voteNew = MakeVote(3, VOTE_YES, GetTime());
+        manager.mapSeenMasternodeBudgetVotes.insert_or_assign(voteNew.GetHash(), voteNew);
+        BOOST_CHECK(!manager.mapSeenMasternodeBudgetVotes.count(voteOld.GetHash()));
+    }
+    CBudgetVote voteFound;
+    BOOST_CHECK(manager.GetProposalVote(voteOld.GetHash(), voteFound));
+    BOOST_CHECK(voteFound.GetHash() == voteOld.GetHash());
+    BOOST_CHECK(manager.GetProposalVote(voteReplaced.GetHash(), voteFound));
+
+    // a vote that was replaced is not served any more
+    CBudgetProposal* pproposal = manager.FindProposal(uint256::ONE);
+    BOOST_REQUIRE(pproposal);
+    CBudgetVote voteChanged = MakeVote(2, VOTE_NO, GetTime());
+    BOOST_CHECK(pproposal->AddOrUpdateVote(voteChanged, strError));
+    BOOST_CHECK(!manager.GetProposalVote(voteReplaced.GetHash(), voteFound));
+    BOOST_CHECK(!manager.GetProposalVote(InsecureRand256(), voteFound));
+
+    SetMockTime(0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -2,6 +2,7 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <chainparams.h>
 #include <crypto/aes.h>
 #include <crypto/chacha20.h>
 #include <crypto/chacha_poly_aead.h>
@@ -10,11 +11,13 @@
 #include <crypto/hmac_sha512.h>
 #include <crypto/poly1305.h>
 #include <crypto/ripemd160.h>
+#include <crypto/scrypt.h>
 #include <crypto/sha1.h>
 #include <crypto/sha256.h>
 #include <crypto/sha3.h>
 #include <crypto/sha512.h>
 #include <crypto/muhash.h>
+#include <primitives/block.h>
 #include <random.h>
 #include <streams.h>
 #include <test/util/setup_common.h>
@@ -753,6 +756,26 @@ BOOST_AUTO_TEST_CASE(sha256d64)
     }
 }
 
+BOOST_AUTO_TEST_CASE(scrypt_batch)
+{
+    for (int i = 0; i <= 17; ++i) {
+        char in[80 * 17];
+        char out1[32 * 17], out2[32 * 17];
+        for (int j = 0; j < 80 * i; ++j) {
+            in[j] = InsecureRandBits(8);
+        }
+        for (int j = 0; j < i; ++j) {
+            scrypt_1024_1_1_256(in + 80 * j, out1 + 32 * j);
+        }
+        scrypt_1024_1_1_256_batch(in, out2, i);
+        BOOST_CHECK(memcmp(out1, out2, 32 * i) == 0);
+    }
+
+    // version 1 block hashes are scrypt hashes
+    const CBlock& genesis = Params().GenesisBlock();
+    BOOST_CHECK_EQUAL(GetPoWHashes({genesis.GetBlockHeader()}).at(0), Params().GetConsensus().hashGenesisBlock);
+}
+
 static void TestSHA3_256(const std::string& input, const std::string& output)
 {
     const auto in_bytes = ParseHex(input);
@@ -139,6 +139,7 @@ const std::vector<std::string> RPC_COMMANDS_SAFE_FOR_FUZZING{
     "getrawmempool",
     "getrawtransaction",
     "getrpcinfo",
+    "getstakingmetrics",
     "gettxout",
     "gettxoutsetinfo",
     "help",
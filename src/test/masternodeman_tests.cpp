@@ -0,0 +1,132 @@
+// Copyright (c) 2022 The Myce Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <clientversion.h>
+#include <key.h>
+#include <masternode/masternode.h>
+#include <masternode/masternodeman.h>
+#include <masternode/mncachedb.h>
+#include <script/standard.h>
+#include <streams.h>
+#include <test/util/setup_common.h>
+#include <util/time.h>
+#include <version.h>
+
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(masternodeman_tests, BasicTestingSetup)
+
+static CMasternode MakeMasternode()
+{
+    CKey keyCollateral, keyMasternode;
+    keyCollateral.MakeNewKey(true);
+    keyMasternode.MakeNewKey(true);
+
+    const int64_t nNow = TicksSinceEpoch<std::chrono::seconds>(GetAdjustedTime());
+    CMasternode mn;
+    mn.vin = CTxIn(InsecureRand256(), InsecureRandRange(4));
+    mn.pubKeyCollateralAddress = keyCollateral.GetPubKey();
+    mn.pubKeyMasternode = keyMasternode.GetPubKey();
+    mn.protocolVersion = PROTOCOL_VERSION;
+    mn.unitTest = true;
+    mn.sigTime = nNow - 2 * MASTERNODE_MIN_MNP_SECONDS;
+    mn.lastPing.vin = mn.vin;
+    mn.lastPing.blockHash = InsecureRand256();
+    mn.lastPing.sigTime = nNow;
+    return mn;
+}
+
+/** Check every lookup of the list against a scan of vAll, which also holds masternodes that were removed */
+static void CheckIndexes(CMasternodeMan& man, const std::vector<CMasternode>& vAll)
+{
+    const std::vector<CMasternode> vList = man.GetFullMasternodeVector();
+    BOOST_CHECK_EQUAL(man.size(), (int)vList.size());
+    for (const CMasternode& mn : vAll) {
+        const CScript payee = GetScriptForDestination(PKHash(mn.pubKeyCollateralAddress));
+        const CMasternode* pmnExpected = nullptr;
+        for (const CMasternode& mnList : vList) {
+            if (mnList.vin.prevout == mn.vin.prevout) {
+                pmnExpected = &mnList;
+                break;
+            }
+        }
+
+        CMasternode* pmnByVin = man.Find(mn.vin);
+        CMasternode* pmnByPubKey = man.Find(mn.pubKeyMasternode);
+        CMasternode* pmnByPayee = man.Find(payee);
+        if (!pmnExpected) {
+            BOOST_CHECK(!pmnByVin);
+            BOOST_CHECK(!pmnByPubKey);
+            BOOST_CHECK(!pmnByPayee);
+            continue;
+        }
+        BOOST_REQUIRE(pmnByVin && pmnByPubKey && pmnByPayee);
+        BOOST_CHECK(pmnByVin->vin == mn.vin);
+        BOOST_CHECK(pmnByVin->pubKeyMasternode == pmnExpected->pubKeyMasternode);
+        BOOST_CHECK(pmnByPubKey == pmnByVin);
+        BOOST_CHECK(pmnByPayee == pmnByVin);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(masternodeman_indexes)
+{
+    CMasternodeMan man;
+    std::vector<CMasternode> vAll;
+    for (int i = 0; i < 60; i++) {
+        vAll.push_back(MakeMasternode());
+        BOOST_CHECK(man.Add(vAll.back()));
+    }
+    // a masternode already in the list is not added again
+    BOOST_CHECK(!man.Add(vAll.front()));
+    CheckIndexes(man, vAll);
+
+    // removing one at a time moves the masternodes behind it
+    for (int i = 0; i < 15; i++) {
+        man.Remove(vAll[InsecureRandRange(vAll.size())].vin);
+        CheckIndexes(man, vAll);
+    }
+
+    // removing several at once, from anywhere in the list
+    const int nBefore = man.size();
+    int nOutdated = 0;
+    for (const CMasternode& mn : vAll) {
+        CMasternode* pmn = man.Find(mn.vin);
+        if (pmn && InsecureRandBool()) {
+            pmn->protocolVersion = PROTOCOL_VERSION - 2;
+            nOutdated++;
+        }
+    }
+    man.CheckAndRemove();
+    BOOST_CHECK_EQUAL(man.size(), nBefore - nOutdated);
+    for (const CMasternode& mn : man.GetFullMasternodeVector()) {
+        BOOST_CHECK_EQUAL(mn.protocolVersion, PROTOCOL_VERSION);
+    }
+    CheckIndexes(man, vAll);
+
+    for (int i = 0; i < 10; i++) {
+        vAll.push_back(MakeMasternode());
+        BOOST_CHECK(man.Add(vAll.back()));
+    }
+    CheckIndexes(man, vAll);
+
+    // the indexes are rebuilt when the list is read back
+    CMasternodeCacheDB db(1 << 20, true);
+    BOOST_CHECK(man.FlushCache(db));
+    CMasternodeMan manLoaded;
+    BOOST_CHECK(manLoaded.LoadCache(db));
+    CheckIndexes(manLoaded, vAll);
+
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << man;
+    CMasternodeMan manRead;
+    ss >> manRead;
+    CheckIndexes(manRead, vAll);
+
+    man.Clear();
+    CheckIndexes(man, vAll);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,312 @@
+// Copyright (c) 2022 The Myce Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <clientversion.h>
+#include <key.h>
+#include <masternode/init.h>
+#include <masternode/masternode-payments.h>
+#include <masternode/masternode.h>
+#include <masternode/masternodeman.h>
+#include <masternode/messagequeue.h>
+#include <net.h>
+#include <protocol.h>
+#include <script/standard.h>
+#include <streams.h>
+#include <sync.h>
+#include <test/util/setup_common.h>
+#include <util/time.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+/** Queue that records the messages instead of handling them, and can hold up its workers */
+class CTestMessageQueue : public CMasternodeMessageQueue
+{
+public:
+    struct Handled {
+        NodeId nodeid;
+        std::string strCommand;
+        int n;
+        std::thread::id thread;
+    };
+
+    Mutex m_handled_mutex;
+    std::condition_variable m_handled_cv;
+    std::vector<Handled> vHandled GUARDED_BY(m_handled_mutex);
+    //! workers wait in the handler while this is set
+    bool fHold GUARDED_BY(m_handled_mutex){false};
+    //! handlers running at once per command
+    std::map<std::string, std::atomic<int>> mapRunning;
+    std::atomic<bool> fOverlap{false};
+
+    CTestMessageQueue()
+    {
+        mapRunning[NetMsgType::SPORK] = 0;
+        mapRunning[NetMsgType::SYNCSTATUSCOUNT] = 0;
+        mapRunning[NetMsgType::DSEG] = 0;
+    }
+
+    void SetHold(bool fHoldIn)
+    {
+        WITH_LOCK(m_handled_mutex, fHold = fHoldIn);
+        m_handled_cv.notify_all();
+    }
+
+    size_t CountHandled()
+    {
+        LOCK(m_handled_mutex);
+        return vHandled.size();
+    }
+
+    /** Wait until nCount messages were handled, or some time passed */
+    bool WaitHandled(size_t nCount)
+    {
+        WAIT_LOCK(m_handled_mutex, lock);
+        return m_handled_cv.wait_for(lock, std::chrono::seconds{30}, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_handled_mutex) { return vHandled.size() >= nCount; });
+    }
+
+protected:
+    void ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman* connman) override
+    {
+        // messages of a group are handled one at a time, the test commands are in different groups
+        if (++mapRunning.at(strCommand) > 1)
+            fOverlap = true;
+
+        int n;
+        vRecv >> n;
+        {
+            WAIT_LOCK(m_handled_mutex, lock);
+            vHandled.push_back({pfrom->GetId(), strCommand, n, std::this_thread::get_id()});
+            m_handled_cv.notify_all();
+            m_handled_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_handled_mutex) { return !fHold; });
+        }
+        --mapRunning.at(strCommand);
+    }
+};
+
+/** Queue that adds broadcasts to the masternode list and checks winners against it, so that both groups use mnodeman at once */
+class CMasternodeListQueue : public CMasternodeMessageQueue
+{
+public:
+    std::atomic<int> nBroadcasts{0};
+    std::atomic<int> nWinners{0};
+    std::atomic<int> nValidWinners{0};
+
+protected:
+    void ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman* connman) override
+    {
+        if (strCommand == NetMsgType::MNBROADCAST) {
+            CMasternodeBroadcast mnb;
+            vRecv >> mnb;
+            // grows the list, which moves its entries
+            CMasternode mn(mnb);
+            mnodeman.Add(mn);
+            nBroadcasts++;
+        } else if (strCommand == NetMsgType::MNWINNER) {
+            CMasternodePaymentWinner winner;
+            vRecv >> winner;
+            if (winner.SignatureValid())
+                nValidWinners++;
+            nWinners++;
+        }
+    }
+};
+
+std::unique_ptr<CNode> MakeNode(NodeId id)
+{
+    return std::make_unique<CNode>(id,
+                                   /*sock=*/nullptr,
+                                   CAddress(CService(CNetAddr(), 7777), NODE_NETWORK),
+                                   /*nKeyedNetGroupIn=*/0,
+                                   /*nLocalHostNonceIn=*/0,
+                                   CAddress(),
+                                   /*pszDest=*/"",
+                                   ConnectionType::INBOUND,
+                                   /*inbound_onion=*/false);
+}
+
+bool PushMessage(CTestMessageQueue& queue, CNode& node, const std::string& strCommand, int n)
+{
+    CDataStream vRecv(SER_NETWORK, PROTOCOL_VERSION);
+    vRecv << n;
+    return queue.Push(&node, strCommand, vRecv, nullptr);
+}
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(messagequeue_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(messagequeue_order)
+{
+    CTestMessageQueue queue;
+    std::vector<std::unique_ptr<CNode>> vNodes;
+    for (NodeId id = 0; id < 4; id++) {
+        vNodes.push_back(MakeNode(id));
+    }
+
+    const std::vector<std::string> vCommands{NetMsgType::SPORK, NetMsgType::SYNCSTATUSCOUNT, NetMsgType::DSEG};
+    const int nMessages = 200;
+    queue.StartWorkerThreads(3);
+    for (int n = 0; n < nMessages; n++) {
+        for (const auto& pnode : vNodes) {
+            for (const std::string& strCommand : vCommands) {
+                BOOST_CHECK(PushMessage(queue, *pnode, strCommand, n));
+            }
+        }
+    }
+    const size_t nTotal = nMessages * vNodes.size() * vCommands.size();
+    BOOST_CHECK(queue.WaitHandled(nTotal));
+    queue.StopWorkerThreads();
+
+    // every message was handled once, in the order each peer sent the messages of a group
+    std::map<std::pair<NodeId, std::string>, int> mapNext;
+    {
+        LOCK(queue.m_handled_mutex);
+        BOOST_CHECK_EQUAL(queue.vHandled.size(), nTotal);
+        for (const CTestMessageQueue::Handled& handled : queue.vHandled) {
+            int& nNext = mapNext[std::make_pair(handled.nodeid, handled.strCommand)];
+            BOOST_CHECK_EQUAL(handled.n, nNext);
+            nNext++;
+            BOOST_CHECK(handled.thread != std::this_thread::get_id());
+        }
+    }
+    BOOST_CHECK_EQUAL(mapNext.size(), vNodes.size() * vCommands.size());
+    BOOST_CHECK(!queue.fOverlap);
+    BOOST_CHECK_EQUAL(queue.size(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(messagequeue_peer_limit)
+{
+    CTestMessageQueue queue;
+    std::unique_ptr<CNode> pnode = MakeNode(0);
+    std::unique_ptr<CNode> pnodeOther = MakeNode(1);
+
+    // hold the worker in the handler of the first message, so that the group stays busy
+    queue.SetHold(true);
+    queue.StartWorkerThreads(2);
+    BOOST_CHECK(PushMessage(queue, *pnode, NetMsgType::SPORK, 0));
+    BOOST_CHECK(queue.WaitHandled(1));
+
+    // the peer is full once it has the limit queued, other peers are not
+    for (size_t n = 1; n <= MAX_MASTERNODE_MESSAGES_PER_PEER; n++) {
+        BOOST_CHECK(!queue.IsPeerFull(pnode->GetId()));
+        BOOST_CHECK(PushMessage(queue, *pnode, NetMsgType::SPORK, n));
+    }
+    BOOST_CHECK(queue.IsPeerFull(pnode->GetId()));
+    BOOST_CHECK(!queue.IsPeerFull(pnodeOther->GetId()));
+
+    // messages of a full peer are still queued, the caller is only meant to stop reading them
+    BOOST_CHECK(PushMessage(queue, *pnode, NetMsgType::SPORK, MAX_MASTERNODE_MESSAGES_PER_PEER + 1));
+    BOOST_CHECK(PushMessage(queue, *pnodeOther, NetMsgType::SPORK, 0));
+    BOOST_CHECK(PushMessage(queue, *pnode, NetMsgType::SYNCSTATUSCOUNT, 0));
+    BOOST_CHECK(queue.WaitHandled(2));
+    BOOST_CHECK_EQUAL(queue.size(), MAX_MASTERNODE_MESSAGES_PER_PEER + 2);
+
+    queue.SetHold(false);
+    BOOST_CHECK(queue.WaitHandled(MAX_MASTERNODE_MESSAGES_PER_PEER + 4));
+    BOOST_CHECK(!queue.IsPeerFull(pnode->GetId()));
+    queue.StopWorkerThreads();
+    {
+        LOCK(queue.m_handled_mutex);
+        BOOST_CHECK_EQUAL(queue.vHandled.size(), MAX_MASTERNODE_MESSAGES_PER_PEER + 4);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(messagequeue_inline)
+{
+    CTestMessageQueue queue;
+    std::unique_ptr<CNode> pnode = MakeNode(0);
+
+    // without workers messages are handled right away on the caller's thread, without a limit
+    for (size_t n = 0; n <= MAX_MASTERNODE_MESSAGES_PER_PEER; n++) {
+        BOOST_CHECK(PushMessage(queue, *pnode, NetMsgType::SPORK, n));
+        BOOST_CHECK_EQUAL(queue.CountHandled(), n + 1);
+    }
+    {
+        LOCK(queue.m_handled_mutex);
+        BOOST_CHECK(queue.vHandled.back().thread == std::this_thread::get_id());
+    }
+    BOOST_CHECK_EQUAL(queue.size(), 0U);
+
+    // messages of disconnected peers and other commands are not handled
+    pnode->fDisconnect = true;
+    BOOST_CHECK(PushMessage(queue, *pnode, NetMsgType::SPORK, 0));
+    BOOST_CHECK(!PushMessage(queue, *pnode, NetMsgType::TX, 0));
+    BOOST_CHECK_EQUAL(queue.CountHandled(), MAX_MASTERNODE_MESSAGES_PER_PEER + 1);
+}
+
+BOOST_AUTO_TEST_CASE(messagequeue_list_and_payments)
+{
+    // masternodes that sign the winners, known before the traffic starts
+    std::vector<CKey> vKeys;
+    std::vector<CTxIn> vVins;
+    for (int i = 0; i < 10; i++) {
+        CKey key;
+        key.MakeNewKey(true);
+        CMasternode mn;
+        mn.vin = CTxIn(InsecureRand256(), 0);
+        mn.pubKeyMasternode = key.GetPubKey();
+        mn.protocolVersion = PROTOCOL_VERSION;
+        mn.unitTest = true;
+        BOOST_CHECK(mnodeman.Add(mn));
+        vKeys.push_back(key);
+        vVins.push_back(mn.vin);
+    }
+
+    CMasternodeListQueue queue;
+    std::vector<std::unique_ptr<CNode>> vNodes;
+    for (NodeId id = 0; id < 4; id++) {
+        vNodes.push_back(MakeNode(id));
+    }
+
+    // the list and payments groups are handled by different workers at the same time
+    const int nMessages = 200;
+    queue.StartWorkerThreads(2);
+    for (int n = 0; n < nMessages; n++) {
+        for (const auto& pnode : vNodes) {
+            CKey keyMasternode;
+            keyMasternode.MakeNewKey(true);
+            CMasternodeBroadcast mnb;
+            mnb.vin = CTxIn(InsecureRand256(), 0);
+            mnb.pubKeyMasternode = keyMasternode.GetPubKey();
+            mnb.protocolVersion = PROTOCOL_VERSION;
+            CDataStream vBroadcast(SER_NETWORK, PROTOCOL_VERSION);
+            vBroadcast << mnb;
+            BOOST_CHECK(queue.Push(pnode.get(), NetMsgType::MNBROADCAST, vBroadcast, nullptr));
+
+            const size_t i = InsecureRandRange(vKeys.size());
+            CPubKey pubKeyMasternode = vKeys[i].GetPubKey();
+            CMasternodePaymentWinner winner(vVins[i]);
+            winner.nBlockHeight = n;
+            winner.AddPayee(GetScriptForDestination(PKHash(pubKeyMasternode)));
+            BOOST_CHECK(winner.Sign(vKeys[i], pubKeyMasternode));
+            CDataStream vWinner(SER_NETWORK, PROTOCOL_VERSION);
+            vWinner << winner;
+            BOOST_CHECK(queue.Push(pnode.get(), NetMsgType::MNWINNER, vWinner, nullptr));
+        }
+    }
+
+    const int nTotal = nMessages * vNodes.size();
+    for (int i = 0; i < 3000 && (queue.nBroadcasts < nTotal || queue.nWinners < nTotal); i++) {
+        UninterruptibleSleep(std::chrono::milliseconds{10});
+    }
+    queue.StopWorkerThreads();
+
+    // every winner was checked against the key of its masternode while the list grew
+    BOOST_CHECK_EQUAL(queue.nBroadcasts, nTotal);
+    BOOST_CHECK_EQUAL(queue.nWinners, nTotal);
+    BOOST_CHECK_EQUAL(queue.nValidWinners, nTotal);
+    BOOST_CHECK_EQUAL(mnodeman.size(), nTotal + (int)vKeys.size());
+    mnodeman.Clear();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
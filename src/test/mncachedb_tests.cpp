@@ -0,0 +1,123 @@
+// Copyright (c) 2022 The Myce Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <masternode/mncachedb.h>
+#include <test/util/setup_common.h>
+
+#include <map>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(mncachedb_tests, BasicTestingSetup)
+
+static std::map<uint256, int> ReadRecords(CMasternodeCacheRecords<uint256>& records)
+{
+    std::map<uint256, int> mapRead;
+    BOOST_CHECK(records.Read<int>([&](const uint256& hash, int n) { mapRead.emplace(hash, n); }));
+    return mapRead;
+}
+
+BOOST_AUTO_TEST_CASE(mncachedb_delta_write)
+{
+    CMasternodeCacheDB db(1 << 20, true);
+    std::map<uint256, int> mapRecords;
+    for (int i = 0; i < 20; i++) {
+        mapRecords.emplace(InsecureRand256(), i);
+    }
+
+    // a new change set writes every record
+    CMasternodeCacheChanges<uint256> changes;
+    {
+        CDBBatch batch(db);
+        db.paymentVotes.Write(batch, mapRecords, changes);
+        BOOST_CHECK(db.WriteCacheBatch(batch));
+    }
+    BOOST_CHECK(!changes.IsAll());
+    BOOST_CHECK(ReadRecords(db.paymentVotes) == mapRecords);
+
+    // change, erase and add one record each
+    auto it = mapRecords.begin();
+    const uint256 hashChanged = it->first;
+    it->second = 100;
+    ++it;
+    const uint256 hashErased = it->first;
+    mapRecords.erase(it);
+    const uint256 hashAdded = InsecureRand256();
+    mapRecords.emplace(hashAdded, 200);
+    changes.Set(hashChanged);
+    changes.Set(hashErased);
+    changes.Set(hashAdded);
+
+    // a record that did not change is not written again, even if the database differs
+    const uint256 hashUnchanged = mapRecords.rbegin()->first;
+    BOOST_CHECK(db.Write(std::make_pair(uint8_t{'w'}, hashUnchanged), -1));
+    {
+        CDBBatch batch(db);
+        db.paymentVotes.Write(batch, mapRecords, changes);
+        BOOST_CHECK(db.WriteCacheBatch(batch));
+    }
+    BOOST_CHECK(changes.GetKeys().empty());
+    std::map<uint256, int> mapRead = ReadRecords(db.paymentVotes);
+    BOOST_CHECK_EQUAL(mapRead.size(), mapRecords.size());
+    BOOST_CHECK_EQUAL(mapRead[hashChanged], 100);
+    BOOST_CHECK_EQUAL(mapRead[hashAdded], 200);
+    BOOST_CHECK(!mapRead.count(hashErased));
+    BOOST_CHECK_EQUAL(mapRead[hashUnchanged], -1);
+
+    // after a reset every record is written and records the map doesn't have are erased
+    const uint256 hashStray = InsecureRand256();
+    BOOST_CHECK(db.Write(std::make_pair(uint8_t{'w'}, hashStray), 300));
+    db.paymentVotes.Reset();
+    {
+        CDBBatch batch(db);
+        db.paymentVotes.Write(batch, mapRecords, changes);
+        BOOST_CHECK(db.WriteCacheBatch(batch));
+    }
+    BOOST_CHECK(ReadRecords(db.paymentVotes) == mapRecords);
+
+    // replacing the map as a whole erases what is gone
+    mapRecords.clear();
+    mapRecords.emplace(hashAdded, 400);
+    changes.SetAll();
+    {
+        CDBBatch batch(db);
+        db.paymentVotes.Write(batch, mapRecords, changes);
+        BOOST_CHECK(db.WriteCacheBatch(batch));
+    }
+    BOOST_CHECK(ReadRecords(db.paymentVotes) == mapRecords);
+
+    // the other records are left alone
+    BOOST_CHECK(ReadRecords(db.seenPings).empty());
+}
+
+BOOST_AUTO_TEST_CASE(mncachedb_state_records)
+{
+    CMasternodeCacheDB db(1 << 20, true);
+    CMasternodeCacheChanges<uint8_t> changes;
+    {
+        CDBBatch batch(db);
+        db.masternodeState.Write(batch, 'a', 1, changes);
+        db.masternodeState.Write(batch, 'd', int64_t{2}, changes);
+        db.masternodeState.Finish(changes);
+        BOOST_CHECK(db.WriteCacheBatch(batch));
+    }
+
+    // only the changed state is written
+    changes.Set('d');
+    {
+        CDBBatch batch(db);
+        db.masternodeState.Write(batch, 'a', 10, changes);
+        db.masternodeState.Write(batch, 'd', int64_t{20}, changes);
+        db.masternodeState.Finish(changes);
+        BOOST_CHECK(db.WriteCacheBatch(batch));
+    }
+    int n;
+    int64_t nDsqCount;
+    BOOST_CHECK(db.masternodeState.Read('a', n));
+    BOOST_CHECK(db.masternodeState.Read('d', nDsqCount));
+    BOOST_CHECK_EQUAL(n, 1);
+    BOOST_CHECK_EQUAL(nDsqCount, 20);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
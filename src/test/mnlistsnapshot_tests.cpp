@@ -0,0 +1,100 @@
+// Copyright (c) 2022 The Myce Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <clientversion.h>
+#include <key.h>
+#include <masternode/masternode-sync.h>
+#include <masternode/masternodeman.h>
+#include <streams.h>
+#include <sync.h>
+#include <test/util/setup_common.h>
+#include <version.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(mnlistsnapshot_tests, BasicTestingSetup)
+
+static CMasternodeBroadcast MakeBroadcast(int n)
+{
+    CKey keyCollateral, keyMasternode;
+    keyCollateral.MakeNewKey(true);
+    keyMasternode.MakeNewKey(true);
+
+    CMasternodeBroadcast mnb;
+    mnb.vin = CTxIn(InsecureRand256(), n);
+    mnb.addr = CService(CNetAddr(in_addr{htonl(0x01020304 + n)}), 23511);
+    mnb.pubKeyCollateralAddress = keyCollateral.GetPubKey();
+    mnb.pubKeyMasternode = keyMasternode.GetPubKey();
+    mnb.sig = std::vector<unsigned char>(65, n);
+    mnb.sigTime = 1600000000 + n;
+    mnb.protocolVersion = PROTOCOL_VERSION;
+    mnb.lastPing.vin = mnb.vin;
+    mnb.lastPing.blockHash = InsecureRand256();
+    mnb.lastPing.sigTime = mnb.sigTime + 60;
+    mnb.lastPing.vchSig = std::vector<unsigned char>(65, n + 1);
+    mnb.nLastDsq = 7;
+    return mnb;
+}
+
+BOOST_AUTO_TEST_CASE(mnlistsnapshot_roundtrip)
+{
+    CMasternodeListSnapshot snapshot;
+    snapshot.nHeight = 1234;
+    snapshot.hashBlock = InsecureRand256();
+    snapshot.nParts = 1;
+    for (int i = 0; i < 10; i++) {
+        snapshot.vBroadcasts.push_back(MakeBroadcast(i));
+    }
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << snapshot;
+
+    // smaller than the broadcasts sent one by one
+    CDataStream ssFull(SER_NETWORK, PROTOCOL_VERSION);
+    ssFull << snapshot.vBroadcasts;
+    BOOST_CHECK_LT(ss.size(), ssFull.size());
+
+    CMasternodeListSnapshot snapshotRead;
+    ss >> snapshotRead;
+    BOOST_CHECK_EQUAL(snapshotRead.nHeight, 1234);
+    BOOST_CHECK(snapshotRead.hashBlock == snapshot.hashBlock);
+    BOOST_REQUIRE_EQUAL(snapshotRead.vBroadcasts.size(), 10U);
+    for (size_t i = 0; i < snapshot.vBroadcasts.size(); i++) {
+        CMasternodeBroadcast& mnb = snapshot.vBroadcasts[i];
+        CMasternodeBroadcast& mnbRead = snapshotRead.vBroadcasts[i];
+        BOOST_CHECK(mnbRead.GetHash() == mnb.GetHash());
+        BOOST_CHECK(mnbRead.vin == mnb.vin);
+        BOOST_CHECK(mnbRead.addr == mnb.addr);
+        BOOST_CHECK(mnbRead.pubKeyMasternode == mnb.pubKeyMasternode);
+        BOOST_CHECK(mnbRead.sig == mnb.sig);
+        BOOST_CHECK_EQUAL(mnbRead.protocolVersion, mnb.protocolVersion);
+        // the ping gets its outpoint back from the broadcast
+        BOOST_CHECK(mnbRead.lastPing.GetHash() == mnb.lastPing.GetHash());
+        BOOST_CHECK(mnbRead.lastPing.vchSig == mnb.lastPing.vchSig);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(mnlistsnapshot_sync_peers)
+{
+    CMasternodeSync sync;
+
+    // snapshots only count while the list is being synced
+    sync.AddedMasternodeListSnapshot(1);
+    BOOST_CHECK(WITH_LOCK(sync.cs, return sync.setMasternodeListSnapshotPeers.empty()));
+
+    // a peer repeating its snapshot is still one peer
+    sync.RequestedMasternodeAssets = MASTERNODE_SYNC_LIST;
+    for (int i = 0; i < MASTERNODE_SYNC_THRESHOLD * 2; i++) {
+        sync.AddedMasternodeListSnapshot(1);
+    }
+    BOOST_CHECK_EQUAL(WITH_LOCK(sync.cs, return sync.setMasternodeListSnapshotPeers.size()), 1U);
+
+    sync.AddedMasternodeListSnapshot(2);
+    BOOST_CHECK_EQUAL(WITH_LOCK(sync.cs, return sync.setMasternodeListSnapshotPeers.size()), 2U);
+
+    sync.Reset();
+    BOOST_CHECK(WITH_LOCK(sync.cs, return sync.setMasternodeListSnapshotPeers.empty()));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,306 @@
+// Copyright (c) 2022 The Myce Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chain.h>
+#include <clientversion.h>
+#include <masternode/init.h>
+#include <masternode/masternode-payments.h>
+#include <masternode/masternode-sync.h>
+#include <masternode/masternode.h>
+#include <masternode/masternodeman.h>
+#include <masternode/mncachedb.h>
+#include <net.h>
+#include <protocol.h>
+#include <script/standard.h>
+#include <streams.h>
+#include <test/util/setup_common.h>
+#include <util/time.h>
+#include <validation.h>
+#include <version.h>
+
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <memory>
+#include <set>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+/** Node with a chain of empty block indexes on top of genesis, so that the payments manager sees a tip */
+struct PaymentsTestingSetup : public TestingSetup {
+    std::vector<uint256> vHashes;
+    std::vector<std::unique_ptr<CBlockIndex>> vBlocks;
+
+    explicit PaymentsTestingSetup(int nHeight = 3000)
+    {
+        LOCK(cs_main);
+        CBlockIndex* pindexPrev = m_node.chainman->ActiveChain().Genesis();
+        vHashes.reserve(nHeight);
+        for (int i = 1; i <= nHeight; i++) {
+            vHashes.push_back(InsecureRand256());
+            auto pindex = std::make_unique<CBlockIndex>();
+            pindex->phashBlock = &vHashes.back();
+            pindex->pprev = pindexPrev;
+            pindex->nHeight = i;
+            pindex->BuildSkip();
+            pindexPrev = pindex.get();
+            vBlocks.push_back(std::move(pindex));
+        }
+    }
+
+    ~PaymentsTestingSetup()
+    {
+        LOCK(cs_main);
+        m_node.chainman->ActiveChain().SetTip(*m_node.chainman->ActiveChain().Genesis());
+    }
+
+    void SetTip(int nHeight)
+    {
+        LOCK(cs_main);
+        m_node.chainman->ActiveChain().SetTip(*vBlocks[nHeight - 1]);
+    }
+};
+
+std::vector<CScript> MakePayees(int nCount)
+{
+    std::vector<CScript> vPayees;
+    for (int i = 0; i < nCount; i++) {
+        vPayees.push_back(GetScriptForDestination(PKHash(uint160(g_insecure_rand_ctx.randbytes(20)))));
+    }
+    return vPayees;
+}
+
+/** Vote for random payees at random heights in [nMinHeight, nMaxHeight] */
+void AddVotes(CMasternodePayments& payments, const std::vector<CScript>& vPayees, int nVotes, int nMinHeight, int nMaxHeight)
+{
+    std::vector<CTxIn> vVins;
+    for (int i = 0; i < 8; i++) {
+        vVins.push_back(CTxIn(InsecureRand256(), i));
+    }
+
+    for (int i = 0; i < nVotes; i++) {
+        CMasternodePaymentWinner winner(vVins[InsecureRandRange(vVins.size())]);
+        winner.nBlockHeight = nMinHeight + InsecureRandRange(nMaxHeight - nMinHeight + 1);
+        winner.AddPayee(vPayees[InsecureRandRange(vPayees.size())]);
+        const bool fNew = !payments.mapMasternodePayeeVotes.count(winner.GetHash());
+        BOOST_CHECK_EQUAL(payments.AddWinningMasternode(winner), fNew);
+    }
+}
+
+/** Highest height in [nMinHeight, nMaxHeight] where payee has enough votes, found by scanning every block */
+int FindLastPaidHeight(CMasternodePayments& payments, const CScript& payee, int nMinHeight, int nMaxHeight)
+{
+    for (auto it = payments.mapMasternodeBlocks.rbegin(); it != payments.mapMasternodeBlocks.rend(); ++it) {
+        if (it->first >= nMinHeight && it->first <= nMaxHeight && it->second.HasPayeeWithVotes(payee, MNPAYMENTS_PAID_VOTES))
+            return it->first;
+    }
+    return 0;
+}
+
+std::set<int> GetBlockHeights(const CMasternodePayments& payments)
+{
+    std::set<int> setHeights;
+    for (const auto& item : payments.mapMasternodeBlocks) {
+        setHeights.insert(item.first);
+    }
+    return setHeights;
+}
+
+void CheckPaidHeights(CMasternodePayments& payments, const std::vector<CScript>& vPayees)
+{
+    int nPaid = 0;
+    for (const CScript& payee : vPayees) {
+        for (int i = 0; i < 100; i++) {
+            const int nMinHeight = InsecureRandRange(3200);
+            const int nMaxHeight = nMinHeight + InsecureRandRange(600);
+            const int nExpected = FindLastPaidHeight(payments, payee, nMinHeight, nMaxHeight);
+            BOOST_CHECK_EQUAL(payments.GetLastPaidHeight(payee, nMinHeight, nMaxHeight), nExpected);
+            if (nExpected)
+                nPaid++;
+        }
+        BOOST_CHECK_EQUAL(payments.GetLastPaidHeight(payee, 0, std::numeric_limits<int>::max()), FindLastPaidHeight(payments, payee, 0, std::numeric_limits<int>::max()));
+    }
+    // the ranges are not all empty
+    BOOST_CHECK(nPaid > 0);
+
+    // payees without votes are never paid
+    BOOST_CHECK_EQUAL(payments.GetLastPaidHeight(MakePayees(1)[0], 0, std::numeric_limits<int>::max()), 0);
+}
+
+/** Add enabled masternodes to the global list, which bounds how far back Sync goes */
+void AddMasternodes(int nCount)
+{
+    const int64_t nNow = TicksSinceEpoch<std::chrono::seconds>(GetAdjustedTime());
+    for (int i = 0; i < nCount; i++) {
+        CMasternode mn;
+        mn.vin = CTxIn(InsecureRand256(), 0);
+        mn.protocolVersion = PROTOCOL_VERSION;
+        mn.unitTest = true;
+        mn.sigTime = nNow - 2 * MASTERNODE_MIN_MNP_SECONDS;
+        mn.lastPing.vin = mn.vin;
+        mn.lastPing.blockHash = InsecureRand256();
+        mn.lastPing.sigTime = nNow;
+        BOOST_CHECK(mnodeman.Add(mn));
+    }
+}
+
+/** Votes of mapVotes that pruning at nTip keeps */
+std::set<uint256> GetKeptVotes(const std::map<uint256, CMasternodePaymentWinner>& mapVotes, int nTip)
+{
+    std::set<uint256> setKept;
+    for (const auto& item : mapVotes) {
+        if (item.second.nBlockHeight >= nTip - 1000)
+            setKept.insert(item.first);
+    }
+    return setKept;
+}
+
+std::set<uint256> GetVotes(const CMasternodePayments& payments)
+{
+    std::set<uint256> setVotes;
+    for (const auto& item : payments.mapMasternodePayeeVotes) {
+        setVotes.insert(item.first);
+    }
+    return setVotes;
+}
+
+/** Check the votes Sync announces against a scan of every vote */
+void CheckSync(CMasternodePayments& payments, CConnman& connman, CNode& node, int nTip)
+{
+    std::vector<uint256> vAnnounced;
+    int nSyncCount = -1;
+    CaptureMessage = [&](const CAddress& addr, const std::string& msg_type, Span<const unsigned char> data, bool is_incoming) {
+        CDataStream ss(data, SER_NETWORK, PROTOCOL_VERSION);
+        if (msg_type == NetMsgType::INV) {
+            CInv inv;
+            ss >> inv;
+            BOOST_CHECK_EQUAL(inv.type, MSG_MASTERNODE_WINNER);
+            vAnnounced.push_back(inv.hash);
+        } else if (msg_type == NetMsgType::SYNCSTATUSCOUNT) {
+            int nItemID;
+            ss >> nItemID >> nSyncCount;
+            BOOST_CHECK_EQUAL(nItemID, MASTERNODE_SYNC_MNW);
+        }
+    };
+
+    const int nCountMax = mnodeman.CountEnabled() * 1.25;
+    for (int nCountNeeded : {0, 1, 25, nCountMax, nCountMax + 1, 1000}) {
+        vAnnounced.clear();
+        nSyncCount = -1;
+        payments.Sync(&node, nCountNeeded, &connman);
+
+        const int nMinHeight = nTip - std::min(nCountNeeded, nCountMax);
+        std::set<uint256> setExpected;
+        for (const auto& item : payments.mapMasternodePayeeVotes) {
+            if (item.second.nBlockHeight >= nMinHeight && item.second.nBlockHeight <= nTip + 20)
+                setExpected.insert(item.first);
+        }
+        if (nCountNeeded >= nCountMax)
+            BOOST_CHECK(!setExpected.empty());
+        BOOST_CHECK(std::set<uint256>(vAnnounced.begin(), vAnnounced.end()) == setExpected);
+        BOOST_CHECK_EQUAL(vAnnounced.size(), setExpected.size());
+        BOOST_CHECK_EQUAL(nSyncCount, (int)setExpected.size());
+    }
+    CaptureMessage = CaptureMessageToFile;
+}
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(mnpayments_tests, PaymentsTestingSetup)
+
+BOOST_AUTO_TEST_CASE(mnpayments_paid_heights)
+{
+    CMasternodePayments payments;
+    payments.Attach(m_node.chainman.get());
+    const std::vector<CScript> vPayees = MakePayees(6);
+
+    SetTip(2000);
+    AddVotes(payments, vPayees, 1500, 1000, 2100);
+    CheckPaidHeights(payments, vPayees);
+
+    // pruning drops the heights more than 1000 blocks below the tip from the index too
+    const std::set<int> setHeights = GetBlockHeights(payments);
+    SetTip(2600);
+    payments.CleanPaymentList();
+    BOOST_CHECK(GetBlockHeights(payments) == std::set<int>(setHeights.lower_bound(1600), setHeights.end()));
+    CheckPaidHeights(payments, vPayees);
+
+    AddVotes(payments, vPayees, 1500, 1600, 2700);
+    CheckPaidHeights(payments, vPayees);
+
+    // the index is rebuilt when the payments are read back
+    CMasternodeCacheDB db(1 << 20, true);
+    BOOST_CHECK(payments.FlushCache(db));
+    CMasternodePayments paymentsLoaded;
+    paymentsLoaded.Attach(m_node.chainman.get());
+    BOOST_CHECK(paymentsLoaded.LoadCache(db));
+    BOOST_CHECK_EQUAL(paymentsLoaded.mapMasternodeBlocks.size(), payments.mapMasternodeBlocks.size());
+    BOOST_CHECK_EQUAL(paymentsLoaded.mapMasternodePayeeVotes.size(), payments.mapMasternodePayeeVotes.size());
+    CheckPaidHeights(paymentsLoaded, vPayees);
+
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << payments;
+    CMasternodePayments paymentsRead;
+    ss >> paymentsRead;
+    BOOST_CHECK_EQUAL(paymentsRead.mapMasternodeBlocks.size(), payments.mapMasternodeBlocks.size());
+    CheckPaidHeights(paymentsRead, vPayees);
+}
+
+BOOST_AUTO_TEST_CASE(mnpayments_votes_by_height)
+{
+    CMasternodePayments payments;
+    payments.Attach(m_node.chainman.get());
+    const std::vector<CScript> vPayees = MakePayees(6);
+    AddMasternodes(40);
+    BOOST_CHECK_EQUAL(mnodeman.CountEnabled(), 40);
+
+    CNode node(/*id=*/0,
+               /*sock=*/nullptr,
+               CAddress(CService(CNetAddr(), 7777), NODE_NETWORK),
+               /*nKeyedNetGroupIn=*/0,
+               /*nLocalHostNonceIn=*/0,
+               CAddress(),
+               /*pszDest=*/"",
+               ConnectionType::INBOUND,
+               /*inbound_onion=*/false);
+    gArgs.ForceSetArg("-capturemessages", "1");
+
+    SetTip(2000);
+    AddVotes(payments, vPayees, 1500, 1000, 2100);
+    CheckSync(payments, *m_node.connman, node, 2000);
+
+    // pruning drops every vote more than 1000 blocks below the tip, and only those
+    std::map<uint256, CMasternodePaymentWinner> mapVotes = payments.mapMasternodePayeeVotes;
+    std::set<int> setHeights = GetBlockHeights(payments);
+    SetTip(2600);
+    payments.CleanPaymentList();
+    BOOST_CHECK(GetVotes(payments) == GetKeptVotes(mapVotes, 2600));
+    BOOST_CHECK(GetBlockHeights(payments) == std::set<int>(setHeights.lower_bound(1600), setHeights.end()));
+
+    AddVotes(payments, vPayees, 1500, 1600, 2700);
+    CheckSync(payments, *m_node.connman, node, 2600);
+
+    // the index is rebuilt when the votes are loaded, and prunes the same way afterwards
+    CMasternodeCacheDB db(1 << 20, true);
+    BOOST_CHECK(payments.FlushCache(db));
+    CMasternodePayments paymentsLoaded;
+    paymentsLoaded.Attach(m_node.chainman.get());
+    BOOST_CHECK(paymentsLoaded.LoadCache(db));
+    BOOST_CHECK(GetVotes(paymentsLoaded) == GetVotes(payments));
+    CheckSync(paymentsLoaded, *m_node.connman, node, 2600);
+
+    mapVotes = paymentsLoaded.mapMasternodePayeeVotes;
+    setHeights = GetBlockHeights(paymentsLoaded);
+    SetTip(2650);
+    paymentsLoaded.CleanPaymentList();
+    BOOST_CHECK(GetVotes(paymentsLoaded) == GetKeptVotes(mapVotes, 2650));
+    BOOST_CHECK(GetBlockHeights(paymentsLoaded) == std::set<int>(setHeights.lower_bound(1650), setHeights.end()));
+    CheckSync(paymentsLoaded, *m_node.connman, node, 2650);
+
+    gArgs.ForceSetArg("-capturemessages", "0");
+    mnodeman.Clear();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
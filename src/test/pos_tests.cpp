@@ -0,0 +1,383 @@
+// Copyright (c) 2022 The Myce Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chain.h>
+#include <chainparams.h>
+#include <hash.h>
+#include <pos/modifiercache.h>
+#include <pos/modifierindex.h>
+#include <pos/pos.h>
+#include <pos/stakesearch.h>
+#include <streams.h>
+#include <test/util/setup_common.h>
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(pos_tests, BasicTestingSetup)
+
+// Stake modifier computation as it was before the candidate window was
+// cached, used as the reference for the incremental implementation.
+namespace {
+struct ReferenceModifier {
+    std::map<uint256, const CBlockIndex*> mapBlockIndex;
+
+    static int64_t Section(int nSection)
+    {
+        return (int64_t) (Params().GetConsensus().nModifierInterval * 63 / (63 + ((63 - nSection) * (MODIFIER_INTERVAL_RATIO - 1))));
+    }
+
+    bool SelectBlock(std::vector<std::pair<int64_t, uint256>>& vSortedByTimestamp, std::map<uint256, const CBlockIndex*>& mapSelectedBlocks,
+                     int64_t nSelectionIntervalStop, uint64_t nStakeModifierPrev, const CBlockIndex** pindexSelected)
+    {
+        const Consensus::Params& params = Params().GetConsensus();
+        bool fModifierV2 = false;
+        bool fFirstRun = true;
+        bool fSelected = false;
+        arith_uint256 hashBest = arith_uint256();
+        *pindexSelected = nullptr;
+        for (const auto& item : vSortedByTimestamp) {
+            const CBlockIndex* pindex = mapBlockIndex.at(item.second);
+            if (fSelected && pindex->GetBlockTime() > nSelectionIntervalStop) break;
+            if (fFirstRun) {
+                fModifierV2 = pindex->nHeight >= params.nModifierUpgrade;
+                fFirstRun = false;
+            }
+            if (mapSelectedBlocks.count(pindex->GetBlockHash()) > 0) continue;
+            uint256 hashProof;
+            if (fModifierV2)
+                hashProof = pindex->GetBlockHash();
+            else
+                hashProof = pindex->IsProofOfStake() ? uint256() : pindex->GetBlockHash();
+            CDataStream ss(SER_GETHASH, 0);
+            ss << hashProof << nStakeModifierPrev;
+            arith_uint256 hashSelection = UintToArith256(Hash(ss));
+            if (pindex->IsProofOfStake()) hashSelection >>= 32;
+            if (fSelected && hashSelection < hashBest) {
+                hashBest = hashSelection;
+                *pindexSelected = pindex;
+            } else if (!fSelected) {
+                fSelected = true;
+                hashBest = hashSelection;
+                *pindexSelected = pindex;
+            }
+        }
+        return fSelected;
+    }
+
+    bool Compute(const CBlockIndex* pindexCurrent, uint64_t& nStakeModifier, bool& fGenerated)
+    {
+        const Consensus::Params& params = Params().GetConsensus();
+        const CBlockIndex* pindexPrev = pindexCurrent->pprev;
+        nStakeModifier = 0;
+        fGenerated = false;
+        if (!pindexPrev) {
+            fGenerated = true;
+            return true;
+        } else if (pindexPrev->nHeight == 0) {
+            fGenerated = true;
+            nStakeModifier = 0x7374616b656d6f64;
+            return true;
+        }
+
+        const CBlockIndex* pindex = pindexPrev;
+        while (pindex && pindex->pprev && !pindex->GeneratedStakeModifier()) pindex = pindex->pprev;
+        if (!pindex->GeneratedStakeModifier()) return false;
+        nStakeModifier = pindex->nStakeModifier;
+        int64_t nModifierTime = pindex->GetBlockTime();
+        if (nModifierTime / params.nModifierInterval >= pindexPrev->GetBlockTime() / params.nModifierInterval) return true;
+
+        std::vector<std::pair<int64_t, uint256>> vSortedByTimestamp;
+        int64_t nSelectionIntervalStart = (pindexPrev->GetBlockTime() / params.nModifierInterval) * params.nModifierInterval - GetStakeModifierSelectionInterval();
+        pindex = pindexPrev;
+        while (pindex && pindex->GetBlockTime() >= nSelectionIntervalStart) {
+            vSortedByTimestamp.emplace_back(pindex->GetBlockTime(), pindex->GetBlockHash());
+            pindex = pindex->pprev;
+        }
+        std::sort(vSortedByTimestamp.begin(), vSortedByTimestamp.end(), [](const std::pair<int64_t, uint256>& a, const std::pair<int64_t, uint256>& b) {
+            if (a.first != b.first) return a.first < b.first;
+            const uint32_t* pa = a.second.GetDataPtr();
+            const uint32_t* pb = b.second.GetDataPtr();
+            int cnt = 256 / 32;
+            do {
+                --cnt;
+                if (pa[cnt] != pb[cnt]) return pa[cnt] < pb[cnt];
+            } while (cnt);
+            return false;
+        });
+
+        uint64_t nStakeModifierNew = 0;
+        int64_t nSelectionIntervalStop = nSelectionIntervalStart;
+        std::map<uint256, const CBlockIndex*> mapSelectedBlocks;
+        for (int nRound = 0; nRound < std::min(64, (int)vSortedByTimestamp.size()); nRound++) {
+            nSelectionIntervalStop += Section(nRound);
+            if (!SelectBlock(vSortedByTimestamp, mapSelectedBlocks, nSelectionIntervalStop, nStakeModifier, &pindex)) return false;
+            nStakeModifierNew |= (((uint64_t)pindex->GetStakeEntropyBit()) << nRound);
+            mapSelectedBlocks.emplace(pindex->GetBlockHash(), pindex);
+        }
+        nStakeModifier = nStakeModifierNew;
+        fGenerated = true;
+        return true;
+    }
+};
+
+/** Synthetic chain with jittery, occasionally decreasing timestamps and mixed block types. */
+void BuildChain(std::vector<CBlockIndex>& vIndex, std::vector<uint256>& vHash, CBlockIndex* pindexFork, FastRandomContext& rng)
+{
+    for (size_t i = 0; i < vIndex.size(); i++) {
+        CBlockIndex& index = vIndex[i];
+        index.pprev = i == 0 ? pindexFork : &vIndex[i - 1];
+        index.nHeight = index.pprev ? index.pprev->nHeight + 1 : 0;
+        vHash[i] = rng.rand256();
+        index.phashBlock = &vHash[i];
+        index.nTime = index.pprev ? index.pprev->nTime + 1 + rng.randrange(128) - (rng.randrange(16) == 0 ? 100 : 0) : 1600000000;
+        index.nNonce = rng.randbool() ? 0 : 1 + rng.randrange(1000);
+        index.BuildSkip();
+    }
+}
+
+/** Random stake modifiers, generated in about one block out of eight */
+void SetModifiers(std::vector<CBlockIndex>& vIndex, FastRandomContext& rng)
+{
+    for (CBlockIndex& index : vIndex) {
+        index.SetStakeModifier(rng.rand64(), rng.randrange(8) == 0);
+    }
+}
+
+/** Kernel stake modifier found by walking the chain forward, as GetKernelStakeModifier does without the index */
+bool WalkKernelModifier(const CChain& chain, const CBlockIndex* pindexFrom, uint64_t& nStakeModifier, int& nStakeModifierHeight, int64_t& nStakeModifierTime)
+{
+    const int64_t nTimeNeeded = pindexFrom->GetBlockTime() + GetStakeModifierSelectionInterval();
+    for (int nHeight = pindexFrom->nHeight + 1; nHeight <= chain.Height(); nHeight++) {
+        const CBlockIndex* pindex = chain[nHeight];
+        if (pindex->GeneratedStakeModifier() && pindex->GetBlockTime() >= nTimeNeeded) {
+            nStakeModifier = pindex->nStakeModifier;
+            nStakeModifierHeight = pindex->nHeight;
+            nStakeModifierTime = pindex->GetBlockTime();
+            return true;
+        }
+    }
+    return false;
+}
+
+/** Check the index for every block of vIndex, blocks that are not on chain are never found. Returns the number found */
+int CheckModifierIndex(const CStakeModifierIndex& index, const CChain& chain, const std::vector<CBlockIndex>& vIndex)
+{
+    int nResolved = 0;
+    for (const CBlockIndex& block : vIndex) {
+        uint64_t nModifier = 0, nExpected = 0;
+        int nHeight = 0, nHeightExpected = 0;
+        int64_t nTime = 0, nTimeExpected = 0;
+        const bool fFound = index.Lookup(&block, nModifier, nHeight, nTime);
+        if (!chain.Contains(&block)) {
+            BOOST_CHECK(!fFound);
+            continue;
+        }
+        const bool fExpected = WalkKernelModifier(chain, &block, nExpected, nHeightExpected, nTimeExpected);
+        BOOST_CHECK_EQUAL(fFound, fExpected);
+        if (!fFound || !fExpected)
+            continue;
+        nResolved++;
+        BOOST_CHECK_EQUAL(nModifier, nExpected);
+        BOOST_CHECK_EQUAL(nHeight, nHeightExpected);
+        BOOST_CHECK_EQUAL(nTime, nTimeExpected);
+    }
+    return nResolved;
+}
+} // namespace
+
+BOOST_AUTO_TEST_CASE(stake_modifier_replay)
+{
+    FastRandomContext rng(true);
+    ReferenceModifier reference;
+    CStakeModifierCache cache;
+
+    auto replay = [&](std::vector<CBlockIndex>& vIndex, std::vector<uint256>& vHash) {
+        for (size_t i = 0; i < vIndex.size(); i++) {
+            reference.mapBlockIndex.emplace(vHash[i], &vIndex[i]);
+        }
+        for (CBlockIndex& index : vIndex) {
+            uint64_t nExpected, nModifier;
+            bool fExpected, fGenerated;
+            BOOST_CHECK(reference.Compute(&index, nExpected, fExpected));
+            BOOST_CHECK(ComputeNextStakeModifier(cache, &index, nModifier, fGenerated));
+            BOOST_CHECK_EQUAL(nModifier, nExpected);
+            BOOST_CHECK_EQUAL(fGenerated, fExpected);
+
+            index.SetStakeEntropyBit(index.GetStakeEntropyBit());
+            index.SetStakeModifier(nExpected, fExpected);
+        }
+    };
+
+    std::vector<CBlockIndex> vMain(3000);
+    std::vector<uint256> vMainHash(vMain.size());
+    BuildChain(vMain, vMainHash, nullptr, rng);
+    replay(vMain, vMainHash);
+
+    // a competing branch forces the cached window to be rebuilt
+    std::vector<CBlockIndex> vFork(500);
+    std::vector<uint256> vForkHash(vFork.size());
+    BuildChain(vFork, vForkHash, &vMain[2700], rng);
+    replay(vFork, vForkHash);
+}
+
+BOOST_AUTO_TEST_CASE(stake_modifier_index)
+{
+    FastRandomContext rng(true);
+    std::vector<CBlockIndex> vMain(3000);
+    std::vector<uint256> vMainHash(vMain.size());
+    BuildChain(vMain, vMainHash, nullptr, rng);
+    SetModifiers(vMain, rng);
+    std::vector<CBlockIndex> vFork(500);
+    std::vector<uint256> vForkHash(vFork.size());
+    BuildChain(vFork, vForkHash, &vMain[2700], rng);
+    SetModifiers(vFork, rng);
+
+    auto check = [&](const CStakeModifierIndex& index, const CChain& chain) {
+        const int nResolved = CheckModifierIndex(index, chain, vMain) + CheckModifierIndex(index, chain, vFork);
+        // the blocks near the tip are still waiting for a modifier
+        BOOST_CHECK(nResolved > 0 && nResolved <= chain.Height());
+    };
+
+    CChain chain;
+    chain.SetTip(vMain[1999]);
+    auto index = std::make_unique<CStakeModifierIndex>(1 << 20, false, true);
+    BOOST_CHECK(index->Init(chain));
+    check(*index, chain);
+
+    for (int i = 2000; i < 3000; i++) {
+        chain.SetTip(vMain[i]);
+        index->BlockConnected(&vMain[i]);
+        if (i % 250 == 0)
+            check(*index, chain);
+    }
+    check(*index, chain);
+
+    // a reorg to the fork reverts what the disconnected blocks resolved
+    for (int i = 2999; i > 2700; i--) {
+        index->BlockDisconnected(&vMain[i]);
+        chain.SetTip(vMain[i - 1]);
+    }
+    check(*index, chain);
+    for (CBlockIndex& block : vFork) {
+        chain.SetTip(block);
+        index->BlockConnected(&block);
+    }
+    check(*index, chain);
+
+    // a restart reads back what was written
+    index.reset();
+    index = std::make_unique<CStakeModifierIndex>(1 << 20, false, false);
+    BOOST_CHECK(index->Init(chain));
+    check(*index, chain);
+
+    // and drops what the chain no longer has when it changed while the index was down
+    index.reset();
+    chain.SetTip(vMain[2999]);
+    index = std::make_unique<CStakeModifierIndex>(1 << 20, false, false);
+    BOOST_CHECK(index->Init(chain));
+    check(*index, chain);
+
+    index.reset();
+    chain.SetTip(vMain[2400]);
+    index = std::make_unique<CStakeModifierIndex>(1 << 20, false, false);
+    BOOST_CHECK(index->Init(chain));
+    check(*index, chain);
+
+    // connecting after a restart carries on from the loaded entries
+    for (int i = 2401; i < 3000; i++) {
+        chain.SetTip(vMain[i]);
+        index->BlockConnected(&vMain[i]);
+    }
+    check(*index, chain);
+}
+
+BOOST_AUTO_TEST_CASE(stake_kernel_cache)
+{
+    const COutPoint prevout(InsecureRand256(), 0);
+    const uint256 hashBlockFrom = InsecureRand256();
+    CDataStream ss(SER_NETWORK, 0);
+    ss << prevout.n << prevout.hash;
+
+    CStakeSearcher searcher(0);
+    BOOST_CHECK(!searcher.GetCachedKernel(prevout, hashBlockFrom, 1));
+    const CStakeKernel* kernel = searcher.AddCachedKernel(prevout, hashBlockFrom, CStakeKernel(1, 1600000000, ss, COIN));
+    BOOST_CHECK_EQUAL(searcher.GetCachedKernel(prevout, hashBlockFrom, 1), kernel);
+
+    // a new modifier for the same origin block, as after a reorg, or a new origin block invalidates the kernel
+    BOOST_CHECK(!searcher.GetCachedKernel(prevout, hashBlockFrom, 2));
+    BOOST_CHECK(!searcher.GetCachedKernel(prevout, InsecureRand256(), 1));
+
+    // the precomputed kernel hashes like checkStake
+    const CStakeKernel kernelNew(2, 1600000000, ss, COIN);
+    kernel = searcher.AddCachedKernel(prevout, hashBlockFrom, kernelNew);
+    BOOST_CHECK_EQUAL(searcher.GetCachedKernel(prevout, hashBlockFrom, 2), kernel);
+    arith_uint256 bnTarget;
+    unsigned int nTimeTx = 1600100000;
+    uint256 hashProofOfStake;
+    checkStake(ss, COIN, 2, bnTarget, 1600000000, nTimeTx, hashProofOfStake);
+    BOOST_CHECK(kernel->GetHash(nTimeTx) == hashProofOfStake);
+
+    // kernels not used during a round are dropped at the start of the next one
+    searcher.NewCacheRound();
+    searcher.NewCacheRound();
+    BOOST_CHECK(!searcher.GetCachedKernel(prevout, hashBlockFrom, 2));
+}
+
+BOOST_AUTO_TEST_CASE(stake_search)
+{
+    // fixed kernels, so that the same ones hit on every run
+    std::vector<CDataStream> vUniqueIDs;
+    std::vector<CStakeKernel> vKernelData;
+    for (uint32_t i = 0; i < 1000; i++) {
+        CDataStream ss(SER_NETWORK, 0);
+        ss << i % 4 << ArithToUint256(arith_uint256(i + 1));
+        vUniqueIDs.push_back(ss);
+        vKernelData.emplace_back(uint64_t{i} * 7919 + 1, 1600000000 + i, ss, COIN);
+    }
+    std::vector<const CStakeKernel*> vKernels;
+    for (const CStakeKernel& kernel : vKernelData) {
+        vKernels.push_back(&kernel);
+    }
+
+    const unsigned int nTimeFirst = 1600100000;
+    const int nHashDrift = 60;
+    arith_uint256 bnTarget = ~arith_uint256(0) >> 33;
+    const unsigned int nBits = bnTarget.GetCompact();
+    bnTarget.SetCompact(nBits);
+
+    // the kernels that hit somewhere in the window, found one by one
+    std::vector<bool> vHit;
+    for (const CStakeKernel* kernel : vKernels) {
+        unsigned int nTimeTx;
+        uint256 hashProofOfStake;
+        vHit.push_back(kernel->CheckWindow(kernel->GetTargetWeight(bnTarget), nTimeFirst, nHashDrift, nTimeTx, hashProofOfStake));
+    }
+    BOOST_REQUIRE(std::count(vHit.begin(), vHit.end(), true) > 0);
+
+    // the workers report one of them, hashing like checkStake does
+    CStakeSearcher searcher(3);
+    size_t nKernel = vKernels.size();
+    unsigned int nTimeTx = 0;
+    uint256 hashProofOfStake;
+    BOOST_REQUIRE(searcher.Search(vKernels, nBits, nTimeFirst, nHashDrift, nKernel, nTimeTx, hashProofOfStake));
+    BOOST_REQUIRE(nKernel < vKernels.size());
+    BOOST_CHECK(vHit[nKernel]);
+    BOOST_CHECK(nTimeTx <= nTimeFirst && nTimeTx > nTimeFirst - nHashDrift);
+    unsigned int nTimeCheck = nTimeTx;
+    uint256 hashCheck;
+    BOOST_CHECK(checkStake(vUniqueIDs[nKernel], COIN, vKernels[nKernel]->GetStakeModifier(), bnTarget, vKernels[nKernel]->GetTimeBlockFrom(), nTimeCheck, hashCheck));
+    BOOST_CHECK(hashCheck == hashProofOfStake);
+
+    // a round without a hit tries every kernel and reports nothing
+    const unsigned int nBitsHard = arith_uint256(1).GetCompact();
+    BOOST_CHECK(!searcher.Search(vKernels, nBitsHard, nTimeFirst, nHashDrift, nKernel, nTimeTx, hashProofOfStake));
+    BOOST_CHECK(!searcher.Search({}, nBits, nTimeFirst, nHashDrift, nKernel, nTimeTx, hashProofOfStake));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
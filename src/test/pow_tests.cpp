@@ -6,6 +6,7 @@
 #include <chainparams.h>
 #include <pow.h>
 #include <test/util/setup_common.h>
+#include <validation.h>
 
 #include <boost/test/unit_test.hpp>
 
@@ -181,6 +182,73 @@ void sanity_check_chainparams(const ArgsManager& args, std::string chainName)
     }
 }
 
+BOOST_AUTO_TEST_CASE(HasValidProofOfWork_batch)
+{
+    const auto chainParams = CreateChainParams(*m_node.args, CBaseChainParams::REGTEST);
+    const Consensus::Params& consensus = chainParams->GetConsensus();
+
+    // a headers message worth of mixed proof-of-work and proof-of-stake headers
+    std::vector<CBlockHeader> headers(2000);
+    uint256 hashPrev = chainParams->GenesisBlock().GetHash();
+    for (size_t i = 0; i < headers.size(); i++) {
+        CBlockHeader& header = headers[i];
+        header.nVersion = 1;
+        header.hashPrevBlock = hashPrev;
+        header.hashMerkleRoot = InsecureRand256();
+        header.nTime = chainParams->GenesisBlock().nTime + i;
+        header.nBits = chainParams->GenesisBlock().nBits;
+        if (i % 3 == 0) {
+            header.nNonce = 0;
+        } else {
+            header.nNonce = 1;
+            while (!CheckProofOfWork(header.GetPoWHash(), header.nBits, consensus)) ++header.nNonce;
+        }
+        hashPrev = header.GetHash();
+    }
+
+    StartHeaderCheckWorkerThreads(2);
+    BOOST_CHECK(HasValidProofOfWork(headers, consensus));
+    // the verified headers are cached, checking them again is cheap
+    BOOST_CHECK(HasValidProofOfWork(headers, consensus));
+
+    // one proof-of-work header short of its claimed work fails the whole message
+    headers[1777].nBits = 0x1d00ffff;
+    BOOST_CHECK(!HasValidProofOfWork(headers, consensus));
+    headers[1777].nBits = chainParams->GenesisBlock().nBits;
+    // proof-of-stake headers are not hashed
+    headers[1779].nBits = 0x1d00ffff;
+    headers[1779].nNonce = 0;
+    BOOST_CHECK(HasValidProofOfWork(headers, consensus));
+    StopHeaderCheckWorkerThreads();
+
+    // without worker threads the calling thread checks all of them
+    headers[1001].nBits = 0x1d00ffff;
+    BOOST_CHECK(!HasValidProofOfWork(headers, consensus));
+}
+
+BOOST_AUTO_TEST_CASE(GetLastBlockIndex_test)
+{
+    // runs of both block types, including a long proof-of-stake run
+    std::vector<CBlockIndex> blocks(3000);
+    for (int i = 0; i < (int)blocks.size(); i++) {
+        blocks[i].pprev = i ? &blocks[i - 1] : nullptr;
+        blocks[i].nHeight = i;
+        blocks[i].nNonce = (i > 0 && i < 10) || i >= 1000 || InsecureRandBool() ? 0 : 1;
+        blocks[i].BuildSkip();
+    }
+
+    for (const CBlockIndex& block : blocks) {
+        for (bool fProofOfStake : {false, true}) {
+            const CBlockIndex* pindexExpected = &block;
+            while (pindexExpected->pprev && pindexExpected->IsProofOfStake() != fProofOfStake) {
+                pindexExpected = pindexExpected->pprev;
+            }
+            BOOST_CHECK_EQUAL(GetLastBlockIndex(&block, fProofOfStake), pindexExpected);
+        }
+    }
+    BOOST_CHECK(GetLastBlockIndex(nullptr, true) == nullptr);
+}
+
 BOOST_AUTO_TEST_CASE(ChainParams_MAIN_sanity)
 {
     sanity_check_chainparams(*m_node.args, CBaseChainParams::MAIN);
@@ -0,0 +1,142 @@
+// Copyright (c) 2022 The Myce Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <arith_uint256.h>
+#include <clientversion.h>
+#include <masternode/seencache.h>
+#include <streams.h>
+#include <test/util/setup_common.h>
+#include <util/time.h>
+#include <version.h>
+
+#include <map>
+#include <set>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(seencache_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(seencache_size_bound)
+{
+    SetMockTime(1600000000);
+    CSeenCache<uint256, int> cache(100, 60 * 60);
+    for (int i = 0; i < 250; i++) {
+        cache.insert(std::make_pair(ArithToUint256(arith_uint256(i)), i));
+    }
+
+    // the oldest entries were dropped
+    BOOST_CHECK_EQUAL(cache.size(), 100U);
+    BOOST_CHECK(!cache.count(ArithToUint256(arith_uint256(149))));
+    BOOST_CHECK(cache.count(ArithToUint256(arith_uint256(150))));
+    BOOST_CHECK(cache.count(ArithToUint256(arith_uint256(249))));
+    SetMockTime(0);
+}
+
+BOOST_AUTO_TEST_CASE(seencache_age_bound)
+{
+    SetMockTime(1600000000);
+    CSeenCache<uint256, int> cache(1000, 60);
+    cache[ArithToUint256(arith_uint256(1))] = 1;
+    cache.insert_or_assign(ArithToUint256(arith_uint256(2)), 2);
+
+    // assigning through operator[] doesn't count as adding, insert_or_assign does
+    SetMockTime(1600000050);
+    cache[ArithToUint256(arith_uint256(1))] = 10;
+    cache.insert_or_assign(ArithToUint256(arith_uint256(2)), 20);
+
+    SetMockTime(1600000070);
+    cache.insert(std::make_pair(ArithToUint256(arith_uint256(3)), 3));
+    BOOST_CHECK(!cache.count(ArithToUint256(arith_uint256(1))));
+    BOOST_CHECK_EQUAL(cache[ArithToUint256(arith_uint256(2))], 20);
+    BOOST_CHECK_EQUAL(cache.size(), 2U);
+    SetMockTime(0);
+}
+
+BOOST_AUTO_TEST_CASE(seencache_erase)
+{
+    SetMockTime(1600000000);
+    CSeenCache<uint256, int> cache(10, 60 * 60);
+    // erasing and adding again many times leaves the bounds as they were
+    for (int i = 0; i < 1000; i++) {
+        cache.insert(std::make_pair(ArithToUint256(arith_uint256(i % 5)), i));
+        cache.erase(ArithToUint256(arith_uint256(i % 5)));
+    }
+    BOOST_CHECK(cache.empty());
+
+    for (int i = 0; i < 20; i++) {
+        cache.emplace(ArithToUint256(arith_uint256(i)), i);
+    }
+    auto it = cache.begin();
+    while (it != cache.end()) {
+        if (it->second % 2)
+            cache.erase(it++);
+        else
+            ++it;
+    }
+    BOOST_CHECK_EQUAL(cache.size(), 5U);
+    for (int i = 10; i < 20; i += 2) {
+        BOOST_CHECK(cache.count(ArithToUint256(arith_uint256(i))));
+    }
+    BOOST_CHECK(cache.DynamicMemoryUsage() > 0);
+    SetMockTime(0);
+}
+
+BOOST_AUTO_TEST_CASE(seencache_serialization)
+{
+    // reads what a std::map wrote, as in the .dat files
+    std::map<uint256, int> mapIn;
+    for (int i = 0; i < 50; i++) {
+        mapIn.emplace(ArithToUint256(arith_uint256(i)), i);
+    }
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << mapIn;
+
+    CSeenCache<uint256, int> cache(100, 60 * 60);
+    ss >> cache;
+    BOOST_CHECK_EQUAL(cache.size(), mapIn.size());
+
+    ss << cache;
+    std::map<uint256, int> mapOut;
+    ss >> mapOut;
+    BOOST_CHECK(mapIn == mapOut);
+}
+
+BOOST_AUTO_TEST_CASE(seencache_track_changes)
+{
+    SetMockTime(1600000000);
+    CSeenCache<uint256, int> cache(3, 60 * 60);
+    cache.insert(std::make_pair(ArithToUint256(arith_uint256(1)), 1));
+
+    // nothing is kept before TrackChanges
+    std::set<uint256> setChanged;
+    const auto fnTake = [&](const uint256& hash) { setChanged.insert(hash); };
+    cache.TakeChanges(fnTake);
+    BOOST_CHECK(setChanged.empty());
+
+    cache.TrackChanges();
+    cache.insert(std::make_pair(ArithToUint256(arith_uint256(2)), 2));
+    cache[ArithToUint256(arith_uint256(1))] = 10;
+    cache.erase(ArithToUint256(arith_uint256(2)));
+    BOOST_CHECK(cache.find(ArithToUint256(arith_uint256(3))) == cache.end());
+    cache.TakeChanges(fnTake);
+    BOOST_CHECK(setChanged == std::set<uint256>({ArithToUint256(arith_uint256(1)), ArithToUint256(arith_uint256(2))}));
+
+    // the changes were taken, entries dropped for the size bound are changes too
+    setChanged.clear();
+    for (int i = 3; i < 6; i++) {
+        cache.insert(std::make_pair(ArithToUint256(arith_uint256(i)), i));
+    }
+    cache.TakeChanges(fnTake);
+    BOOST_CHECK_EQUAL(setChanged.size(), 4U);
+    BOOST_CHECK(setChanged.count(ArithToUint256(arith_uint256(1))));
+    BOOST_CHECK(!cache.count(ArithToUint256(arith_uint256(1))));
+
+    setChanged.clear();
+    cache.clear();
+    cache.TakeChanges(fnTake);
+    BOOST_CHECK_EQUAL(setChanged.size(), 3U);
+    SetMockTime(0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
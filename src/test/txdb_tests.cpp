@@ -0,0 +1,134 @@
+// Copyright (c) 2022 The Myce Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chain.h>
+#include <chainparams.h>
+#include <primitives/block.h>
+#include <sync.h>
+#include <test/util/setup_common.h>
+#include <txdb.h>
+#include <uint256.h>
+#include <util/system.h>
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+/** Headers of a short chain and their index entries, linked like the ones of a node */
+struct CTestChain {
+    std::vector<uint256> vHashes;
+    std::vector<std::unique_ptr<CBlockIndex>> vIndexes;
+
+    explicit CTestChain(int nBlocks)
+    {
+        vHashes.reserve(nBlocks);
+        uint256 hashPrev;
+        for (int i = 0; i < nBlocks; i++) {
+            CBlockHeader header;
+            // old versions hash with scrypt, newer ones with SHA256
+            header.nVersion = i % 2 ? 1 : 4;
+            header.hashPrevBlock = hashPrev;
+            header.hashMerkleRoot = InsecureRand256();
+            header.nTime = 1600000000 + i * 60;
+            header.nBits = 0x1e0fffff;
+            header.nNonce = InsecureRand32();
+            vHashes.push_back(header.GetHash());
+
+            auto pindex = std::make_unique<CBlockIndex>(header);
+            pindex->phashBlock = &vHashes.back();
+            pindex->pprev = i ? vIndexes.back().get() : nullptr;
+            pindex->nHeight = i;
+            pindex->nStakeModifier = InsecureRandBits(64);
+            vIndexes.push_back(std::move(pindex));
+            hashPrev = vHashes.back();
+        }
+    }
+
+    void Write(CBlockTreeDB& db) const
+    {
+        std::vector<const CBlockIndex*> vWrite;
+        for (const auto& pindex : vIndexes) {
+            vWrite.push_back(pindex.get());
+        }
+        BOOST_REQUIRE(db.WriteBatchSync({}, 0, vWrite));
+    }
+};
+
+/** Load the block index of db into mapIndex, as the block manager does */
+bool LoadIndex(CBlockTreeDB& db, std::map<uint256, CBlockIndex>& mapIndex)
+{
+    LOCK(cs_main);
+    return db.LoadBlockIndexGuts(Params().GetConsensus(), [&](const uint256& hash) {
+        if (hash.IsNull()) return static_cast<CBlockIndex*>(nullptr);
+        auto it = mapIndex.try_emplace(hash).first;
+        it->second.phashBlock = &it->first;
+        return &it->second;
+    });
+}
+
+void CheckIndex(const CTestChain& chain, const std::map<uint256, CBlockIndex>& mapIndex)
+{
+    BOOST_CHECK_EQUAL(mapIndex.size(), chain.vIndexes.size());
+    for (const auto& pindex : chain.vIndexes) {
+        auto it = mapIndex.find(pindex->GetBlockHash());
+        BOOST_REQUIRE(it != mapIndex.end());
+        const CBlockIndex& loaded = it->second;
+        BOOST_CHECK_EQUAL(loaded.nHeight, pindex->nHeight);
+        BOOST_CHECK(loaded.GetBlockHeader().GetHash() == pindex->GetBlockHash());
+        BOOST_CHECK_EQUAL(loaded.nStakeModifier, pindex->nStakeModifier);
+        if (pindex->pprev) {
+            BOOST_REQUIRE(loaded.pprev);
+            BOOST_CHECK(loaded.pprev->GetBlockHash() == pindex->pprev->GetBlockHash());
+        } else {
+            BOOST_CHECK(!loaded.pprev);
+        }
+    }
+}
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(txdb_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(txdb_load_block_index)
+{
+    CTestChain chain(20);
+    CBlockTreeDB db(1 << 20, /*fMemory=*/true);
+    chain.Write(db);
+
+    // by default the keys are trusted, with -checkblockindexhashes every header is hashed again
+    for (const bool fCheckHashes : {false, true}) {
+        gArgs.ForceSetArg("-checkblockindexhashes", fCheckHashes ? "1" : "0");
+        std::map<uint256, CBlockIndex> mapIndex;
+        BOOST_CHECK(LoadIndex(db, mapIndex));
+        CheckIndex(chain, mapIndex);
+    }
+    gArgs.ForceSetArg("-checkblockindexhashes", "0");
+}
+
+BOOST_AUTO_TEST_CASE(txdb_load_block_index_corrupted)
+{
+    CTestChain chain(20);
+    CBlockTreeDB db(1 << 20, /*fMemory=*/true);
+    chain.Write(db);
+
+    // an entry whose header does not hash to its key
+    CBlockIndex& corrupted = *chain.vIndexes[10];
+    corrupted.nTime++;
+    BOOST_REQUIRE(db.WriteBatchSync({}, 0, {&corrupted}));
+
+    // the trusted load takes the key as it is, only the check notices
+    std::map<uint256, CBlockIndex> mapIndex;
+    gArgs.ForceSetArg("-checkblockindexhashes", "0");
+    BOOST_CHECK(LoadIndex(db, mapIndex));
+    BOOST_CHECK_EQUAL(mapIndex.size(), chain.vIndexes.size());
+
+    mapIndex.clear();
+    gArgs.ForceSetArg("-checkblockindexhashes", "1");
+    BOOST_CHECK(!LoadIndex(db, mapIndex));
+    gArgs.ForceSetArg("-checkblockindexhashes", "0");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
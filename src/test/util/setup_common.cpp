@@ -201,6 +201,7 @@ ChainTestingSetup::ChainTestingSetup(const std::string& chainName, const std::ve
     // Start script-checking threads. Set g_parallel_script_checks to true so they are used.
     constexpr int script_check_threads = 2;
     StartScriptCheckWorkerThreads(script_check_threads);
+    StartHeaderCheckWorkerThreads(script_check_threads);
     g_parallel_script_checks = true;
 }
 
@@ -208,6 +209,7 @@ ChainTestingSetup::~ChainTestingSetup()
 {
     if (m_node.scheduler) m_node.scheduler->stop();
     StopScriptCheckWorkerThreads();
+    StopHeaderCheckWorkerThreads();
     GetMainSignals().FlushBackgroundCallbacks();
     GetMainSignals().UnregisterBackgroundSignalScheduler();
     m_node.connman.reset();
@@ -302,6 +302,10 @@ bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams,
     std::unique_ptr<CDBIterator> pcursor(NewIterator());
     pcursor->Seek(std::make_pair(DB_BLOCK_INDEX, uint256()));
 
+    // Records are keyed by block hash. Rehashing the header costs a scrypt
+    // evaluation for old block versions, so the key is trusted unless asked otherwise.
+    const bool fCheckHashes = gArgs.GetBoolArg("-checkblockindexhashes", DEFAULT_CHECK_BLOCK_INDEX_HASHES);
+
     // Load m_block_index
     while (pcursor->Valid()) {
         if (ShutdownRequested()) return false;
@@ -309,8 +313,12 @@ bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams,
         if (pcursor->GetKey(key) && key.first == DB_BLOCK_INDEX) {
             CDiskBlockIndex diskindex;
             if (pcursor->GetValue(diskindex)) {
+                if (fCheckHashes && diskindex.ConstructBlockHash() != key.second) {
+                    return error("%s: block index entry %s does not match its header", __func__, key.second.ToString());
+                }
+
                 // Construct block index object
-                CBlockIndex* pindexNew    = insertBlockIndex(diskindex.ConstructBlockHash());
+                CBlockIndex* pindexNew    = insertBlockIndex(key.second);
                 pindexNew->pprev          = insertBlockIndex(diskindex.hashPrev);
                 pindexNew->nHeight        = diskindex.nHeight;
                 pindexNew->nFile          = diskindex.nFile;
@@ -28,6 +28,8 @@ struct bilingual_str;
 static const int64_t nDefaultDbCache = 450;
 //! -dbbatchsize default (bytes)
 static const int64_t nDefaultDbBatchSize = 16 << 20;
+//! -checkblockindexhashes default
+static const bool DEFAULT_CHECK_BLOCK_INDEX_HASHES = false;
 //! max. -dbcache (MiB)
 static const int64_t nMaxDbCache = sizeof(void*) > 4 ? 16384 : 1024;
 //! min. -dbcache (MiB)
@@ -24,12 +24,14 @@
 #include <hash.h>
 #include <logging.h>
 #include <logging/timer.h>
+#include <masternode/budgetcollateralindex.h>
 #include <node/blockstorage.h>
 #include <node/interface_ui.h>
 #include <node/utxo_snapshot.h>
 #include <policy/policy.h>
 #include <policy/rbf.h>
 #include <policy/settings.h>
+#include <pos/modifierindex.h>
 #include <pos/pos.h>
 #include <pos/stakeinput.h>
 #include <pos/util.h>
@@ -1953,6 +1955,108 @@ void StopScriptCheckWorkerThreads()
     scriptcheckqueue.StopWorkerThreads();
 }
 
+namespace {
+/**
+ * Headers whose proof-of-work was verified recently, so that accepting them
+ * right after a headers message was checked does not redo the scrypt hashing.
+ */
+class CHeaderPoWCache
+{
+private:
+    Mutex m_mutex;
+    CuckooCache::cache<uint256, SignatureCacheHasher> m_cache GUARDED_BY(m_mutex);
+    //! salt so that peers cannot aim headers at particular cache slots
+    const uint256 m_nonce{GetRandHash()};
+
+    uint256 GetEntry(const CBlockHeader& header) const
+    {
+        CHashWriter ss(SER_GETHASH, 0);
+        ss << m_nonce << header;
+        return ss.GetHash();
+    }
+
+public:
+    CHeaderPoWCache()
+    {
+        WITH_LOCK(m_mutex, m_cache.setup_bytes(HEADER_POW_CACHE_BYTES));
+    }
+
+    bool Contains(const CBlockHeader& header) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        const uint256 entry = GetEntry(header);
+        LOCK(m_mutex);
+        return m_cache.contains(entry, /*erase=*/false);
+    }
+
+    void Insert(const CBlockHeader& header) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        uint256 entry = GetEntry(header);
+        LOCK(m_mutex);
+        m_cache.insert(entry);
+    }
+};
+
+CHeaderPoWCache& GetHeaderPoWCache()
+{
+    static CHeaderPoWCache cache;
+    return cache;
+}
+
+/** Proof-of-work check of a group of consecutive headers, hashed together with scrypt_1024_1_1_256_batch. */
+class CHeaderPoWCheck
+{
+private:
+    const CBlockHeader* pheaders{nullptr};
+    size_t nCount{0};
+    const Consensus::Params* pparams{nullptr};
+
+public:
+    CHeaderPoWCheck() = default;
+    CHeaderPoWCheck(const CBlockHeader* pheadersIn, size_t nCountIn, const Consensus::Params& params)
+        : pheaders(pheadersIn), nCount(nCountIn), pparams(&params) {}
+
+    bool operator()()
+    {
+        CHeaderPoWCache& cache = GetHeaderPoWCache();
+        std::vector<CBlockHeader> vPoW;
+        for (size_t i = 0; i < nCount; i++) {
+            // proof-of-stake headers (nNonce == 0) carry no proof-of-work
+            if (pheaders[i].nNonce && !cache.Contains(pheaders[i])) {
+                vPoW.push_back(pheaders[i]);
+            }
+        }
+
+        const std::vector<uint256> vHashes = GetPoWHashes(vPoW);
+        for (size_t i = 0; i < vPoW.size(); i++) {
+            if (!CheckProofOfWork(vHashes[i], vPoW[i].nBits, *pparams)) {
+                return false;
+            }
+            cache.Insert(vPoW[i]);
+        }
+        return true;
+    }
+
+    void swap(CHeaderPoWCheck& check) noexcept
+    {
+        std::swap(pheaders, check.pheaders);
+        std::swap(nCount, check.nCount);
+        std::swap(pparams, check.pparams);
+    }
+};
+} // namespace
+
+static CCheckQueue<CHeaderPoWCheck> headercheckqueue(4, "headerch");
+
+void StartHeaderCheckWorkerThreads(int threads_num)
+{
+    headercheckqueue.StartWorkerThreads(threads_num);
+}
+
+void StopHeaderCheckWorkerThreads()
+{
+    headercheckqueue.StopWorkerThreads();
+}
+
 /**
  * Threshold condition checker that triggers when unknown versionbits are seen on the network.
  */
@@ -2741,6 +2845,12 @@ bool Chainstate::DisconnectTip(BlockValidationState& state, DisconnectedBlockTra
     }
 
     m_chain.SetTip(*pindexDelete->pprev);
+    if (g_stake_modifier_index && this == &m_chainman.ActiveChainstate()) {
+        g_stake_modifier_index->BlockDisconnected(pindexDelete);
+    }
+    if (g_budget_collateral_index && this == &m_chainman.ActiveChainstate()) {
+        g_budget_collateral_index->BlockDisconnected(block, pindexDelete);
+    }
 
     UpdateTip(pindexDelete->pprev);
     // Let wallets know transactions went from 1-confirmed to
@@ -2855,6 +2965,12 @@ bool Chainstate::ConnectTip(BlockValidationState& state, CBlockIndex* pindexNew,
     }
     // Update m_chain & related variables.
     m_chain.SetTip(*pindexNew);
+    if (g_stake_modifier_index && this == &m_chainman.ActiveChainstate()) {
+        g_stake_modifier_index->BlockConnected(pindexNew);
+    }
+    if (g_budget_collateral_index && this == &m_chainman.ActiveChainstate()) {
+        g_budget_collateral_index->BlockConnected(blockConnecting, pindexNew);
+    }
     UpdateTip(pindexNew);
 
     int64_t nTime6 = GetTimeMicros(); nTimePostConnect += nTime6 - nTime5; nTimeTotal += nTime6 - nTime1;
@@ -3422,8 +3538,8 @@ void Chainstate::ReceivedBlockTransactions(const CBlock& block, CBlockIndex* pin
 
 static bool CheckBlockHeader(const CBlockHeader& block, BlockValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW = true)
 {
-    // Check proof of work matches claimed amount
-    if (fCheckPOW && !CheckProofOfWork(block.GetPoWHash(), block.nBits, consensusParams))
+    // Check proof of work matches claimed amount, unless it was checked with its headers message
+    if (fCheckPOW && !GetHeaderPoWCache().Contains(block) && !CheckProofOfWork(block.GetPoWHash(), block.nBits, consensusParams))
         return state.Invalid(BlockValidationResult::BLOCK_INVALID_HEADER, "high-hash", "proof of work failed");
 
     return true;
@@ -3557,11 +3673,14 @@ std::vector<unsigned char> ChainstateManager::GenerateCoinbaseCommitment(CBlock&
 
 bool HasValidProofOfWork(const std::vector<CBlockHeader>& headers, const Consensus::Params& consensusParams)
 {
-    return std::all_of(headers.cbegin(), headers.cend(),
-            [&](const auto& header) {
-                bool isPoS = !header.nNonce;
-                return isPoS ? true : CheckProofOfWork(header.GetPoWHash(), header.nBits, consensusParams);
-            });
+    std::vector<CHeaderPoWCheck> vChecks;
+    for (size_t i = 0; i < headers.size(); i += HEADER_POW_CHECK_SIZE) {
+        vChecks.emplace_back(&headers[i], std::min(HEADER_POW_CHECK_SIZE, headers.size() - i), consensusParams);
+    }
+
+    CCheckQueueControl<CHeaderPoWCheck> control(&headercheckqueue);
+    control.Add(vChecks);
+    return control.Wait();
 }
 
 arith_uint256 CalculateHeadersWork(const std::vector<CBlockHeader>& headers)
@@ -3873,7 +3992,7 @@ void ChainstateManager::ReportHeadersPresync(const arith_uint256& work, int64_t
 }
 
 /** Store block on disk. If dbp is non-nullptr, the file is known to already reside on disk */
-bool Chainstate::AcceptBlock(const std::shared_ptr<const CBlock>& pblock, BlockValidationState& state, CBlockIndex** ppindex, bool fRequested, const FlatFilePos* dbp, bool* fNewBlock, bool min_pow_checked)
+bool Chainstate::AcceptBlock(const std::shared_ptr<const CBlock>& pblock, BlockValidationState& state, CBlockIndex** ppindex, bool fRequested, const FlatFilePos* dbp, bool* fNewBlock, bool min_pow_checked, const CStakePreValidation* pprevalidation)
 {
     const CBlock& block = *pblock;
 
@@ -3886,11 +4005,12 @@ bool Chainstate::AcceptBlock(const std::shared_ptr<const CBlock>& pblock, BlockV
     bool accepted_header{m_chainman.AcceptBlockHeader(block, state, &pindex, min_pow_checked)};
     CheckBlockIndex();
 
-    if (block.IsProofOfStake())
+    // a kernel checked before cs_main was taken only needs to be confirmed
+    if (block.IsProofOfStake() && !(pprevalidation && ConfirmProofOfStake(block, *pprevalidation, *this)))
     {
         uint256 hashProofOfStake{};
         std::unique_ptr<CStakeInput> stake;
-        if (!CheckProofOfStake(block, hashProofOfStake, stake, *this)) {
+        if (!CheckProofOfStake(block, hashProofOfStake, stake, *this, state)) {
             return false;
         }
 
@@ -3978,6 +4098,11 @@ bool ChainstateManager::ProcessNewBlock(const std::shared_ptr<const CBlock>& blo
         if (new_block) *new_block = false;
         BlockValidationState state;
 
+        // The expensive proof-of-stake checks (block signature, kernel lookup
+        // and hash) don't need cs_main, only their outcome is confirmed below
+        CStakePreValidation prevalidation;
+        PreValidateProofOfStake(*block, prevalidation, ActiveChainstate());
+
         // CheckBlock() does not support multi-threaded block validation because CBlock::fChecked can cause data race.
         // Therefore, the following critical section must include the CheckBlock() call as well.
         LOCK(cs_main);
@@ -3987,10 +4112,10 @@ bool ChainstateManager::ProcessNewBlock(const std::shared_ptr<const CBlock>& blo
         // malleability that cause CheckBlock() to fail; see e.g. CVE-2012-2459 and
         // https://lists.linuxfoundation.org/pipermail/bitcoin-dev/2019-February/016697.html.  Because CheckBlock() is
         // not very expensive, the anti-DoS benefits of caching failure (of a definitely-invalid block) are not substantial.
-        bool ret = CheckBlock(*block, state, GetConsensus());
+        bool ret = CheckBlock(*block, state, GetConsensus(), true, true, !prevalidation.fSignatureChecked);
         if (ret) {
             // Store to disk
-            ret = ActiveChainstate().AcceptBlock(block, state, &pindex, force_processing, nullptr, new_block, min_pow_checked);
+            ret = ActiveChainstate().AcceptBlock(block, state, &pindex, force_processing, nullptr, new_block, min_pow_checked, &prevalidation);
         }
         if (!ret) {
             GetMainSignals().BlockChecked(*block, state);
@@ -4339,6 +4464,7 @@ void Chainstate::UnloadBlockIndex()
     AssertLockHeld(::cs_main);
     nBlockSequenceId = 1;
     setBlockIndexCandidates.clear();
+    m_stake_modifier_cache.Clear();
 }
 
 bool ChainstateManager::LoadBlockIndex()
@@ -22,6 +22,7 @@
 #include <policy/feerate.h>
 #include <policy/packages.h>
 #include <policy/policy.h>
+#include <pos/modifiercache.h>
 #include <script/script_error.h>
 #include <sync.h>
 #include <txdb.h>
@@ -47,6 +48,7 @@ class Chainstate;
 class CBlockTreeDB;
 class CTxMemPool;
 class ChainstateManager;
+struct CStakePreValidation;
 struct ChainTxData;
 struct DisconnectedBlockTransactions;
 struct PrecomputedTransactionData;
@@ -63,6 +65,10 @@ struct Params;
 static const int MAX_SCRIPTCHECK_THREADS = 15;
 /** -par default (number of script-checking threads, 0 = auto) */
 static const int DEFAULT_SCRIPTCHECK_THREADS = 0;
+/** Number of headers hashed together by one header proof-of-work check */
+static const size_t HEADER_POW_CHECK_SIZE = 8;
+/** Size of the cache of headers with verified proof-of-work */
+static const size_t HEADER_POW_CACHE_BYTES = 1 << 20;
 static const int64_t DEFAULT_MAX_TIP_AGE = 24 * 60 * 60;
 static const bool DEFAULT_CHECKPOINTS_ENABLED = true;
 static const bool DEFAULT_TXINDEX = true;
@@ -118,6 +124,10 @@ extern const std::vector<std::string> CHECKLEVEL_DOC;
 void StartScriptCheckWorkerThreads(int threads_num);
 /** Stop all of the script checking worker threads */
 void StopScriptCheckWorkerThreads();
+/** Run instances of header proof-of-work checking worker threads */
+void StartHeaderCheckWorkerThreads(int threads_num);
+/** Stop all of the header proof-of-work checking worker threads */
+void StopHeaderCheckWorkerThreads();
 
 CAmount GetBlockSubsidy(int nHeight, const CChainParams& chainparams, bool fProofOfStake);
 CAmount GetBlockSubsidy(int nHeight, const Consensus::Params& consensusParams);
@@ -520,6 +530,9 @@ public:
     //! @see CChain, CBlockIndex.
     CChain m_chain;
 
+    //! Candidate window and last generator of the previous stake modifier computation.
+    CStakeModifierCache m_stake_modifier_cache GUARDED_BY(::cs_main);
+
     /**
      * The blockhash which is the base of the snapshot this chainstate was created from.
      *
@@ -658,7 +671,7 @@ public:
         EXCLUSIVE_LOCKS_REQUIRED(!m_chainstate_mutex)
         LOCKS_EXCLUDED(::cs_main);
 
-    bool AcceptBlock(const std::shared_ptr<const CBlock>& pblock, BlockValidationState& state, CBlockIndex** ppindex, bool fRequested, const FlatFilePos* dbp, bool* fNewBlock, bool min_pow_checked) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    bool AcceptBlock(const std::shared_ptr<const CBlock>& pblock, BlockValidationState& state, CBlockIndex** ppindex, bool fRequested, const FlatFilePos* dbp, bool* fNewBlock, bool min_pow_checked, const CStakePreValidation* pprevalidation = nullptr) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
     // Block (dis)connection on a given view:
     DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view)